@@ -236,20 +236,25 @@ cexpDisassemblerInstall(bfd *abfd)
 	bfdOctetsPerByte = bfd_octets_per_byte(abfd);
 }
 
+/* the symbol at or below 'addr' if 'prev' is NULL or the
+ * first one following 'prev' (which is at or below 'addr');
+ * local symbols are taken into account.
+ */
 static CexpSym	
-getNextSym(int *pindex, CexpModule *pmod, void *addr)
+getNextSym(CexpSym prev, CexpModule *pmod, void *addr)
 {
-	if (*pindex < 0 || *pindex >= (*pmod)->symtbl->nentries-1) {
-		/* reached the end of the module's symbol table;
-		 * search module list again
-		 */
-		*pindex = cexpSymLkAddrIdx(addr, 0, 0, pmod);
-		if (*pindex < 0)
-			return 0;
-	} else {
-		(*pindex)++;
-	}
-	return (*pmod)->symtbl->aindex[*pindex];
+CexpSymAIdxRec	ar[3];
+int				i;
+
+	cexpSymLkAddrRange(addr, ar, 1);
+
+	i = ( ! prev || (ar[1].mod && CEXP_ASYM(ar[1].tbl, ar[1].idx)->value.ptv > prev->value.ptv) ) ? 1 : 2;
+
+	if ( ! ar[i].mod )
+		return 0;
+
+	*pmod = ar[i].mod;
+	return cexpSymTblResolve(ar[i].tbl, CEXP_ASYM(ar[i].tbl, ar[i].idx));
 }
 
 int
@@ -258,9 +263,8 @@ cexpDisassemble(void *addr, int n, disassemble_info *di)
 FILE			*f;
 fprintf_ftype	orig_fprintf;
 DAStreamRec		b;
-CexpSym			currSym,nextSym;
+CexpSym			currSym,nextSym,prevSym;
 CexpModule		currMod,nextMod;
-int				found;
 
 	if (!bfdDisassembler) {
 		fprintf(stderr,"No disassembler support\n");
@@ -286,8 +290,7 @@ int				found;
 	if (n<1)
 		n=10;
 
-	found=-1;
-	currSym=getNextSym(&found,&currMod,di->buffer);
+	prevSym=currSym=getNextSym(0,&currMod,di->buffer);
 	nextSym=0;
 
 	while (n-- > 0) {
@@ -349,11 +352,11 @@ int				found;
 
 		if (!nextSym) {
 			nextMod=currMod;
-			nextSym=getNextSym(&found,&nextMod,di->buffer);
+			nextSym=getNextSym(prevSym,&nextMod,di->buffer);
 		}
 		if (nextSym) {
 			if (di->buffer >= (bfd_byte *)nextSym->value.ptv) {
-				currSym=nextSym; currMod=nextMod;
+				prevSym=currSym=nextSym; currMod=nextMod;
 				nextSym=0;
 			}
 		}
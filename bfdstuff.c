@@ -151,7 +151,8 @@
  * with the WRITE_LOCK held, so mutex is guaranteed for
  * the ctorCtorRegexp.
  */
-static  cexp_regex	*ctorDtorRegexp=0;
+/* need the match position; use the regexp library directly */
+static  SPENCER_(regexp)	*ctorDtorRegexp=0;
 
 /*
  * Allow to override the object-attribute matcher
@@ -213,7 +214,6 @@ typedef struct LinkDataRec_ {
 	int				errors;
 	int				num_alloc_sections;
 	int				num_section_names;	/* differs because of linkonce sections */
-	BitmapWord		*depend;
 	int				nCtors;
 	int				nDtors;
 #ifdef OBSOLETE_EH_STUFF
@@ -257,7 +257,7 @@ static void (*my__cxa_finalize)(/*dso_handle*/ void*)=0;
 static CexpSym	my__dso_handle = 0;
 
 static asymbol *
-asymFromCexpSym(bfd *abfd, CexpSym csym, BitmapWord *depend, CexpModule mod);
+asymFromCexpSym(bfd *abfd, CexpSym csym, LinkData ld, CexpModule mod);
 
 static void
 bfdCleanupCallback(CexpModule);
@@ -345,7 +345,7 @@ isCtorDtor(asymbol *asym, int quiet, int *pprio)
 	   character there, in case a new object file format
 	   comes along with even worse naming restrictions)."  */
 
-	if (cexp_regexec(ctorDtorRegexp,bfd_asymbol_name(asym))) {
+	if (SPENCER_(regexec)(ctorDtorRegexp,bfd_asymbol_name(asym))) {
 		register const char *tail = ctorDtorRegexp->endp[0];
 		/* read the priority */
 		if (pprio) {
@@ -452,6 +452,114 @@ CexpType	t=TVoid;
 			cesp->flags |= CEXP_SYMFLG_SECT;
 }
 
+/* Local symbols (static functions and objects) are not entered
+ * into the module's table but kept aside for address lookups
+ * (see cexpSymTblSetLocals()).
+ */
+static const char *
+filterLocal(void *ext_sym, void *closure)
+{
+LinkData	ld   =closure;
+asymbol		*asym=*(asymbol**)ext_sym;
+
+		/* skip what's not loaded, e.g., redundant linkonce sections */
+		if (    ! (BSF_LOCAL & asym->flags)
+		     || ! ((BSF_FUNCTION | BSF_OBJECT) & asym->flags)
+		     || ((BSF_SECTION_SYM | BSF_DEBUGGING) & asym->flags)
+		     || ! (SEC_ALLOC & bfd_get_section_flags(ld->abfd, bfd_get_section(asym))) )
+			return 0;
+		return bfd_asymbol_name(asym);
+}
+
+/* the values must be final, i.e., this is used after relocation */
+static void
+assignLocal(void *ext_sym, CexpSym cesp, void *closure)
+{
+		assign(ext_sym, cesp, closure);
+		cesp->value.ptv=(CexpVal)bfd_asymbol_value(*(asymbol**)ext_sym);
+}
+
+/* extract the local symbols of 'st' into a table (w/o index)
+ *
+ * RETURNS: table or NULL if there are none (or no memory).
+ */
+static CexpSymTbl
+localsExtract(LinkData ld, asymbol **st)
+{
+CexpSymTbl	t;
+long		n,nl;
+
+	for ( n=0, nl=0; st[n]; n++ ) {
+		if ( filterLocal(st+n, ld) )
+			nl++;
+	}
+
+	if ( !nl || !(t=cexpNewSymTbl(nl)) )
+		return 0;
+
+	if ( !cexpAddSymTbl(t, st, sizeof(*st), n, filterLocal, assignLocal, ld, 0) )
+		cexpFreeSymTbl(&t);
+
+	return t;
+}
+
+/* build the address index of locals extracted at load time */
+static CexpSymTbl
+localsIndex(void *arg)
+{
+CexpSymTbl t=arg;
+
+	if ( cexpIndexSymTbl(t) )
+		cexpFreeSymTbl(&t);
+	return t;
+}
+
+static void
+localsRelease(void *arg)
+{
+CexpSymTbl t=arg;
+
+	cexpFreeSymTbl(&t);
+}
+
+/* read the locals of the system symbol file (named 'arg') again */
+static CexpSymTbl
+localsRead(void *arg)
+{
+char		*path=arg;
+FILE		*f=0;
+asymbol		**st=0;
+long		sz;
+CexpSymTbl	rval=0;
+LinkDataRec	ldr;
+
+	memset(&ldr,0,sizeof(ldr));
+
+	if ( !(f=fopen(path,"r")) || !(ldr.abfd=bfd_openstreamr(path,0,f)) )
+		goto cleanup;
+
+	/* ldr.abfd now holds the descriptor */
+	f=0;
+
+	if (    !bfd_check_format(ldr.abfd, bfd_object)
+	     || (sz=bfd_get_symtab_upper_bound(ldr.abfd)) <= 0
+	     || !(st=(asymbol**)malloc(sz))
+	     || bfd_canonicalize_symtab(ldr.abfd,st) <= 0 )
+		goto cleanup;
+
+	if ( (rval=localsExtract(&ldr, st)) )
+		rval=localsIndex(rval);
+
+cleanup:
+	free(st);
+	if (ldr.abfd)
+		bfd_close_all_done(ldr.abfd);
+	if (f)
+		fclose(f);
+	free(path);
+	return rval;
+}
+
 /* call this after relocation to assign the internal
  * symbol representation their values
  */
@@ -862,7 +970,7 @@ unsigned long vma;
 						 * in this slot with a new asymbol holding the
 						 * resolved value.
 						 */
-						sp=asymFromCexpSym(abfd,ts,ld->depend,mod);
+						sp=asymFromCexpSym(abfd,ts,ld,mod);
 					}
 					*ppsym  = sp;
 					symsect = bfd_get_section(*ppsym);
@@ -1050,7 +1158,7 @@ CexpModule	mod = ld->module;
  * dependencies
  */
 static asymbol *
-asymFromCexpSym(bfd *abfd, CexpSym csym, BitmapWord *depend, CexpModule mod)
+asymFromCexpSym(bfd *abfd, CexpSym csym, LinkData ld, CexpModule mod)
 {
 asymbol *sp = bfd_make_empty_symbol(abfd);
 	/* TODO: check size and alignment */
@@ -1060,9 +1168,11 @@ asymbol *sp = bfd_make_empty_symbol(abfd);
 	bfd_asymbol_set_value(sp, (symvalue)csym->value.ptv);
 	bfd_set_section(sp, bfd_abs_section_ptr);
 	sp->flags=BSF_GLOBAL;
-	/* mark the referenced module in the bitmap */
-	assert(mod->id < MAX_NUM_MODULES);
-	BITMAP_SET(depend,mod->id);
+	/* record the dependency on the referenced module */
+	if ( cexpModuleAddNeed(ld->module, mod) ) {
+		fprintf(stderr,"Unable to record dependency on '%s' (no memory)\n", mod->name);
+		ld->errors++;
+	}
 	return sp;
 }
 
@@ -1110,6 +1220,8 @@ asymbol		*sp;
 int			i,errs=0;
 
 	ld->num_new_commons = 0;
+	/* counts dependencies that couldn't be recorded */
+	ld->errors          = 0;
 
 	/* resolve undefined and common symbols;
 	 * find name clashes
@@ -1266,7 +1378,7 @@ int			i,errs=0;
 					errs++;
 				}
 				/* use existing value of common sym */
-				sp = asymFromCexpSym(abfd,ts,ld->depend,mod);
+				sp = asymFromCexpSym(abfd,ts,ld,mod);
 
 				syms[i]=sp; /* use new instance */
 			} else {
@@ -1282,7 +1394,7 @@ int			i,errs=0;
 			if (ts) {
 				if (sp->flags & BSF_WEAK) {
 					/* use existing instance */
-					sp=syms[i]=asymFromCexpSym(abfd,ts,ld->depend,mod);
+					sp=syms[i]=asymFromCexpSym(abfd,ts,ld,mod);
 				} else {
 					fprintf(stderr,"Symbol '%s' already exists",symname);
 					errs++;
@@ -1309,6 +1421,8 @@ int			i,errs=0;
 		}
 	}
 
+	errs += ld->errors;
+
 	return errs ? -errs : ld->num_new_commons;
 }
 
@@ -1483,7 +1597,10 @@ char	*start, *end;
 }
 
 
-/* the caller of this routine holds the module lock */ 
+/* The caller of this routine holds the load lock (loads are
+ * serialized) but, except for the system module, not the write
+ * lock; the modules we link against are pinned by the caller.
+ */
 int
 cexpLoadFile(const char *filename, CexpModule mod)
 {
@@ -1519,7 +1636,6 @@ CexpModule                      m;
 	 */
 	memset(&ldr,0,sizeof(ldr));
 
-	ldr.depend = mod->needs;
 	ldr.module = mod;
 
 	if ( (ldr.nsegs = cexpSegsInit(&ldr.segs)) < 1 ) {
@@ -1527,9 +1643,6 @@ CexpModule                      m;
 		goto cleanup;
 	}
 
-	/* basic check for our bitmaps */
-	assert( (1<<LD_WORDLEN) <= sizeof(BitmapWord)*8 );
-
 	if (!filename) {
 		fprintf(stderr,"Need filename arg\n");
 		goto cleanup;
@@ -1545,8 +1658,20 @@ CexpModule                      m;
 
 	/* lazy init of regexp pattern */
 	if (!ctorDtorRegexp)
-		ctorDtorRegexp=cexp_regcomp(CTOR_DTOR_PATTERN);
-
+		ctorDtorRegexp=SPENCER_(regcomp)(CTOR_DTOR_PATTERN);
+
+#ifdef HAVE_FMEMOPEN
+	/* read by cexpLoadFileScan() already (batch load) */
+	if ( mod->prefetch && mod->prefetch->image ) {
+		if ( (thename = strdup(mod->prefetch->path)) )
+			f = fmemopen(mod->prefetch->image, mod->prefetch->size, "r");
+		if ( ! f ) {
+			free(thename);
+			thename = 0;
+		}
+	}
+	if ( ! f )
+#endif
 	f = cexpSearchFile(getenv("PATH"), filename, &thename, tmpfname);
 
 	if ( !f ) {
@@ -1721,6 +1846,25 @@ if ( chunk ) memset(ldr.segs[i].chunk, 0xee,ldr.segs[i].size); /*TSILL*/
 	if ( cexpSymTabSetValues(ldr.cst) )
 		goto cleanup;
 
+	/* local symbols; the system symbol file is read again when they
+	 * are needed first (unless it is a temporary copy). Otherwise,
+	 * they must be extracted while we have the BFD; only the index
+	 * is built later.
+	 */
+	if ( !cexpSystemModule
+#ifdef __rtems__
+	     && !have_tmpf
+#endif
+	   ) {
+		char *lpath;
+		if ( (lpath=strdup(thename)) )
+			cexpSymTblSetLocals(ldr.cst, localsRead, free, lpath);
+	} else {
+		CexpSymTbl lcl;
+		if ( (lcl=localsExtract(&ldr, ldr.st)) )
+			cexpSymTblSetLocals(ldr.cst, localsIndex, localsRelease, lcl);
+	}
+
 	/* record the section names */
 	for ( psym = ldr.module->section_syms; *psym; psym++ ) {
 		CexpSym s, *tsym;
@@ -1893,6 +2037,138 @@ cleanup:
 	return rval;
 }
 
+#ifdef USE_PMBFD
+/* count (if the arrays are not allocated yet) or record
+ * a global symbol
+ */
+static void
+scanSym(CexpObjScan scan, int bind, unsigned shndx, const char *name, char **pstr, unsigned long *plen)
+{
+char **pp;
+
+	if ( STB_LOCAL == bind || ! *name )
+		return;
+
+	if ( SHN_UNDEF == shndx ) {
+		pp = scan->undf ? &scan->undf[scan->nundf] : 0;
+		scan->nundf++;
+	} else {
+		pp = scan->defd ? &scan->defd[scan->ndefd] : 0;
+		scan->ndefd++;
+	}
+
+	if ( pp ) {
+		*pp    = strcpy(*pstr, name);
+		*pstr += strlen(name) + 1;
+	} else {
+		*plen += strlen(name) + 1;
+	}
+}
+
+#define SCAN_CHUNK	65536
+
+/* pmelf (unlike BFD) may be used by several threads; the whole
+ * file is read so that cexpLoadFile() can use it, too.
+ */
+int
+cexpLoadFileScan(const char *filename, CexpObjScan scan)
+{
+Elf_Stream		elf    = 0;
+Elf_Ehdr		ehdr;
+Pmelf_Shtab		shtab  = 0;
+Pmelf_Symtab	symtab = 0;
+FILE			*f     = 0;
+char			*str   = 0, *buf;
+unsigned long	i, len = 0, got, avail = 0;
+int				pass, rval = -1;
+
+	memset(scan, 0, sizeof(*scan));
+
+	if ( ! (f = cexpSearchFile(getenv("PATH"), filename, &scan->path, 0)) )
+		goto cleanup;
+
+	do {
+		if ( ! avail ) {
+			if ( ! (buf = realloc(scan->image, scan->size + SCAN_CHUNK)) )
+				goto cleanup;
+			scan->image = buf;
+			avail       = SCAN_CHUNK;
+		}
+		got          = fread((char*)scan->image + scan->size, 1, avail, f);
+		scan->size  += got;
+		avail       -= got;
+	} while ( got > 0 );
+
+	if ( ferror(f) || ! (elf = pmelf_memstrm(scan->image, scan->size)) )
+		goto cleanup;
+
+	if (    pmelf_getehdr(elf, &ehdr)
+	     || ! (shtab  = pmelf_getshtab(elf, &ehdr))
+	     || ! (symtab = pmelf_getsymtab(elf, shtab)) )
+		goto cleanup;
+
+	for ( pass = 0; pass < 2; pass++ ) {
+		if ( pass ) {
+			if ( ! (scan->mem = malloc((scan->ndefd + scan->nundf) * sizeof(char*) + len + 1)) )
+				goto cleanup;
+			scan->defd  = scan->mem;
+			scan->undf  = scan->defd + scan->ndefd;
+			str         = (char*)(scan->undf + scan->nundf);
+			scan->ndefd = 0;
+			scan->nundf = 0;
+		}
+		for ( i = 0; i < symtab->nsyms; i++ ) {
+			if ( ELFCLASS64 == ehdr.e_ident[EI_CLASS] ) {
+				Elf64_Sym *sp = &symtab->syms.p_t64[i];
+				scanSym(scan, ELF64_ST_BIND(sp->st_info), sp->st_shndx, symtab->strtab + sp->st_name, &str, &len);
+			} else {
+				Elf32_Sym *sp = &symtab->syms.p_t32[i];
+				scanSym(scan, ELF32_ST_BIND(sp->st_info), sp->st_shndx, symtab->strtab + sp->st_name, &str, &len);
+			}
+		}
+	}
+
+	rval = 0;
+
+cleanup:
+	if ( rval ) {
+		free(scan->mem);
+		free(scan->image);
+		free(scan->path);
+		memset(scan, 0, sizeof(*scan));
+	}
+	pmelf_delsymtab(symtab);
+	pmelf_delshtab(shtab);
+	pmelf_delstrm(elf,0);
+	if ( f )
+		fclose(f);
+	return rval;
+}
+#else
+/* BFD cannot be used by several threads */
+int
+cexpLoadFileScan(const char *filename, CexpObjScan scan)
+{
+	memset(scan, 0, sizeof(*scan));
+	return -1;
+}
+#endif
+
+/* the system symbol table is read from a file or built in;
+ * no shared library modules are created.
+ */
+int
+cexpLoadFileChanged(void)
+{
+	return 0;
+}
+
+int
+cexpLoadFileRescan(CexpModule mod)
+{
+	return 0;
+}
+
 static void
 bfdstuff_complete_init(CexpSymTbl cst)
 {
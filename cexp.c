@@ -331,10 +331,11 @@ cexp_regex	*rc=arg;
 int
 lkup(const char *re)
 {
-extern	CexpSym _cexpSymLookupRegex();
+extern	CexpSym _cexpSymLookupRegexSnap();
 cexp_regex		*rc=0;
 CexpSym 		s;
-CexpModule		m;
+CexpModSnap		snap;
+int				idx;
 int				ch=0,tsaved=0;
 int				nl;
 struct termios	tatts,rawatts;
@@ -347,8 +348,20 @@ struct winsize	win;
 		return -1;
 	}
 
-	/* TODO should acquire the module readlock around this ?? */
-	for (s=0,m=0; !ch ;) {
+	/* list libraries dlopen()ed meanwhile, too */
+	cexpModuleRescan();
+
+	/* pin the modules while paging; this doesn't hold up loading
+	 * and the tables we're looking at remain valid if the modules
+	 * are unloaded meanwhile.
+	 */
+	if (!(snap=cexpModuleSnapshot())) {
+		fprintf(stderr,"no memory for module snapshot\n");
+		cexp_regfree(rc);
+		return -1;
+	}
+
+	for (s=0,idx=0; !ch ;) {
 		unsigned char ans;
 
 #ifdef HAVE_TECLA
@@ -368,7 +381,7 @@ struct winsize	win;
 
 		nl--;
 
-		if (!(s=_cexpSymLookupRegex(rc,&nl,s,stdout,&m)))
+		if (!(s=_cexpSymLookupRegexSnap(rc,&nl,s,stdout,snap,&idx)))
 			break;
 
 		if (!tsaved) {
@@ -390,6 +403,8 @@ struct winsize	win;
 		if (tsaved>0)
 			tcsetattr(STDIN_FD,TCSANOW,&tatts);
 	}
+	cexpModuleSnapshotRelease(snap);
+
 	printf("\nUSER VARIABLES:\n");
 	cexpVarWalk(varprint,(void*)rc);
 
@@ -109,15 +109,102 @@ cexpModuleLoad(const char *file_name, const char *module_name);
 int
 cexpModuleUnload(CexpModule moduleHandle);
 
+/* A module handle is the address of the module; one which is
+ * kept after the module was unloaded may refer to a newer module
+ * which got the same memory. A module's ID (a serial number)
+ * is never reused; use it to refer to a module which may be
+ * unloaded meanwhile.
+ *
+ * RETURNS: ID of a loaded module, 0 if 'mod' isn't loaded.
+ */
+unsigned long
+cexpModuleId(CexpModule mod);
+
+/* RETURNS: module with ID 'id', NULL if it isn't (or no longer) loaded */
+CexpModule
+cexpModuleFindById(unsigned long id);
+
+/* unload the module with ID 'id' */
+int
+cexpModuleUnloadId(unsigned long id);
+
+/* load 'n' object files; 'module_names' may be 0 or contain
+ * NULL entries (the file names are used then).
+ * The files are read (in parallel if supported) to find the
+ * symbols they define and need; each is then linked (one after
+ * the other, from the contents read) after the ones it depends
+ * on (which need not be listed first). Files whose dependencies
+ * fail to load are skipped.
+ * The batch is not atomic: the load lock is held throughout (no
+ * other load interleaves) but each module is entered on its own
+ * (write lock, publication, constructors) once it is linked since
+ * the next file is linked against it. Lookups and snapshots in
+ * other threads may see part of the batch; unloads and library
+ * rescans may happen between two of its modules.
+ *
+ * RETURNS: number of modules loaded
+ */
+int
+cexpModuleLoadList(int n, const char **file_names, const char **module_names);
+
+/* same as cexpModuleLoadList() for the files listed in 'manifest';
+ * one file name, optionally followed by a module name, per line.
+ * '#' starts a comment.
+ *
+ * RETURNS: number of modules loaded, -1 on error
+ */
+int
+cexpModuleLoadManifest(const char *manifest);
+
+/* bring the modules the symbol file loader created for shared
+ * libraries up to date, i.e., add libraries which were dlopen()ed
+ * and drop the ones which were dlclose()d since. This is done
+ * automatically when a lookup by name or address finds nothing
+ * (or no module covers the address; the parser doesn't for names
+ * of user variables) and by the interactive listings; cexpModuleSnapshot() doesn't, i.e., call this first
+ * if the snapshot should include libraries dlopen()ed meanwhile.
+ *
+ * RETURNS: number of modules added or dropped, -1 on error
+ */
+int
+cexpModuleRescan(void);
+
 /* return a module's name (string owned by module code) */
 const char *
 cexpModuleName(CexpModule mod);
 
+/* Take a snapshot of the list of modules; this pins the
+ * modules, i.e., while the snapshot is held, their names and
+ * symbol tables remain valid even if they are unloaded (the
+ * unloaded module's memory is cleared, however). Modules are
+ * loaded and unloaded as usual; releasing the snapshot frees
+ * what was unloaded meanwhile.
+ * Cheap (one atomic increment per module); use it for long
+ * listings, e.g., when printing to a slow device.
+ *
+ * RETURNS: snapshot or NULL (no memory).
+ */
+typedef struct CexpModSnapRec_	*CexpModSnap;
+
+CexpModSnap
+cexpModuleSnapshot(void);
+
+/* RETURNS: i-th module of a snapshot; NULL if 'i' is out of range */
+CexpModule
+cexpModSnapModule(CexpModSnap snap, int i);
+
+void
+cexpModuleSnapshotRelease(CexpModSnap snap);
+
 #define CEXP_FILE_QUIET ((FILE*) -1 )
 
 /* list the IDs of modules whose name matches a pattern
  * to file 'f' (stdout if NULL, quiet if FILE_QUIET).
  *
+ * A pattern of the form "^name$" (no other special characters)
+ * is looked up in a hash table rather than matched against all
+ * module names.
+ *
  * RETURNS: First module ID found, NULL on no match.
  */
 CexpModule
@@ -177,6 +264,20 @@ cexpSymLookup(const char *name, CexpModule *pmod);
 CexpSym
 cexpSymLkAddr(void *addr, int margin, FILE *f, CexpModule *pmod);
 
+/* Look up 'n' addresses at once (e.g., to symbolize a trace).
+ * The symbol closest to (at or below) addr[i] is stored in
+ * syms[i] (NULL if there is none), its module in mods[i] and
+ * the distance from the symbol's value in offs[i]. 'mods' and
+ * 'offs' may be NULL.
+ *
+ * The addresses are sorted and each module's address index
+ * is walked once, with the module list locked only once.
+ *
+ * RETURNS: number of addresses resolved; -1 if out of memory.
+ */
+int
+cexpSymLkAddrBatch(void **addr, int n, CexpSym *syms, CexpModule *mods, unsigned long *offs);
+
 /* Symbol value/name access */
 const char *
 cexpSymName(CexpSym sym);
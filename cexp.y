@@ -97,8 +97,21 @@ static void wrnmsg(CexpParserCtx ctx, const char *msg, ...);
 
 int  yylex();
 
+/* cexpSymLookup() without checking for new libraries if 'rescan' is 0 */
+extern CexpSym _cexpSymLookup(const char *name, CexpModule *pmod, int rescan);
+
 typedef char *LString;
 
+/* identifiers resolved recently; valid as long as
+ * cexpSymGeneration does not change.
+ */
+#define IDENT_CACHE_SIZE	64	/* must be a power of two */
+
+typedef struct IdentCacheRec_ {
+	CexpSym			sym;
+	int				uvar;		/* a user variable */
+} IdentCacheRec, *IdentCache;
+
 struct CexpParserCtxRec_;
 
 typedef void (*RedirCb)(struct CexpParserCtxRec_ *, void *);
@@ -120,6 +133,8 @@ typedef struct CexpParserCtxRec_ {
 	FILE            *o_errf;
 	RedirCb         redir_cb;
 	void            *cb_arg;
+	unsigned long   identGen;       /* cexpSymGeneration the cache is valid for */
+	IdentCacheRec   identCache[IDENT_CACHE_SIZE];
 } CexpParserCtxRec;
 
 static CexpSym
@@ -718,12 +733,98 @@ int hasE=0;
 	return *chpt ? LEXERR : NUMBER;
 }
 
+/* look an identifier up in the modules and the user variables;
+ * the result is remembered (no locking or searching if the same
+ * identifier is used again).
+ */
+static CexpSym
+identLookup(CexpParserCtx ctx, const char *name, int *puvar)
+{
+unsigned long		gen = cexpSymGeneration;
+unsigned long		h;
+const unsigned char	*p;
+IdentCache			c;
+CexpSym				rval;
+
+	if ( gen != ctx->identGen ) {
+		memset(ctx->identCache, 0, sizeof(ctx->identCache));
+		ctx->identGen = gen;
+	}
+
+	for ( h = 0, p = (const unsigned char*)name; *p; p++ )
+		h = 31*h + *p;
+
+	c = &ctx->identCache[ h & (IDENT_CACHE_SIZE - 1) ];
+
+	if ( c->sym && !strcmp(c->sym->name, name) ) {
+		*puvar = c->uvar;
+		return c->sym;
+	}
+
+	/* a user variable is a miss in the modules; checking for
+	 * libraries dlopen()ed meanwhile (which takes the run-time
+	 * linker's lock) is left to names which are no variable either.
+	 */
+	if ( (rval=_cexpSymLookup(name, 0, 0)) ) {
+		*puvar = 0;
+	} else if ( (rval=cexpVarLookup(name, 0)) ) {
+		*puvar = 1;
+		/* this is the result of whatever context is current */
+		if ( !strcmp(name, CEXP_LAST_RESULT_VAR_NAME) )
+			return rval;
+	} else if ( (rval=cexpSymLookup(name, 0)) ) {
+		*puvar = 0;
+	} else {
+		/* not cached; it might show up in a library loaded meanwhile */
+		return 0;
+	}
+
+	c->sym  = rval;
+	c->uvar = *puvar;
+
+	return rval;
+}
+
+/* A symbol name in single quotes may contain any characters but
+ * the quote, e.g., a demangled C++ name: 'ns::Foo::bar(int)'.
+ * The current char is the first one of the name.
+ */
+static int
+quotedName(YYSTYPE *rval, CexpParserCtx pa)
+{
+const char	*nameStart = pa->chpt;
+char		*chpt      = pa->sbuf;
+int			limit      = sizeof(pa->sbuf)-1;
+int			uvar;
+
+	while (ch && '\''!=ch) {
+		if (--limit <= 0)
+			return prerr(pa);
+		*(chpt++)=ch;
+		getch();
+	}
+	*chpt=0;
+
+	/* unterminated; the caller may want to complete it */
+	if (!ch)
+		return LEXERR_INCOMPLETE_STRING - (pa->chpt - nameStart);
+
+	getch();
+
+	if (!(rval->sym=identLookup(pa, pa->sbuf, &uvar))) {
+		errmsg(pa, "(yylex): unknown symbol '%s'\n", pa->sbuf);
+		return LEXERR;
+	}
+	return uvar ? UVAR : (CEXP_TYPE_FUNQ(rval->sym->value.type) ? FUNC : VAR);
+}
+
 int
 yylex(YYSTYPE *rval, CexpParserCtx pa)
 {
 unsigned long num;
 int           limit=sizeof(pa->sbuf)-1;
 char          *chpt;
+int           uvar;
 
 	while (' '==ch || '\t'==ch)
 		getch();
@@ -752,6 +853,9 @@ char          *chpt;
 						num=ch;
 					break;
 				}
+			} else if (ch && '\'' != pa->chpt[1] && '\n' != pa->chpt[1] && pa->chpt[1]) {
+				/* more than one char; it's a quoted symbol name */
+				return quotedName(rval, pa);
 			}
 			getch();
 			if ('\''!=ch)
@@ -834,11 +938,8 @@ char          *chpt;
 			return KW_FLOAT;
 		else if (!strcmp(pa->sbuf,"double"))
 			return KW_DOUBLE;
-		else if ((rval->sym=cexpSymLookup(pa->sbuf, 0)))
-			return CEXP_TYPE_FUNQ(rval->sym->value.type) ? FUNC : VAR;
-		else if ((rval->sym=cexpVarLookup(pa->sbuf,0))) {
-			return UVAR;
-		}
+		else if ((rval->sym=identLookup(pa, pa->sbuf, &uvar)))
+			return uvar ? UVAR : (CEXP_TYPE_FUNQ(rval->sym->value.type) ? FUNC : VAR);
 
 		/* it's a currently undefined symbol */
 		return (rval->lstr=lstAddString(pa,pa->sbuf)) ? IDENT : LEXERR;
@@ -978,7 +1079,7 @@ CexpParserCtx	ctx=0;
 	ctx->rval_sym.name       = CEXP_LAST_RESULT_VAR_NAME;
 	ctx->rval_sym.size       = sizeof(ctx->rval);
 	ctx->rval_sym.flags      = 0;
-	ctx->rval_sym.help       = "value of last evaluated expression";
+	cexpSymSetHelp(&ctx->rval_sym, "value of last evaluated expression", 0);
 	ctx->outf                = outf;
 	ctx->errf                = errf;
 	ctx->status              = -1;
@@ -1008,6 +1109,7 @@ cexpFreeParserCtx(CexpParserCtx ctx)
 {
 	cexpUnredir(ctx);
 	releaseStrings(ctx);
+	cexpSymDropHelp(&ctx->rval_sym);
 	free(ctx);
 }
 
@@ -0,0 +1,549 @@
+/* $Id$ */
+
+/* Lazy DFA for matching (Spencer/egrep style) regular expressions
+ * against symbol names.
+ */
+
+/* SLAC Software Notices, Set 4 OTT.002a, 2004 FEB 03
+ *
+ * Authorship
+ * ----------
+ * This software (CEXP - C-expression interpreter and runtime
+ * object loader/linker) was created by
+ *
+ *    Till Straumann <strauman@slac.stanford.edu>, 2002-2008,
+ * 	  Stanford Linear Accelerator Center, Stanford University.
+ *
+ * Acknowledgement of sponsorship
+ * ------------------------------
+ * This software was produced by
+ *     the Stanford Linear Accelerator Center, Stanford University,
+ * 	   under Contract DE-AC03-76SFO0515 with the Department of Energy.
+ * 
+ * Government disclaimer of liability
+ * ----------------------------------
+ * Neither the United States nor the United States Department of Energy,
+ * nor any of their employees, makes any warranty, express or implied, or
+ * assumes any legal liability or responsibility for the accuracy,
+ * completeness, or usefulness of any data, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately owned
+ * rights.
+ * 
+ * Stanford disclaimer of liability
+ * --------------------------------
+ * Stanford University makes no representations or warranties, express or
+ * implied, nor assumes any liability for the use of this software.
+ * 
+ * Stanford disclaimer of copyright
+ * --------------------------------
+ * Stanford University, owner of the copyright, hereby disclaims its
+ * copyright and all other rights in this software.  Hence, anyone may
+ * freely use it for any purpose without restriction.  
+ * 
+ * Maintenance of notices
+ * ----------------------
+ * In the interest of clarity regarding the origin and status of this
+ * SLAC software, this and all the preceding Stanford University notices
+ * are to remain affixed to any copy or derivative of this software made
+ * or distributed by the recipient and are to be affixed to any copy of
+ * software made or distributed by the recipient that contains a copy or
+ * derivative of this software.
+ * 
+ * SLAC Software Notices, Set 4 OTT.002a, 2004 FEB 03
+ */ 
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "cexp_dfa.h"
+
+/* max. number of cached DFA states (each one takes ~1k) */
+#define DFA_MAX_STATES	64
+
+/* NFA state types */
+#define N_CHAR		0	/* consume a character in 'set'               */
+#define N_SPLIT		1	/* epsilon transitions to 'out' and 'out1'    */
+#define N_EPS		2	/* epsilon transition to 'out'                */
+#define N_BOL		3	/* epsilon transition at the start of string  */
+#define N_EOL		4	/* epsilon transition at the end of string    */
+#define N_MATCH		5
+
+#define SET_SET(s,c)	((s)[(c)>>5] |=  (1U << ((c) & 31)))
+#define SET_TST(s,c)	((s)[(c)>>5] &   (1U << ((c) & 31)))
+
+typedef struct NStateRec_ {
+	int			type;
+	int			out, out1;
+	uint32_t	set[8];
+} NStateRec, *NState;
+
+typedef struct DStateRec_ {
+	int			next[256];	/* -1 if not computed yet                    */
+	int			accept;		/* holds N_MATCH                             */
+	int			acceptEol;	/* N_MATCH reachable at the end of string    */
+	int			atStart;	/* start state; '^' may still match           */
+	int			n;
+	int			nst[1];		/* sorted NFA states (N_CHAR, N_EOL, N_MATCH) */
+} DStateRec, *DState;
+
+struct CexpDfaRec_ {
+	NState		ns;
+	int			nns, nsz;
+	int			start;
+	DState		ds[DFA_MAX_STATES];
+	int			nds;
+	int			*stack, *list;	/* scratch space */
+	unsigned	*mark, gen;
+	const char	*p;				/* parser position */
+	int			err;
+};
+
+/* fragment of the NFA under construction; 'end' is an N_EPS
+ * state whose 'out' is yet to be connected.
+ */
+typedef struct FragRec_ {
+	int			start, end;
+} FragRec;
+
+static int
+newState(CexpDfa d, int type, int out, int out1)
+{
+NState n;
+
+	if ( d->nns >= d->nsz ) {
+		if ( ! (n = realloc(d->ns, 2 * d->nsz * sizeof(*n))) ) {
+			d->err = 1;
+			return -1;
+		}
+		d->ns   = n;
+		d->nsz *= 2;
+	}
+	n = &d->ns[d->nns];
+	memset(n, 0, sizeof(*n));
+	n->type = type;
+	n->out  = out;
+	n->out1 = out1;
+	return d->nns++;
+}
+
+/* a new fragment consisting of a single state of 'type' */
+static FragRec
+newFrag(CexpDfa d, int type)
+{
+FragRec f;
+
+	f.end   = newState(d, N_EPS, -1, -1);
+	f.start = newState(d, type, f.end, -1);
+	return f;
+}
+
+static FragRec parseAlt(CexpDfa d);
+
+static FragRec
+parseAtom(CexpDfa d)
+{
+FragRec	f;
+int		c, lo, hi, neg, i;
+
+	f.start = f.end = -1;
+
+	switch ( (c = (unsigned char)*d->p) ) {
+		case 0: case '|': case ')':
+		case '*': case '+': case '?':
+			d->err = 1;
+			return f;
+
+		case '(':
+			d->p++;
+			f = parseAlt(d);
+			if ( d->err || ')' != *d->p ) {
+				d->err = 1;
+				return f;
+			}
+			d->p++;
+			return f;
+
+		case '^':
+			d->p++;
+			return newFrag(d, N_BOL);
+
+		case '$':
+			d->p++;
+			return newFrag(d, N_EOL);
+
+		default:
+			break;
+	}
+
+	f = newFrag(d, N_CHAR);
+	if ( d->err )
+		return f;
+
+	switch ( c ) {
+		case '.':
+			for ( i=1; i<256; i++ )
+				SET_SET(d->ns[f.start].set, i);
+			d->p++;
+		break;
+
+		case '\\':
+			if ( ! (c = (unsigned char)d->p[1]) ) {
+				d->err = 1;
+				return f;
+			}
+			SET_SET(d->ns[f.start].set, c);
+			d->p += 2;
+		break;
+
+		case '[':
+			d->p++;
+			if ( (neg = ('^' == *d->p)) )
+				d->p++;
+			if ( ']' == *d->p || '-' == *d->p ) {
+				SET_SET(d->ns[f.start].set, (unsigned char)*d->p);
+				d->p++;
+			}
+			while ( *d->p && ']' != *d->p ) {
+				if ( '-' == *d->p ) {
+					d->p++;
+					if ( ']' == *d->p ) {
+						SET_SET(d->ns[f.start].set, '-');
+					} else {
+						/* range; the start has been added already */
+						lo = (unsigned char)d->p[-2];
+						hi = (unsigned char)d->p[0];
+						if ( lo > hi + 1 ) {
+							d->err = 1;
+							return f;
+						}
+						for ( i = lo + 1; i <= hi; i++ )
+							SET_SET(d->ns[f.start].set, i);
+						d->p++;
+					}
+				} else {
+					SET_SET(d->ns[f.start].set, (unsigned char)*d->p);
+					d->p++;
+				}
+			}
+			if ( ! *d->p ) {
+				d->err = 1;
+				return f;
+			}
+			d->p++;
+			if ( neg ) {
+				for ( i=0; i<8; i++ )
+					d->ns[f.start].set[i] = ~d->ns[f.start].set[i];
+			}
+			/* never matches the terminating NUL */
+			d->ns[f.start].set[0] &= ~1U;
+		break;
+
+		default:
+			SET_SET(d->ns[f.start].set, c);
+			d->p++;
+		break;
+	}
+	return f;
+}
+
+static FragRec
+parsePiece(CexpDfa d)
+{
+FragRec	f;
+int		s, e;
+char	q;
+
+	f = parseAtom(d);
+
+	while ( ! d->err && ( '*' == (q = *d->p) || '+' == q || '?' == q ) ) {
+		d->p++;
+		e = newState(d, N_EPS,   -1,      -1);
+		s = newState(d, N_SPLIT, f.start, e);
+		if ( d->err )
+			break;
+		switch ( q ) {
+			case '*':	/* loop back to 's'; can skip */
+				d->ns[f.end].out = s;
+				f.start          = s;
+			break;
+
+			case '+':	/* loop back to 's'; cannot skip */
+				d->ns[f.end].out = s;
+			break;
+
+			default:	/* can skip */
+				d->ns[f.end].out = e;
+				f.start          = s;
+			break;
+		}
+		f.end = e;
+	}
+	return f;
+}
+
+static FragRec
+parseBranch(CexpDfa d)
+{
+FragRec	f, g;
+
+	/* may be empty */
+	f.start = f.end = newState(d, N_EPS, -1, -1);
+
+	while ( ! d->err && *d->p && '|' != *d->p && ')' != *d->p ) {
+		g = parsePiece(d);
+		if ( d->err )
+			break;
+		d->ns[f.end].out = g.start;
+		f.end            = g.end;
+	}
+	return f;
+}
+
+static FragRec
+parseAlt(CexpDfa d)
+{
+FragRec	f, g;
+int		s, e;
+
+	f = parseBranch(d);
+
+	while ( ! d->err && '|' == *d->p ) {
+		d->p++;
+		g = parseBranch(d);
+		e = newState(d, N_EPS,   -1,      -1);
+		s = newState(d, N_SPLIT, f.start, g.start);
+		if ( d->err )
+			break;
+		d->ns[f.end].out = e;
+		d->ns[g.end].out = e;
+		f.start          = s;
+		f.end            = e;
+	}
+	return f;
+}
+
+static void
+newGen(CexpDfa d)
+{
+	if ( 0 == ++d->gen ) {
+		memset(d->mark, 0, d->nns * sizeof(*d->mark));
+		d->gen = 1;
+	}
+}
+
+/* append the epsilon closure of 'i' to d->list[*pn]; only
+ * states not seen yet in the current generation are added.
+ */
+static void
+closure(CexpDfa d, int i, int atStart, int atEnd, int *pn)
+{
+int sp = 0;
+
+	d->stack[sp++] = i;
+
+	while ( sp > 0 ) {
+		if ( (i = d->stack[--sp]) < 0 || d->gen == d->mark[i] )
+			continue;
+		d->mark[i] = d->gen;
+		switch ( d->ns[i].type ) {
+			case N_SPLIT:
+				d->stack[sp++] = d->ns[i].out1;
+				d->stack[sp++] = d->ns[i].out;
+			break;
+
+			case N_EPS:
+				d->stack[sp++] = d->ns[i].out;
+			break;
+
+			case N_BOL:
+				if ( atStart )
+					d->stack[sp++] = d->ns[i].out;
+			break;
+
+			case N_EOL:
+				if ( atEnd )
+					d->stack[sp++] = d->ns[i].out;
+				else
+					d->list[(*pn)++] = i;
+			break;
+
+			default:
+				d->list[(*pn)++] = i;
+			break;
+		}
+	}
+}
+
+/* find or create the DFA state for the set of 'n' NFA
+ * states in d->list.
+ * RETURNS: index of the DFA state or -1 if the cache is full.
+ */
+static int
+dstate(CexpDfa d, int n, int atStart)
+{
+DState	s;
+int		i, j, k, m;
+
+	/* sort; sets are small */
+	for ( i = 1; i < n; i++ ) {
+		k = d->list[i];
+		for ( j = i; j > 0 && d->list[j-1] > k; j-- )
+			d->list[j] = d->list[j-1];
+		d->list[j] = k;
+	}
+
+	for ( i = 0; i < d->nds; i++ ) {
+		if ( d->ds[i]->n == n && d->ds[i]->atStart == atStart && ! memcmp(d->ds[i]->nst, d->list, n * sizeof(*d->list)) )
+			return i;
+	}
+
+	if ( d->nds >= DFA_MAX_STATES )
+		return -1;
+
+	if ( ! (s = malloc(sizeof(*s) + n * sizeof(s->nst[0]))) )
+		return -1;
+
+	memset(s->next, 0xff, sizeof(s->next));
+	memcpy(s->nst, d->list, n * sizeof(*d->list));
+	s->n         = n;
+	s->accept    = 0;
+	s->acceptEol = 0;
+	s->atStart   = atStart;
+
+	for ( i = 0; i < n; i++ ) {
+		if ( N_MATCH == d->ns[s->nst[i]].type )
+			s->accept = s->acceptEol = 1;
+	}
+
+	if ( ! s->accept ) {
+		/* could we get to N_MATCH if the string ended here ? */
+		newGen(d);
+		for ( i = 0, m = 0; i < n; i++ ) {
+			if ( N_EOL == d->ns[s->nst[i]].type )
+				closure(d, d->ns[s->nst[i]].out, atStart, 1, &m);
+		}
+		for ( i = 0; i < m; i++ ) {
+			if ( N_MATCH == d->ns[d->list[i]].type )
+				s->acceptEol = 1;
+		}
+	}
+
+	d->ds[d->nds] = s;
+	return d->nds++;
+}
+
+/* compute the transition from DFA state 'from' on 'c' */
+static int
+dstep(CexpDfa d, int from, int c)
+{
+DState	s = d->ds[from];
+int		i, k, n = 0;
+
+	newGen(d);
+
+	for ( i = 0; i < s->n; i++ ) {
+		k = s->nst[i];
+		if ( N_CHAR == d->ns[k].type && SET_TST(d->ns[k].set, c) )
+			closure(d, d->ns[k].out, 0, 0, &n);
+	}
+
+	/* search: a match may start at any position */
+	closure(d, d->start, 0, 0, &n);
+
+	if ( (k = dstate(d, n, 0)) >= 0 )
+		s->next[c] = k;
+
+	return k;
+}
+
+CexpDfa
+cexpDfaCompile(const char *expr)
+{
+CexpDfa	d;
+FragRec	f;
+int		n;
+
+	if ( ! (d = calloc(1, sizeof(*d))) )
+		return 0;
+
+	d->nsz = 16;
+	if ( ! (d->ns = malloc(d->nsz * sizeof(*d->ns))) )
+		goto bail;
+
+	d->p = expr;
+	f    = parseAlt(d);
+
+	/* leftover ')' */
+	if ( d->err || *d->p )
+		goto bail;
+
+	n        = newState(d, N_MATCH, -1, -1);
+	d->start = f.start;
+
+	if ( d->err )
+		goto bail;
+
+	d->ns[f.end].out = n;
+
+	/* every state is pushed at most once per edge leading to it */
+	if (   ! (d->stack = malloc( 2 * d->nns * sizeof(*d->stack) ))
+	    || ! (d->list  = malloc(     d->nns * sizeof(*d->list)  ))
+	    || ! (d->mark  = calloc(     d->nns,  sizeof(*d->mark)  )) )
+		goto bail;
+
+	/* the start state is always ds[0] */
+	newGen(d);
+	n = 0;
+	closure(d, d->start, 1, 0, &n);
+	if ( 0 != dstate(d, n, 1) )
+		goto bail;
+
+	return d;
+
+bail:
+	cexpDfaFree(d);
+	return 0;
+}
+
+int
+cexpDfaExec(CexpDfa d, const char *str)
+{
+const unsigned char	*p = (const unsigned char*)str;
+DState				s;
+int					cur = 0, nxt;
+
+	for ( ;; ) {
+		s = d->ds[cur];
+		if ( s->accept )
+			return 1;
+		if ( ! *p )
+			return s->acceptEol;
+		if ( 0 == s->n )
+			return 0;
+		if ( (nxt = s->next[*p]) < 0 && (nxt = dstep(d, cur, *p)) < 0 )
+			return -1;
+		cur = nxt;
+		p++;
+	}
+}
+
+void
+cexpDfaFree(CexpDfa d)
+{
+int i;
+
+	if ( d ) {
+		for ( i = 0; i < d->nds; i++ )
+			free(d->ds[i]);
+		free(d->ns);
+		free(d->stack);
+		free(d->list);
+		free(d->mark);
+		free(d);
+	}
+}
@@ -0,0 +1,99 @@
+/* $Id$ */
+
+/* Lazy DFA for matching (Spencer/egrep style) regular expressions
+ * against symbol names.
+ */
+
+/* SLAC Software Notices, Set 4 OTT.002a, 2004 FEB 03
+ *
+ * Authorship
+ * ----------
+ * This software (CEXP - C-expression interpreter and runtime
+ * object loader/linker) was created by
+ *
+ *    Till Straumann <strauman@slac.stanford.edu>, 2002-2008,
+ * 	  Stanford Linear Accelerator Center, Stanford University.
+ *
+ * Acknowledgement of sponsorship
+ * ------------------------------
+ * This software was produced by
+ *     the Stanford Linear Accelerator Center, Stanford University,
+ * 	   under Contract DE-AC03-76SFO0515 with the Department of Energy.
+ * 
+ * Government disclaimer of liability
+ * ----------------------------------
+ * Neither the United States nor the United States Department of Energy,
+ * nor any of their employees, makes any warranty, express or implied, or
+ * assumes any legal liability or responsibility for the accuracy,
+ * completeness, or usefulness of any data, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately owned
+ * rights.
+ * 
+ * Stanford disclaimer of liability
+ * --------------------------------
+ * Stanford University makes no representations or warranties, express or
+ * implied, nor assumes any liability for the use of this software.
+ * 
+ * Stanford disclaimer of copyright
+ * --------------------------------
+ * Stanford University, owner of the copyright, hereby disclaims its
+ * copyright and all other rights in this software.  Hence, anyone may
+ * freely use it for any purpose without restriction.  
+ * 
+ * Maintenance of notices
+ * ----------------------
+ * In the interest of clarity regarding the origin and status of this
+ * SLAC software, this and all the preceding Stanford University notices
+ * are to remain affixed to any copy or derivative of this software made
+ * or distributed by the recipient and are to be affixed to any copy of
+ * software made or distributed by the recipient that contains a copy or
+ * derivative of this software.
+ * 
+ * SLAC Software Notices, Set 4 OTT.002a, 2004 FEB 03
+ */ 
+
+#ifndef CEXP_DFA_H
+#define CEXP_DFA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The expression is translated into an NFA (Thompson construction)
+ * and DFA states are created on demand while strings are scanned,
+ * i.e., every character of a string is looked at exactly once
+ * and there is no backtracking.
+ *
+ * Supported syntax (that of Spencer's regexp):
+ *   c  \c  .  [set]  [^set]  ( )  |  *  +  ?  ^  $
+ *
+ * A match is searched anywhere in the string (unless anchored
+ * by '^'); only a boolean result is produced (no submatches).
+ *
+ * NOTE: cexpDfaExec() modifies the DFA (state cache); a DFA
+ *       must not be used by several threads at the same time
+ *       (as is the case for Spencer's regexp).
+ */
+typedef struct CexpDfaRec_ *CexpDfa;
+
+/* RETURNS: DFA or NULL if the expression cannot be parsed (or
+ *          no memory).
+ */
+CexpDfa
+cexpDfaCompile(const char *expr);
+
+/* RETURNS: 1 if 'str' matches, 0 if not and -1 if the state cache
+ *          is exhausted (the caller must use a different engine
+ *          for this string).
+ */
+int
+cexpDfaExec(CexpDfa dfa, const char *str);
+
+void
+cexpDfaFree(CexpDfa dfa);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
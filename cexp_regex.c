@@ -0,0 +1,254 @@
+/* $Id$ */
+
+/* Regular expression wrapper; extracts literals from the pattern
+ * which allow for narrowing symbol table searches.
+ */
+
+/* SLAC Software Notices, Set 4 OTT.002a, 2004 FEB 03
+ *
+ * Authorship
+ * ----------
+ * This software (CEXP - C-expression interpreter and runtime
+ * object loader/linker) was created by
+ *
+ *    Till Straumann <strauman@slac.stanford.edu>, 2002-2008,
+ * 	  Stanford Linear Accelerator Center, Stanford University.
+ *
+ * Acknowledgement of sponsorship
+ * ------------------------------
+ * This software was produced by
+ *     the Stanford Linear Accelerator Center, Stanford University,
+ * 	   under Contract DE-AC03-76SFO0515 with the Department of Energy.
+ * 
+ * Government disclaimer of liability
+ * ----------------------------------
+ * Neither the United States nor the United States Department of Energy,
+ * nor any of their employees, makes any warranty, express or implied, or
+ * assumes any legal liability or responsibility for the accuracy,
+ * completeness, or usefulness of any data, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately owned
+ * rights.
+ * 
+ * Stanford disclaimer of liability
+ * --------------------------------
+ * Stanford University makes no representations or warranties, express or
+ * implied, nor assumes any liability for the use of this software.
+ * 
+ * Stanford disclaimer of copyright
+ * --------------------------------
+ * Stanford University, owner of the copyright, hereby disclaims its
+ * copyright and all other rights in this software.  Hence, anyone may
+ * freely use it for any purpose without restriction.  
+ * 
+ * Maintenance of notices
+ * ----------------------
+ * In the interest of clarity regarding the origin and status of this
+ * SLAC software, this and all the preceding Stanford University notices
+ * are to remain affixed to any copy or derivative of this software made
+ * or distributed by the recipient and are to be affixed to any copy of
+ * software made or distributed by the recipient that contains a copy or
+ * derivative of this software.
+ * 
+ * SLAC Software Notices, Set 4 OTT.002a, 2004 FEB 03
+ */ 
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cexp_regex.h"
+#include "cexp_dfa.h"
+
+#if defined(HAVE_SPENCER_REGEX)
+
+int cexpRegexUseDfa = 1;
+
+/* Find the literal prefix and the longest literal substring
+ * which every match must have. Understands the (egrep) syntax
+ * of Spencer's regexp: ^ $ . [] () | * + ? and '\' escapes.
+ * Groups and bracket expressions are not looked into; if there
+ * is any alternation on the top level then there are no literals.
+ */
+static void
+literals(const char *expr, cexp_regex *rc)
+{
+const char	*p = expr;
+char		*run, *best = 0;
+int			rl = 0, bl = 0, depth, anchored = 0, atstart;
+char		c, q;
+int			lit;
+
+	if ( ! (run = malloc(strlen(expr) + 1)) )
+		return;
+
+	if ( '^' == *p ) {
+		anchored = 1;
+		p++;
+	}
+	/* is the current run at the start of the pattern ? */
+	atstart = anchored;
+
+	while ( 1 ) {
+		lit = 0;
+		switch ( (c = *p) ) {
+			case 0:
+				break;
+
+			case '|':
+				goto cleanup;
+
+			case '(':
+				for ( depth = 0; *p; p++ ) {
+					if ( '\\' == *p && p[1] ) {
+						p++;
+					} else if ( '(' == *p ) {
+						depth++;
+					} else if ( ')' == *p && 0 == --depth ) {
+						break;
+					}
+				}
+				if ( ! *p++ )
+					goto cleanup;
+			break;
+
+			case '[':
+				p++;
+				if ( '^' == *p )
+					p++;
+				if ( ']' == *p )
+					p++;
+				while ( *p && ']' != *p )
+					p++;
+				if ( ! *p++ )
+					goto cleanup;
+			break;
+
+			case '\\':
+				if ( ! (c = p[1]) )
+					goto cleanup;
+				lit = 1;
+				p  += 2;
+			break;
+
+			case '*': case '+': case '?':
+				/* follows nothing; regcomp rejects this anyways */
+				goto cleanup;
+
+			case '.': case '^': case '$':
+				p++;
+			break;
+
+			default:
+				lit = 1;
+				p++;
+			break;
+		}
+
+		if ( '*' == (q = *p) || '+' == q || '?' == q )
+			p++;
+		else
+			q = 0;
+
+		/* a literal which must occur (at least once) extends the current run */
+		if ( lit && '*' != q && '?' != q )
+			run[rl++] = c;
+
+		/* anything else (or repetition) terminates it */
+		if ( ! lit || q || ! c ) {
+			if ( atstart && rl && ! rc->prefix ) {
+				if ( (rc->prefix = malloc(rl + 1)) ) {
+					memcpy(rc->prefix, run, rl);
+					rc->prefix[rl] = 0;
+				}
+			}
+			if ( rl > bl ) {
+				free(best);
+				if ( ! (best = malloc(rl + 1)) ) {
+					bl = 0;
+				} else {
+					memcpy(best, run, rl);
+					best[rl] = 0;
+					bl = rl;
+				}
+			}
+			rl      = 0;
+			atstart = 0;
+		}
+
+		if ( ! c )
+			break;
+	}
+
+	rc->must    = best;
+	rc->mustlen = bl;
+	free(run);
+	return;
+
+cleanup:
+	/* too complex; no hints at all */
+	free(rc->prefix);
+	rc->prefix = 0;
+	free(best);
+	free(run);
+}
+
+cexp_regex *
+cexp_regcomp(const char *expr)
+{
+cexp_regex *rval;
+
+	if ( ! (rval = calloc(1, sizeof(*rval))) )
+		return 0;
+
+	if ( ! (rval->re = SPENCER_(regcomp)((char*)expr)) ) {
+		free(rval);
+		return 0;
+	}
+
+	literals(expr, rval);
+
+	rval->prefixlen = rval->prefix ? strlen(rval->prefix) : 0;
+	rval->scoped    = 0 != strstr(expr, "::");
+
+	/* NULL (i.e., use regexec) if anything goes wrong */
+	if ( cexpRegexUseDfa )
+		rval->dfa = cexpDfaCompile(expr);
+
+	return rval;
+}
+
+int
+cexp_regexec(cexp_regex *rc, const char *str)
+{
+int rval;
+
+	/* cheap rejection by the literals; strstr() is vectorized
+	 * by most C libraries.
+	 */
+	if ( rc->prefix && strncmp(str, rc->prefix, rc->prefixlen) )
+		return 0;
+	if ( rc->must && ! ( 1 == rc->mustlen ? strchr(str, *rc->must) : strstr(str, rc->must) ) )
+		return 0;
+
+	if ( rc->dfa && (rval = cexpDfaExec(rc->dfa, str)) >= 0 )
+		return rval;
+
+	return SPENCER_(regexec)(rc->re, (char*)str);
+}
+
+void
+cexp_regfree(cexp_regex *rc)
+{
+	if ( rc ) {
+		free(rc->re);
+		cexpDfaFree(rc->dfa);
+		free(rc->prefix);
+		free(rc->must);
+		free(rc);
+	}
+}
+
+#endif
@@ -68,14 +68,48 @@ extern "C" {
 #elif   defined(HAVE_SPENCER_REGEX)
 #include <spencer_regexp.h>
 
-typedef SPENCER_(regexp) cexp_regex;
+/* The compiled expression is accompanied by literals which
+ * are extracted from the pattern; they let symbol table
+ * searches skip (most) names without running the regexp:
+ *
+ *  'prefix': every match starts with this string, i.e., the
+ *            pattern is anchored ('^') and begins with a literal.
+ *            Symbol tables are sorted so only a range of names
+ *            needs to be looked at.
+ *  'must'  : (longest) literal every match contains.
+ *
+ * Either is NULL if there is no such literal (or the pattern is
+ * too complex to tell, e.g., it uses alternation).
+ *
+ * Unless disabled (cexpRegexUseDfa = 0) cexp_regexec() runs
+ * a lazily built DFA (cexp_dfa.c) which scans every character
+ * once and never backtracks; Spencer's regexp is kept for
+ * validating the pattern and as a fallback if the DFA's
+ * state cache overflows.
+ */
+typedef struct cexp_regex_ {
+	SPENCER_(regexp)	*re;
+	struct CexpDfaRec_	*dfa;
+	char				*prefix;
+	int					prefixlen;
+	char				*must;
+	int					mustlen;
+	int					scoped;	/* pattern contains '::', i.e., is meant */
+								/* to match demangled (C++) names        */
+} cexp_regex;
+
+/* use the DFA for expressions compiled from now on (default: yes) */
+extern int cexpRegexUseDfa;
 
-#define cexp_regcomp(expr)		SPENCER_(regcomp)(expr)
-#define cexp_regexec(ex,str)	SPENCER_(regexec)(ex,str)
+cexp_regex *
+cexp_regcomp(const char *expr);
 
-#include <stdlib.h>
+/* RETURNS: nonzero if 'str' matches */
+int
+cexp_regexec(cexp_regex *rc, const char *str);
 
-#define cexp_regfree(regex) free(regex)
+void
+cexp_regfree(cexp_regex *rc);
 
 #endif
 
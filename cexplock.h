@@ -56,6 +56,9 @@
 #include "config.h"
 #endif
 
+#include <stdint.h>
+#include <string.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -64,6 +67,7 @@ extern "C" {
 
 #include <epicsMutex.h>
 #include <epicsEvent.h>
+#include <epicsThread.h>
 
 typedef epicsMutexId CexpLock;
 typedef epicsEventId CexpEvent;
@@ -88,10 +92,13 @@ cexpEventCreate(CexpEvent *id)
 #define cexpEventWait(e)	epicsEventWait(e)
 #define cexpEventDestroy(e)	epicsEventDestroy(e)
 
-#define cexpLockingInitialize() 0
+#define cexpNap()			epicsThreadSleep(0.0001)
+
+#define cexpLockingInitialize() CEXP_ATOMIC_INIT()
 
 #elif defined(HAVE_PTHREADS)
 #include <pthread.h>
+#include <time.h>
 
 typedef pthread_mutex_t *CexpLock;
 typedef pthread_cond_t  *CexpCond;
@@ -106,6 +113,16 @@ typedef pthread_cond_t   CexpCondRec;
 #define cexpLock(l)   pthread_mutex_lock(l)
 #define cexpUnlock(l) pthread_mutex_unlock(l)
 
+/* sleep briefly (rather than yield which doesn't let a
+ * lower-priority thread run)
+ */
+static __inline__ void
+cexpNap(void)
+{
+struct timespec ts = { 0, 100000 };
+	nanosleep(&ts, 0);
+}
+
 extern pthread_mutexattr_t cexpMutexAttributes;
 
 int
@@ -128,6 +145,7 @@ long rtems_semaphore_obtain();
 long rtems_semaphore_release();
 long rtems_semaphore_create();
 long rtems_semaphore_destroy();
+long rtems_task_wake_after();
 
 #define rtems_build_name( _C1, _C2, _C3, _C4 ) \
   ( (_C1) << 24 | (_C2) << 16 | (_C3) << 8 | (_C4) )
@@ -176,7 +194,10 @@ cexpEventCreate(CexpEvent *pe)
 #define cexpLockDestroy(l) rtems_semaphore_delete((l))
 #define cexpEventDestroy(l) rtems_semaphore_delete((l))
 
-#define cexpLockingInitialize() 0
+/* one tick */
+#define cexpNap()			rtems_task_wake_after(1)
+
+#define cexpLockingInitialize() CEXP_ATOMIC_INIT()
 
 #elif defined(NO_THREAD_PROTECTION)
 
@@ -193,11 +214,10 @@ typedef void *CexpEvent;
 #define cexpEventCreate(l)	do {} while(0)
 #define cexpEventDestroy(l)	do {} while(0)
 
-#define cexpReadLock(l)		do {} while(0)
-#define cexpReadUnlock(l)	do {} while(0)
-#define cexpWriteLock(l)	do {} while(0)
-#define cexpWriteUnlock(l)	do {} while(0)
-#define cexpRWLockInit(l)	do {} while(0)
+#define cexpEpochInit(e)		do {} while(0)
+#define cexpEpochEnter(e,t)		do { (void)(t); } while(0)
+#define cexpEpochExit(t)		do { (void)(t); } while(0)
+#define cexpEpochSync(e)		do {} while(0)
 
 #define cexpLockingInitialize() 0
 
@@ -229,65 +249,121 @@ cexpCondInit(CexpCond c)
 }
 #endif
 
-typedef struct CexpRWLockRec_ {
-	CexpLock	mutex;
-	unsigned	readers;
-	CexpCondRec nap;
-	unsigned	sleeping_writers;
-} CexpRWLockRec, *CexpRWLock;
+/* Atomic operations on words of type (volatile) long or
+ * unsigned long and a full memory barrier. If the compiler
+ * has the GCC-style __sync builtins (HAVE_SYNC_BUILTINS,
+ * checked by configure) these are used; otherwise all atomic
+ * operations are serialized by a mutex (created by
+ * cexpLockingInitialize()) which also implies the barrier.
+ *   CEXP_ATOMIC_ADD(p,v):       *p += v; RETURNS: the new value
+ *   CEXP_ATOMIC_CASPTR(p,o,n):  if *p == o then *p = n;
+ *                               RETURNS: nonzero if swapped
+ *   CEXP_ATOMIC_BARRIER()
+ */
+#if defined(HAVE_SYNC_BUILTINS)
+#define CEXP_ATOMIC_ADD(p,v)		__sync_add_and_fetch((p),(v))
+#define CEXP_ATOMIC_CASPTR(p,o,n)	__sync_bool_compare_and_swap((p),(o),(n))
+#define CEXP_ATOMIC_BARRIER()		__sync_synchronize()
+#define CEXP_ATOMIC_INIT()			0
+#elif defined(NO_THREAD_PROTECTION)
+#define CEXP_ATOMIC_ADD(p,v)		(*(p) += (v))
+#define CEXP_ATOMIC_CASPTR(p,o,n)	((void*)*(p) == (void*)(o) ? (*(p) = (n), 1) : 0)
+#define CEXP_ATOMIC_BARRIER()		do {} while(0)
+#define CEXP_ATOMIC_INIT()			0
+#else
+long
+cexpAtomicAdd(volatile long *p, long v);
 
-#ifndef NO_THREAD_PROTECTION
-static __inline__ void
-cexpRWLockInit(CexpRWLock pl)
-{
-	cexpLockCreate(&pl->mutex);
-	cexpCondInit(&pl->nap);
-	pl->readers=0;
-	pl->sleeping_writers=0;
-}
+int
+cexpAtomicCasPtr(void * volatile *p, void *o, void *n);
 
-/* Readers / Writer lock implementation. This
- * should be a little more efficient for the common
- * case of a single reader which only has to 
- * acquire one mutex.
- * NOTE: A thread holding the write-lock may still
- *       do nested readLock() readUnlock() calls.
- *       However, a reader _MUST_NOT_ try to acquire
- *       the write lock!
+void
+cexpAtomicBarrier(void);
+
+int
+cexpAtomicInit(void);
+
+#define CEXP_ATOMIC_ADD(p,v)		cexpAtomicAdd((volatile long*)(p),(v))
+#define CEXP_ATOMIC_CASPTR(p,o,n)	cexpAtomicCasPtr((void * volatile *)(p),(o),(n))
+#define CEXP_ATOMIC_BARRIER()		cexpAtomicBarrier()
+#define CEXP_ATOMIC_INIT()			cexpAtomicInit()
+#endif
+
+#ifdef __GNUC__
+#define CEXP_ALIGNED(n)	__attribute__((aligned(n)))
+#else
+#define CEXP_ALIGNED(n)
+#endif
+
+/* Epoch-based protection of read-mostly data: readers never
+ * block and don't write to a shared cache line; they increment
+ * the counter of the current epoch (0/1) in one of several
+ * slots (picked by stack address, i.e., thread). A writer
+ * (serialized by other means) unpublishes what it wants to
+ * release, then cexpEpochSync() flips the epoch and waits for
+ * the counters of the previous one to drain - twice, to catch
+ * readers which picked the previous epoch just before a flip.
+ * Everything unpublished before may then be released.
+ * Readers may nest but must not call cexpEpochSync().
+ * New readers never wait for a writer and a writer only
+ * waits for the readers which entered before the flip, i.e.,
+ * a stream of readers can't starve it (see the benchmark in
+ * cexplock.c).
  */
-static __inline__  void
-cexpReadLock(CexpRWLock l)
+#define CEXP_EPOCH_LD_SLOTS	5
+#define CEXP_EPOCH_SLOTS	(1<<CEXP_EPOCH_LD_SLOTS)
+#define CEXP_CACHE_LINE		64
+
+typedef volatile long *CexpEpochTok;
+
+typedef union CexpEpochSlotRec_ {
+	volatile long	cnt[2];
+	char			pad[CEXP_CACHE_LINE];
+} CEXP_ALIGNED(CEXP_CACHE_LINE) CexpEpochSlotRec;
+
+typedef struct CexpEpochRec_ {
+	CexpEpochSlotRec		slots[CEXP_EPOCH_SLOTS];
+	volatile long			epoch;
+} CexpEpochRec, *CexpEpoch;
+
+#ifndef NO_THREAD_PROTECTION
+static __inline__ void
+cexpEpochInit(CexpEpoch e)
 {
-	cexpLock(l->mutex);
-	l->readers++;
-	cexpUnlock(l->mutex);
+	memset(e, 0, sizeof(*e));
 }
 
+/* 't' must live in the reader's stack frame */
 static __inline__ void
-cexpReadUnlock(CexpRWLock l)
+cexpEpochEnter(CexpEpoch e, CexpEpochTok *t)
 {
-	cexpLock(l->mutex);
-	if (0 == --l->readers && l->sleeping_writers) {
-		l->sleeping_writers--;
-		cexpCondSignal(&l->nap);
-	}
-	cexpUnlock(l->mutex);
+unsigned s = ((uint32_t)((uintptr_t)t >> 12) * 2654435761U) >> (32 - CEXP_EPOCH_LD_SLOTS);
+
+	*t = &e->slots[s].cnt[e->epoch & 1];
+	/* full barrier; loads of the protected data can't move up */
+	CEXP_ATOMIC_ADD(*t, 1);
 }
 
 static __inline__ void
-cexpWriteLock(CexpRWLock l)
+cexpEpochExit(CexpEpochTok t)
 {
-	cexpLock(l->mutex);
-	while (l->readers) {
-		l->sleeping_writers++;
-		cexpCondWait( &l->nap, l->mutex );
-	}
+	CEXP_ATOMIC_ADD(t, -1);
 }
 
 static __inline__ void
-cexpWriteUnlock(CexpRWLock l)
+cexpEpochSync(CexpEpoch e)
 {
-	cexpUnlock(l->mutex);
+long			old;
+int				i, pass;
+
+	for ( pass = 0; pass < 2; pass++ ) {
+		old = (CEXP_ATOMIC_ADD(&e->epoch, 1) - 1) & 1;
+		for ( i = 0; i < CEXP_EPOCH_SLOTS; i++ ) {
+			while ( e->slots[i].cnt[old] )
+				cexpNap();
+		}
+	}
+	CEXP_ATOMIC_BARRIER();
 }
 #endif
 
@@ -60,6 +60,7 @@
 #include <cexp_regex.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <unistd.h>
 /* FIXME: would like to use uintptr_t but some RTEMS versions
  *        make this long long (64-bit) even on a 32-bit machine :-(
@@ -74,6 +75,7 @@ typedef          long myintptr_t;
 #include "cexpmodP.h"
 #include "cexpsymsP.h"
 #include "cexplock.h"
+#include "vars.h"
 #define _INSIDE_CEXP_
 #include "cexpHelp.h"
 
@@ -106,76 +108,1023 @@ CexpModule cexpSystemModule=0;
 char *
 cexpMagicString = CEXPMOD_MAGIC;
 
-static CexpRWLockRec	_rwlock;
-#define __RLOCK()	cexpReadLock(&_rwlock)
-#define __RUNLOCK()	cexpReadUnlock(&_rwlock)
-#define __WLOCK()	cexpWriteLock(&_rwlock)
-#define __WUNLOCK()	cexpWriteUnlock(&_rwlock)
+/* Readers of the module list and the indices below don't lock;
+ * they are protected by an epoch (see cexplock.h). Writers are
+ * serialized by a (recursive) mutex, publish new entries/indices
+ * only once they are complete and release what they removed after
+ * a grace period (cexpEpochSync()). A thread holding the write
+ * lock may still read (__RLOCK()) but a reader must not write.
+ * The 'CexpEpochTok' of a reader must be a local variable.
+ */
+static CexpEpochRec		_epoch;
+static CexpLock			_wlock;
+#define __RLOCK(t)		cexpEpochEnter(&_epoch, (t))
+#define __RUNLOCK(t)	cexpEpochExit(*(t))
+#define __WLOCK()		cexpLock(_wlock)
+#define __WUNLOCK()		cexpUnlock(_wlock)
+#define __SYNC()		cexpEpochSync(&_epoch)
+
+/* Loads are serialized by another lock; they do most of their
+ * work without the write lock (see moduleLoad()). The load lock
+ * is taken first.
+ */
+static CexpLock			_llock;
+#define __LLOCK()		cexpLock(_llock)
+#define __LUNLOCK()		cexpUnlock(_llock)
+
+/* serializes readers updating the cached demangler (dmglProc()) */
+static CexpLock			dmglLock;
+
+/* incremented (with the write lock held) whenever a module
+ * is removed from the list
+ */
+static unsigned long	dropGen = 0;
+
+#ifdef USE_LOADER
+#define LOAD_RETRIES	2
+#else
+/* only symbol files which may register companions */
+#define LOAD_RETRIES	0
+#endif
+
+/* store a pointer making a (complete) object visible to readers */
+#define PUBLISH(p,v)	do { CEXP_ATOMIC_BARRIER(); (p) = (v); } while (0)
 
 void
 cexpModuleInitOnce(void)
 {
-	memset(&_rwlock, 0, sizeof(_rwlock));
-	cexpRWLockInit(&_rwlock);
+	cexpEpochInit(&_epoch);
+	cexpLockCreate(&_wlock);
+	cexpLockCreate(&_llock);
+	cexpLockCreate(&dmglLock);
+	cexpSymTblInitOnce();
 }
 
-#ifdef USE_LOADER
-/* Search predecessor of a module in the list.
- * This should be called with the lock held!
+/* last module in the list; protected by the write lock */
+static CexpModule		lastModule = 0;
+
+/* source of module ids; protected by the write lock */
+static ModuleId			lastId = 0;
+
+/* Global index of the symbols defined by all modules except
+ * the system module (which is always first and has its own
+ * hash index; no need to duplicate its - possibly huge - table).
+ *
+ * Each slot of the open-addressing table heads a list of all
+ * modules defining the identical name, in load order; the head
+ * thus holds the definition that shadows all others.
+ * Nodes are allocated per module (one per symbol) and released
+ * when the module goes away.
+ *
+ * Readers only look at the heads; the slots are part of a
+ * CexpModIdxRec which is modified and then published by the
+ * writer (lists are modified in place).
+ */
+typedef struct CexpGSymRec_ {
+	CexpSym				sym;
+	CexpModule			mod;
+	struct CexpGSymRec_	*next;	/* same name in a later module */
+} CexpGSymRec, *CexpGSym;
+
+/* The tables of an index are trees of nodes which are never
+ * modified once published. A writer gets a new version of the
+ * index (idxCopy()) sharing all nodes with the current one and
+ * copies just the nodes on the paths to what it modifies
+ * (idxOwn()); the cost of an update thus doesn't depend on the
+ * number of symbols or modules.
+ * The replaced nodes go with the superseded index and are
+ * released after a grace period (idxFree()).
  */
+typedef struct IdxNodeRec_ {
+	unsigned long		gen;	/* index which created the node; 0 if dropped again */
+	struct IdxNodeRec_	*link;	/* nodes created (or replaced) by a writer */
+} IdxNodeRec, *IdxNode;
 
-static CexpModule
-predecessor(CexpModule mod)
+/* The slots of a hash table are the leaves of a tree of fixed
+ * depth with PARR_FAN branches per node.
+ */
+#define PARR_LD		6
+#define PARR_FAN	(1<<PARR_LD)
+
+typedef struct PNodeRec_ {
+	IdxNodeRec	hdr;
+	void		*s[PARR_FAN];	/* children or, at the bottom, the slots */
+} PNodeRec, *PNode;
+
+typedef struct PArrRec_ {
+	PNode		root;
+	unsigned	depth;
+} PArrRec, *PArr;
+
+/* What readers get at through 'modIdx'; the global symbol index,
+ * the address map (USE_LOADER, see below) and the registry.
+ */
+typedef struct CexpModIdxRec_ {
+	unsigned long			gen;
+	IdxNode					fresh;		/* nodes created by the writer */
+	IdxNode					dead;		/* nodes replaced by the writer/the successor */
+	int						retired;
+	PArrRec					gsym;
+	unsigned long			gsymMask;	/* number of slots - 1; 0 if no table */
+	unsigned long			gsymUsed;
+	struct CexpAddrMapRec_	*amap;
+	PArrRec					modTbl;		/* registry of the modules on the list */
+	PArrRec					modNames;
+	PArrRec					modIds;
+	unsigned long			modMask;	/* number of slots - 1 (all tables)    */
+	unsigned long			modUsed;
+} CexpModIdxRec, *CexpModIdx;
+
+static CexpModIdxRec		idxNone = { 0 };
+static CexpModIdx volatile	modIdx  = &idxNone;
+
+/* a node of 'x' the writer may modify; copy of 'node' (which is
+ * replaced) unless 'x' created it, a new (zeroed) one if 'node'
+ * is NULL. NULL if there is no memory.
+ */
+static void *
+idxOwn(CexpModIdx x, void *node, size_t size)
 {
-register CexpModule pred;
+IdxNode o = node, n;
 
-	if (!mod) return 0;
+	if ( o && o->gen == x->gen )
+		return o;
 
-	for (pred=cexpSystemModule; pred && mod!=pred->next; pred=pred->next)
-			/* nothing else to do */;
-	return pred;
+	if ( ! (n = malloc(size)) )
+		return 0;
+
+	if ( o ) {
+		memcpy(n, o, size);
+		o->link  = x->dead;
+		x->dead  = o;
+	} else {
+		memset(n, 0, size);
+	}
+	n->gen   = x->gen;
+	n->link  = x->fresh;
+	x->fresh = n;
+	return n;
 }
-#endif
 
-/* verify the validity of a handle;
- * should be called with the lock held
+/* a node which 'x' no longer refers to */
+static void
+idxDrop(CexpModIdx x, IdxNode n)
+{
+	if ( n->gen == x->gen ) {
+		/* released with the list of new nodes */
+		n->gen  = 0;
+	} else {
+		n->link = x->dead;
+		x->dead = n;
+	}
+}
+
+/* depth of a tree with 'n' slots */
+static unsigned
+paDepth(unsigned long n)
+{
+unsigned d;
+	for ( d = 1; n > PARR_FAN; n >>= PARR_LD )
+		d++;
+	return d;
+}
+
+static void *
+paGet(PArr a, unsigned long i)
+{
+PNode		n = a->root;
+unsigned	l = a->depth;
+
+	while ( n && --l > 0 )
+		n = n->s[(i >> (l*PARR_LD)) & (PARR_FAN-1)];
+	return n ? n->s[i & (PARR_FAN-1)] : 0;
+}
+
+/* RETURNS: 0 on success, nonzero if no memory ('a' is unchanged) */
+static int
+paSet(CexpModIdx x, PArr a, unsigned long i, void *v)
+{
+PNode		*pp = &a->root, n;
+unsigned	l   = a->depth;
+
+	while ( 1 ) {
+		if ( ! *pp && ! v )
+			return 0;
+		if ( ! (n = idxOwn(x, *pp, sizeof(*n))) )
+			return -1;
+		*pp = n;
+		if ( 0 == --l )
+			break;
+		pp = (PNode*)&n->s[(i >> (l*PARR_LD)) & (PARR_FAN-1)];
+	}
+	n->s[i & (PARR_FAN-1)] = v;
+	return 0;
+}
+
+/* drop all nodes of a tree (of depth 'l') */
+static void
+paDrop(CexpModIdx x, PNode n, unsigned l)
+{
+int i;
+
+	if ( ! n )
+		return;
+	if ( --l > 0 ) {
+		for ( i = 0; i < PARR_FAN; i++ )
+			paDrop(x, n->s[i], l);
+	}
+	idxDrop(x, &n->hdr);
+}
+
+/* remove a slot of a hash table (with 'mask') preserving
+ * the linear-probing invariant.
+ *
+ * RETURNS: 0 on success, nonzero if no memory ('x' is unusable then).
  */
 static int
-modIsStale(CexpModule mod)
+paDelSlot(CexpModIdx x, PArr a, unsigned long mask, unsigned long i, unsigned long (*hash)(void*))
 {
-register CexpModule m;
+unsigned long	j,k;
+void			*e;
 
-	for (m=cexpSystemModule; m && m!=mod; m=m->next)
-			/* nothing else to do */;
-	return m==0;
+	if ( paSet(x, a, i, 0) )
+		return -1;
+
+	for ( j = (i+1) & mask; (e = paGet(a, j)); j = (j+1) & mask ) {
+		k = hash(e) & mask;
+		/* can entry 'j' be moved into the hole at 'i' ? */
+		if ( i <= j ? (k <= i || k > j) : (k <= i && k > j) ) {
+			if ( paSet(x, a, i, e) || paSet(x, a, j, 0) )
+				return -1;
+			i = j;
+		}
+	}
+	return 0;
 }
 
+/* The registry holds all modules on the list (including the
+ * system module and companions) in three open-addressing tables
+ * of the same size; 'modTbl' is hashed by the address of the
+ * module (to validate a handle), 'modNames' by its name and
+ * 'modIds' by its ID.
+ * A handle (address) which outlives its module may refer to a
+ * newer module which got the same memory; IDs are never reused.
+ */
+static unsigned long
+modHash(void *mod)
+{
+	return ((myuintptr_t)mod / sizeof(CexpModuleRec)) * 2654435761UL;
+}
 
-/* search for a name in all module's symbol tables */
-CexpSym
-cexpSymLookup(const char *name, CexpModule *pmod)
+static unsigned long
+modNameHash(void *mod)
 {
-CexpModule	m;
-CexpSym		rval=0;
-int			index;
+	return _cexp_namehash(((CexpModule)mod)->name);
+}
+
+static unsigned long
+modIdHash(void *mod)
+{
+	return ((CexpModule)mod)->id * 2654435761UL;
+}
+
+/* slot holding 'mod' or the empty one where it would go */
+static unsigned long
+modSlot(CexpModIdx x, CexpModule mod)
+{
+unsigned long	h;
+CexpModule		m;
+	for ( h = modHash(mod) & x->modMask; (m = paGet(&x->modTbl, h)) && m != mod; h = (h+1) & x->modMask )
+		/* nothing else to do */;
+	return h;
+}
+
+static unsigned long
+modNameSlot(CexpModIdx x, const char *name)
+{
+unsigned long	h;
+CexpModule		m;
+	for ( h = _cexp_namehash(name) & x->modMask; (m = paGet(&x->modNames, h)) && strcmp(name, m->name); h = (h+1) & x->modMask )
+		/* nothing else to do */;
+	return h;
+}
+
+static unsigned long
+modIdSlot(CexpModIdx x, ModuleId id)
+{
+unsigned long	h;
+CexpModule		m;
+	for ( h = (id * 2654435761UL) & x->modMask; (m = paGet(&x->modIds, h)) && m->id != id; h = (h+1) & x->modMask )
+		/* nothing else to do */;
+	return h;
+}
+
+static int
+modGrow(CexpModIdx x)
+{
+PArrRec			ot = x->modTbl, on = x->modNames, oi = x->modIds;
+unsigned long	oldn = x->modMask ? x->modMask + 1 : 0, n, i;
+CexpModule		m;
+
+	if ( 2*(x->modUsed + 1) <= oldn )
+		return 0;
+
+	n = oldn ? 2*oldn : 16;
+
+	x->modTbl.root    = x->modNames.root  = x->modIds.root  = 0;
+	x->modTbl.depth   = x->modNames.depth = x->modIds.depth = paDepth(n);
+	x->modMask        = n - 1;
+
+	for ( i = 0; i < oldn; i++ ) {
+		if ( (m = paGet(&ot, i)) && paSet(x, &x->modTbl, modSlot(x, m), m) )
+			goto bail;
+		if ( (m = paGet(&on, i)) && paSet(x, &x->modNames, modNameSlot(x, m->name), m) )
+			goto bail;
+		if ( (m = paGet(&oi, i)) && paSet(x, &x->modIds, modIdSlot(x, m->id), m) )
+			goto bail;
+	}
+	paDrop(x, ot.root, ot.depth);
+	paDrop(x, on.root, on.depth);
+	paDrop(x, oi.root, oi.depth);
+	return 0;
+
+bail:
+	paDrop(x, x->modTbl.root,   x->modTbl.depth);
+	paDrop(x, x->modNames.root, x->modNames.depth);
+	paDrop(x, x->modIds.root,   x->modIds.depth);
+	x->modTbl   = ot;
+	x->modNames = on;
+	x->modIds   = oi;
+	x->modMask  = oldn - 1;
+	return -1;
+}
+
+/* 'mod' must have its ID
+ *
+ * RETURNS: 0 on success, nonzero if no memory ('x' is unchanged)
+ */
+static int
+modAdd(CexpModIdx x, CexpModule mod)
+{
+	if ( modGrow(x) || paSet(x, &x->modTbl, modSlot(x, mod), mod) )
+		return -1;
+	if ( paSet(x, &x->modNames, modNameSlot(x, mod->name), mod) )
+		goto bail;
+	if ( paSet(x, &x->modIds, modIdSlot(x, mod->id), mod) ) {
+		paSet(x, &x->modNames, modNameSlot(x, mod->name), 0);
+		goto bail;
+	}
+	x->modUsed++;
+	return 0;
+
+bail:
+	/* the paths are ours now; clearing the slots can't fail */
+	paSet(x, &x->modTbl, modSlot(x, mod), 0);
+	return -1;
+}
+
+/* RETURNS: 0 on success, nonzero if no memory ('x' is unusable then) */
+static int
+modDel(CexpModIdx x, CexpModule mod)
+{
+unsigned long i;
+
+	if ( ! paGet(&x->modTbl, i = modSlot(x, mod)) )
+		return 0;
+	if (    paDelSlot(x, &x->modTbl, x->modMask, i, modHash)
+	     || paDelSlot(x, &x->modNames, x->modMask, modNameSlot(x, mod->name), modNameHash)
+	     || paDelSlot(x, &x->modIds, x->modMask, modIdSlot(x, mod->id), modIdHash) )
+		return -1;
+	x->modUsed--;
+	return 0;
+}
+
+static CexpModule
+modFind(CexpModIdx x, const char *name)
+{
+	return paGet(&x->modNames, modNameSlot(x, name));
+}
+
+static CexpModule
+modFindId(CexpModIdx x, ModuleId id)
+{
+	return paGet(&x->modIds, modIdSlot(x, id));
+}
+
+/* verify that a handle refers to a module on the list (which may
+ * be a newer one at the address of a module unloaded meanwhile;
+ * pass the ID, if known, to rule this out); must be called with
+ * the write lock held or from a reader
+ */
+static int
+modIsStale(CexpModule mod, ModuleId id)
+{
+CexpModIdx x = modIdx;
+	if ( id )
+		return ! mod || modFindId(x, id) != mod;
+	return ! mod || paGet(&x->modTbl, modSlot(x, mod)) != mod;
+}
+
+/* number of modules with lazy tables (shared libraries); these
+ * are not entered into the global index.
+ */
+static int lazyModules = 0;
+
+/* bring the lazy modules up to date with the libraries currently
+ * mapped (dlopen()/dlclose()); cheap if nothing changed but
+ * cexpLoadFileChanged() still walks the link map (and takes the
+ * run-time linker's lock). Lookups only call it on a miss, the
+ * interactive listings up front.
+ * Must be called with no lock held.
+ */
+static void
+lazyRescan(void)
+{
+	if ( cexpLoadFileChanged() )
+		cexpModuleRescan();
+}
 
-	__RLOCK();
+static unsigned long
+gsymHash(void *g)
+{
+	return _cexp_namehash(((CexpGSym)g)->sym->name);
+}
 
-	for (m=cexpSystemModule, index=0; m; m=m->next, index++) {
-		if ((rval=cexpSymTblLookup(name,m->symtbl)))
+static unsigned long
+gsymSlot(CexpModIdx x, const char *name)
+{
+unsigned long	h;
+CexpGSym		g;
+	for ( h = _cexp_namehash(name) & x->gsymMask; (g = paGet(&x->gsym, h)); h = (h+1) & x->gsymMask ) {
+		if ( !strcmp(name, g->sym->name) )
 			break;
 	}
+	return h;
+}
+
+static int
+gsymGrow(CexpModIdx x, unsigned long nnew)
+{
+PArrRec			old  = x->gsym;
+unsigned long	oldn = x->gsymMask ? x->gsymMask + 1 : 0, n, i;
+CexpGSym		g;
+
+	for ( n = oldn ? oldn : 64; n < 2*(x->gsymUsed + nnew); n <<= 1 )
+		/* nothing else to do */;
+
+	if ( n == oldn )
+		return 0;
+
+	x->gsym.root  = 0;
+	x->gsym.depth = paDepth(n);
+	x->gsymMask   = n - 1;
+
+	for ( i = 0; i < oldn; i++ ) {
+		if ( (g = paGet(&old, i)) && paSet(x, &x->gsym, gsymSlot(x, g->sym->name), g) ) {
+			paDrop(x, x->gsym.root, x->gsym.depth);
+			x->gsym     = old;
+			x->gsymMask = oldn - 1;
+			return -1;
+		}
+	}
+	paDrop(x, old.root, old.depth);
+	return 0;
+}
+
+/* Remove a module from the slots of 'x'; the lists are left
+ * alone (gsymUnlink() takes the nodes out once it is certain
+ * that 'x' is published). The nodes are released along with
+ * the module (readers of a previous index may still get at them).
+ *
+ * RETURNS: 0 on success, nonzero if no memory ('x' is unusable then).
+ */
+static int
+gsymDelModule(CexpModIdx x, CexpModule mod)
+{
+CexpGSym		n, g;
+unsigned long	i,h;
+
+	if ( ! mod->gsyms )
+		return 0;
+
+	for ( i = 0, n = mod->gsyms; i < mod->symtbl->nentries; i++, n++ ) {
+		h = gsymSlot(x, n->sym->name);
+		if ( ! (g = paGet(&x->gsym, h)) || g->mod != mod )
+			continue;
+		while ( g && g->mod == mod )
+			g = g->next;
+		if ( g ? paSet(x, &x->gsym, h, g) : paDelSlot(x, &x->gsym, x->gsymMask, h, gsymHash) )
+			return -1;
+		if ( ! g )
+			x->gsymUsed--;
+	}
+	return 0;
+}
+
+/* Take the nodes of a module out of the lists headed by the
+ * slots of 'x' (in place; readers don't follow the lists).
+ * Nodes heading a list of 'x' are left alone; 'x' must no
+ * longer refer to the module unless it is discarded anyway.
+ */
+static void
+gsymUnlink(CexpModIdx x, CexpModule mod)
+{
+CexpGSym		n, g, *pp;
+unsigned long	i;
+
+	if ( ! mod->gsyms )
+		return;
+
+	for ( i = 0, n = mod->gsyms; i < mod->symtbl->nentries; i++, n++ ) {
+		if ( ! (g = paGet(&x->gsym, gsymSlot(x, n->sym->name))) )
+			continue; /* not entered (add failed half-way) */
+		for ( pp = &g->next; *pp; ) {
+			if ( (*pp)->mod == mod )
+				*pp = (*pp)->next;
+			else
+				pp  = &(*pp)->next;
+		}
+	}
+}
+
+/* add all symbols of a module which must have a higher
+ * 'seq' number than all modules already in the index.
+ * If this fails then 'x' must be discarded and the module
+ * taken out of the lists (gsymUnlink()).
+ */
+static int
+gsymAddModule(CexpModIdx x, CexpModule mod)
+{
+CexpSymTbl		t = mod->symtbl;
+CexpGSym		n, g;
+unsigned long	i,h;
+
+	if ( 0 == t->nentries )
+		return 0;
+
+	if ( gsymGrow(x, t->nentries) )
+		return -1;
+
+	if ( ! (mod->gsyms = malloc(t->nentries * sizeof(*mod->gsyms))) )
+		return -1;
+
+	for ( i = 0, n = mod->gsyms; i < t->nentries; i++, n++ ) {
+		n->sym  = &t->syms[i];
+		n->mod  = mod;
+		n->next = 0;
+	}
+
+	for ( i = 0, n = mod->gsyms; i < t->nentries; i++, n++ ) {
+		h = gsymSlot(x, n->sym->name);
+		if ( (g = paGet(&x->gsym, h)) ) {
+			/* append; we are the most recently loaded module */
+			while ( g->next )
+				g = g->next;
+			g->next = n;
+		} else {
+			if ( paSet(x, &x->gsym, h, n) )
+				return -1;
+			x->gsymUsed++;
+		}
+	}
+	return 0;
+}
+
+/* Lookup in the global index; this also handles names that
+ * differ only by a version suffix (cf. _cexp_namecomp())
+ * by picking the match from the earliest module.
+ */
+static CexpGSym
+gsymLookup(CexpModIdx x, const char *name)
+{
+CexpSymRec		key;
+CexpGSym		best = 0, g;
+unsigned long	h;
+
+	key.name = name;
+	for ( h = _cexp_namehash(name) & x->gsymMask; (g = paGet(&x->gsym, h)); h = (h+1) & x->gsymMask ) {
+		if ( 0 == _cexp_namecomp(&key, g->sym)
+		     && ( ! best || g->mod->seq < best->mod->seq ) )
+			best = g;
+	}
+	return best;
+}
+
+/* The demangler is part of the C++ runtime; use the one
+ * of the program (or of a library it uses), if any.
+ */
+#define DEMANGLER_NAME	"__cxa_demangle"
+
+/* The demangler found when the symbol generation was
+ * 'dmglGen' - 1 (0: never looked for); updated by whoever
+ * notices a change (holding 'dmglLock'). 'dmglGen' is cleared
+ * while 'dmglCached' changes.
+ */
+static CexpDemangleProc volatile	dmglCached = 0;
+static volatile unsigned long		dmglGen    = 0;
+
+/* Called with the module lock held for reading */
+static CexpDemangleProc
+dmglProc(void)
+{
+unsigned long		g = cexpSymGeneration + 1;
+CexpModule			m;
+CexpSym				s;
+CexpDemangleProc	dm;
+
+	if ( dmglGen == g ) {
+		dm = dmglCached;
+		CEXP_ATOMIC_BARRIER();
+		if ( dmglGen == g )
+			return dm;
+	}
+
+	cexpLock(dmglLock);
+	if ( dmglGen == g ) {
+		dm = dmglCached;
+	} else {
+		for ( dm = 0, m = cexpSystemModule; m && ! dm; m = m->next ) {
+			if ( (s = cexpSymTblLookup(DEMANGLER_NAME, m->symtbl)) )
+				dm = (CexpDemangleProc)s->value.ptv;
+		}
+		dmglGen    = 0;
+		CEXP_ATOMIC_BARRIER();
+		dmglCached = dm;
+		CEXP_ATOMIC_BARRIER();
+		dmglGen    = g;
+	}
+	cexpUnlock(dmglLock);
+	return dm;
+}
+
+/* A literal which is part of the mangled name of everything
+ * whose qualified (demangled) name starts with 'name': the
+ * outermost scope (or the name itself) as <length><identifier>
+ * or just the identifier if it may be incomplete ('prefix').
+ * There is none if it is 'std' (abbreviated), an operator,
+ * a special name ("vtable for ...") and such.
+ *
+ * RETURNS: 'buf' or NULL if there is no such literal.
+ */
+static const char *
+dmglKey(const char *name, int prefix, char *buf, int bufsz)
+{
+int l, i;
+
+	l = strcspn(name, ":<([ ");
+	if ( 0 == l || ' ' == name[l] || l >= bufsz - 4 )
+		return 0;
+	for ( i = 0; i < l; i++ ) {
+		if ( ! isalnum((unsigned char)name[i]) && '_' != name[i] )
+			return 0;
+	}
+	if ( (3 == l && ! strncmp(name, "std", 3)) || ! strncmp(name, "operator", 8) )
+		return 0;
+
+	if ( prefix && ! name[l] )
+		sprintf(buf, "%.*s", l, name);
+	else
+		sprintf(buf, "%d%.*s", l, l, name);
+	return buf;
+}
+
+/* Build the demangled-name index of a module's table unless
+ * it exists already or the table has no mangled name which
+ * contains 'key' (see dmglKey(); any mangled name if NULL).
+ * A lazy table is only filled in the former case.
+ * Called with the module lock held for reading; the index
+ * of a table isn't modified once it exists.
+ *
+ * RETURNS: nonzero if the table has the index.
+ */
+static int
+dmglTable(CexpModule m, const char *key)
+{
+CexpSymTbl			t = m->symtbl;
+CexpDemangleProc	dm;
+
+	if ( t->dmgl )
+		return 1;
+	if ( ! cexpSymTblMayHaveMangled(t, key) || ! (dm = dmglProc()) )
+		return 0;
+	cexpSymTblFill(t);
+	cexpSymTblDemangle(t, dm);
+	return 0 != t->dmgl;
+}
+
+/* search for a name in all module's symbol tables; on a miss
+ * the shared library modules are brought up to date first if
+ * 'rescan' is nonzero (see cexpLoadFileChanged()).
+ */
+CexpSym
+_cexpSymLookup(const char *name, CexpModule *pmod, int rescan)
+{
+CexpModule	m,l;
+CexpSym		rval=0,s;
+CexpGSym	g;
+CexpEpochTok	rd;
+const char	*key;
+char		buf[80];
+
+	__RLOCK(&rd);
+
+	if ( (m=cexpSystemModule) && ! (rval=cexpSymTblLookup(name,m->symtbl)) ) {
+		if ( (g=gsymLookup(modIdx, name)) ) {
+			rval = g->sym;
+			m    = g->mod;
+			/* the index doesn't hold the lazy tables; a library
+			 * loaded before the module found shadows it (the one
+			 * loaded first if there are several).
+			 */
+			for ( l = lazyModules ? cexpSystemModule->next : 0; l; l = l->next ) {
+				if ( l->symtbl->lazy && l->seq < m->seq && (s = cexpSymTblLookup(name, l->symtbl)) ) {
+					rval = s;
+					m    = l;
+				}
+			}
+		} else {
+			/* lazy tables (shared libraries) are not in the global
+			 * index; they use their own hash tables. The name might
+			 * be in a library which was dlopen()ed in the meantime.
+			 */
+			if ( rescan && cexpLoadFileChanged() ) {
+				__RUNLOCK(&rd);
+				cexpModuleRescan();
+				__RLOCK(&rd);
+			}
+			for ( m = lazyModules ? cexpSystemModule->next : 0; m; m = m->next ) {
+				if ( m->symtbl->lazy && (rval = cexpSymTblLookup(name, m->symtbl)) )
+					break;
+			}
+			/* C (and mangled) names have no scope and no parameters;
+			 * try the demangled ones, e.g., "ns::foo(int)".
+			 */
+			if ( ! rval && strpbrk(name, ":(") ) {
+				key = dmglKey(name, 0, buf, sizeof(buf));
+				for ( m = cexpSystemModule; m; m = m->next ) {
+					if ( dmglTable(m, key) && (rval = cexpSymTblLookupDemangled(name, m->symtbl)) )
+						break;
+				}
+			}
+		}
+	}
 	if (pmod)
 		*pmod=m;
 
-	__RUNLOCK();
+	__RUNLOCK(&rd);
 
 	return rval;
 }
 
+CexpSym
+cexpSymLookup(const char *name, CexpModule *pmod)
+{
+	return _cexpSymLookup(name, pmod, 1);
+}
+
+#ifdef USE_LOADER
+/* Map of the segments of all modules except the system module,
+ * for resolving an address to its module without visiting every
+ * module. Segments of different modules never overlap.
+ * The system module is not entered; its range (first to last
+ * symbol address) may enclose the segments of other modules
+ * and is checked separately.
+ *
+ * The map is a treap (search tree by address, heap by 'prio')
+ * which is part of a CexpModIdxRec; the writer copies the nodes
+ * on the paths it modifies.
+ */
+typedef struct CexpAddrMapRec_ {
+	IdxNodeRec				hdr;
+	myuintptr_t				lo, hi;		/* [lo, hi) */
+	CexpModule				mod;
+	unsigned long			prio;
+	struct CexpAddrMapRec_	*l, *r;
+} CexpAddrMapRec, *CexpAddrMap;
+
+/* split 't' into the segments below 'key' and the others
+ *
+ * RETURNS: 0 on success, nonzero if no memory ('x' is unusable then).
+ */
+static int
+amapSplit(CexpModIdx x, CexpAddrMap t, myuintptr_t key, CexpAddrMap *pl, CexpAddrMap *pr)
+{
+	if ( ! t ) {
+		*pl = *pr = 0;
+		return 0;
+	}
+	if ( ! (t = idxOwn(x, t, sizeof(*t))) )
+		return -1;
+	if ( t->lo < key ) {
+		*pl = t;
+		return amapSplit(x, t->r, key, &t->r, pr);
+	}
+	*pr = t;
+	return amapSplit(x, t->l, key, pl, &t->l);
+}
+
+/* join 'a' and 'b' (all segments of 'a' are below 'b') */
+static int
+amapMerge(CexpModIdx x, CexpAddrMap a, CexpAddrMap b, CexpAddrMap *pt)
+{
+	if ( ! a || ! b ) {
+		*pt = a ? a : b;
+		return 0;
+	}
+	if ( a->prio > b->prio ) {
+		if ( ! (a = idxOwn(x, a, sizeof(*a))) )
+			return -1;
+		*pt = a;
+		return amapMerge(x, a->r, b, &a->r);
+	}
+	if ( ! (b = idxOwn(x, b, sizeof(*b))) )
+		return -1;
+	*pt = b;
+	return amapMerge(x, a, b->l, &b->l);
+}
+
+static int
+amapInsert(CexpModIdx x, CexpAddrMap *pt, CexpAddrMap n)
+{
+CexpAddrMap t = *pt;
+
+	if ( ! t || n->prio > t->prio ) {
+		if ( amapSplit(x, t, n->lo, &n->l, &n->r) )
+			return -1;
+		*pt = n;
+		return 0;
+	}
+	if ( ! (t = idxOwn(x, t, sizeof(*t))) )
+		return -1;
+	*pt = t;
+	return amapInsert(x, n->lo < t->lo ? &t->l : &t->r, n);
+}
+
+static int
+amapRemove(CexpModIdx x, CexpAddrMap *pt, myuintptr_t lo)
+{
+CexpAddrMap t = *pt, m;
+
+	if ( ! t )
+		return 0;
+	if ( t->lo == lo ) {
+		if ( amapMerge(x, t->l, t->r, &m) )
+			return -1;
+		idxDrop(x, &t->hdr);
+		*pt = m;
+		return 0;
+	}
+	if ( ! (t = idxOwn(x, t, sizeof(*t))) )
+		return -1;
+	*pt = t;
+	return amapRemove(x, lo < t->lo ? &t->l : &t->r, lo);
+}
+
+static int
+amapDelModule(CexpModIdx x, CexpModule mod)
+{
+CexpSegment		s;
+
+	if ( ! mod->segs )
+		return 0;
+
+	for ( s = mod->segs; s->name; s++ ) {
+		if ( s->chunk && s->size && amapRemove(x, &x->amap, (myuintptr_t)s->chunk) )
+			return -1;
+	}
+	return 0;
+}
+
+static int
+amapAddModule(CexpModIdx x, CexpModule mod)
+{
+CexpSegment		s;
+CexpAddrMap		n;
+
+	if ( ! mod->segs )
+		return 0;
+
+	for ( s = mod->segs; s->name; s++ ) {
+		if ( ! s->chunk || ! s->size )
+			continue;
+		if ( ! (n = idxOwn(x, 0, sizeof(*n))) )
+			return -1;
+		n->lo   = (myuintptr_t)s->chunk;
+		n->hi   = (myuintptr_t)s->chunk + s->size;
+		n->mod  = mod;
+		n->prio = ((n->lo >> 4) ^ (n->lo >> 20)) * 2654435761UL;
+		if ( amapInsert(x, &x->amap, n) )
+			return -1;
+	}
+	return 0;
+}
+
+/* first segment (by address) which ends above 'addr' */
+static CexpAddrMap
+amapCeil(CexpModIdx x, myuintptr_t addr)
+{
+CexpAddrMap t, rval = 0;
+
+	for ( t = x->amap; t; ) {
+		if ( t->hi > addr ) {
+			rval = t;
+			t    = t->l;
+		} else {
+			t    = t->r;
+		}
+	}
+	return rval;
+}
+
+/* find the (non-system) module with a segment holding 'addr' */
+static CexpModule
+amapLookup(CexpModIdx x, void *addr)
+{
+CexpAddrMap t = amapCeil(x, (myuintptr_t)addr);
+
+	return t && t->lo <= (myuintptr_t)addr ? t->mod : 0;
+}
+#endif
+
+/* release an index which was never published (what its writer
+ * created) or one which was superseded (what its successor
+ * replaced; after a grace period).
+ */
+static void
+idxFree(CexpModIdx x)
+{
+IdxNode n, nn;
+
+	if ( x && x != &idxNone ) {
+		for ( n = x->retired ? x->dead : x->fresh; n; n = nn ) {
+			nn = n->link;
+			free(n);
+		}
+		free(x);
+	}
+}
+
+/* new version of the current index for a writer to modify
+ * (and publish); it shares all nodes with the current one
+ * until they are modified. NULL if there is no memory.
+ */
+static CexpModIdx
+idxCopy(void)
+{
+CexpModIdx	o = modIdx, x;
+
+	if ( ! (x = malloc(sizeof(*x))) )
+		return 0;
+
+	*x         = *o;
+	x->gen     = o->gen + 1;
+	x->fresh   = 0;
+	x->dead    = 0;
+	x->retired = 0;
+
+	return x;
+}
+
+/* make 'x' the current index (with the write lock held)
+ *
+ * RETURNS: the previous index which may be released (idxFree())
+ *          after a grace period (__SYNC()).
+ */
+static CexpModIdx
+idxPublish(CexpModIdx x)
+{
+CexpModIdx	old = modIdx;
+IdxNode		n, *pp;
+
+	/* nodes which were created and dropped again */
+	for ( pp = &x->fresh; (n = *pp); ) {
+		if ( n->gen ) {
+			pp = &n->link;
+		} else {
+			*pp = n->link;
+			free(n);
+		}
+	}
+	x->fresh = 0;
+
+	PUBLISH(modIdx, x);
+
+	/* what 'x' replaced is still visible to readers of 'old' */
+	if ( old != &idxNone ) {
+		old->dead    = x->dead;
+		old->retired = 1;
+	}
+	x->dead = 0;
+	return old;
+}
+
 static int addrInModule(void *addr, CexpModule m)
 {
 CexpSymTbl  t;
+	if ( m->symtbl->lazy ) {
+		return    (uintptr_t)addr >= m->symtbl->lazy->lo
+		       && (uintptr_t)addr <  m->symtbl->lazy->hi;
+	}
 #ifdef USE_LOADER
 CexpSegment s;
 	if ( (s = m->segs) ) {
@@ -192,85 +1141,156 @@ CexpSegment s;
 	if ( m == cexpSystemModule ) {
 		t = m->symtbl;
 		/* assume system module is a single chunk (not allocated though) */
-		return addr >= (void*)t->aindex[0]->value.ptv && addr <= (void*)t->aindex[t->nentries-1]->value.ptv;
+		return addr >= (void*)CEXP_ASYM(t,0)->value.ptv && addr <= (void*)CEXP_ASYM(t,t->nentries-1)->value.ptv;
 	}
 	return 0;
 }
 
+/* find the module with a lazy table which covers 'addr' */
+static CexpModule
+lazyLookup(void *addr)
+{
+CexpModule m;
+
+	if ( ! lazyModules )
+		return 0;
+
+	for ( m = cexpSystemModule ? cexpSystemModule->next : 0; m; m = m->next ) {
+		if ( m->symtbl->lazy && addrInModule(addr, m) )
+			break;
+	}
+	return m;
+}
+
 static void *
 gaddr(CexpSymAIdx ar)
 {
-	return ar->mod->symtbl->aindex[ar->idx]->value.ptv;
+	return CEXP_ASYM(ar->tbl, ar->idx)->value.ptv;
 }
 
-void
-cexpSymLkAddrRange(void *addr, CexpSymAIdx ar, int margin)
+/* merge the entries of table 't' (of module 'm') closest to 'addr'
+ * into 'ar'; if 'strict' is set then an entry doesn't displace one
+ * which is already there and has the same address.
+ */
+static void
+lkAddrMerge(void *addr, CexpSymAIdx ar, int margin, CexpModule m, CexpSymTbl t, int strict)
 {
 const int      n = 2*margin + 1;
 int            i,cli,j;
 void           *tstaddr, *limaddr;
 CexpSymAIdxRec thisone;
-CexpModule     m;
-CexpSymTbl     t;
 
-	for ( i=0; i<n; i++ )
-		ar[i].mod = 0;	
+	thisone.mod = m;
+	thisone.tbl = t;
+	cli = cexpSymTblLkAddrIdx(addr, 0, 0, t);
+
+	/* Look for all addresses in this module which are lower
+	 * than the one we are looking for and which are closer
+	 * than what we already have.
+	 */
+	for ( i = cli; i>=0; i-- ) {
+		thisone.idx = i;
+		tstaddr = gaddr( &thisone );
+		limaddr = ar[0].mod ? gaddr(&ar[0]) : (void*)0;
+
+		/* if there is no entry [0] then there is space; we set 'limaddr' == 0 above
+		 * so the tstaddr < limaddr test can never succeed
+		 */
+		if ( tstaddr > addr || tstaddr < limaddr || (strict && ar[0].mod && tstaddr == limaddr) )
+			break; 
 
-	__RLOCK();
+		for ( j=1; j<=margin && ( ! ar[j].mod || tstaddr > gaddr(&ar[j]) ); j++ ) {
+			ar[j-1] = ar[j];
+		}
+		ar[j-1] = thisone;
+	}
 
-	for ( m = cexpSystemModule; m; m=m->next ) {
 
-		if ( !addrInModule(addr, m) )
-			continue;
+	for ( i = cli+1; i < t->nentries; i++ ) {
+		thisone.idx = i;
+		tstaddr = gaddr( &thisone );
+		limaddr = ar[n-1].mod ? gaddr(&ar[n-1]) : (void*)UINTPTR_MAX;
 
-		t = m->symtbl;
-		thisone.mod = m;
-		cli = cexpSymTblLkAddrIdx(addr, 0, 0, t);
-
-		/* Look for all addresses in this module which are lower
-		 * than the one we are looking for and which are closer
-		 * than what we already have.
+		/* if there is no entry [n-1] then there is space;
+		 * we set 'limaddr' == UINTPTR_MAX above
+		 * so the tstaddr > limaddr test can never succeed
 		 */
-		for ( i = cli; i>=0; i-- ) {
-			thisone.idx = i;
-			tstaddr = gaddr( &thisone );
-			limaddr = ar[0].mod ? gaddr(&ar[0]) : (void*)0;
-
-			/* if there is no entry [0] then there is space; we set 'limaddr' == 0 above
-			 * so the tstaddr < limaddr test can never succeed
-			 */
-			if ( tstaddr > addr || tstaddr < limaddr )
-				break; 
+		if ( tstaddr <= addr || tstaddr > limaddr || (strict && ar[n-1].mod && tstaddr == limaddr) )
+			break;
 
-			for ( j=1; j<=margin && ( ! ar[j].mod || tstaddr > gaddr(&ar[j]) ); j++ ) {
-				ar[j-1] = ar[j];
-			}
-			ar[j-1].idx = i;
-			ar[j-1].mod = m;
+		for ( j=n-2; j>margin && (! ar[j].mod || tstaddr < gaddr(&ar[j]) ); j-- ) {
+			ar[j+1] = ar[j];
 		}
+		ar[j+1] = thisone;
+	}
+}
 
+/* Only a few modules can hold 'addr': the system module (whose
+ * range may enclose other modules), the one with a segment
+ * covering it and a shared library (lazy table) mapped there;
+ * store them in list order in 'cand'.
+ *
+ * RETURNS: number of modules stored (at most 3).
+ */
+static int
+addrModules(void *addr, CexpModule *cand)
+{
+CexpModule	m;
+int			nc = 0;
 
-		for ( i = cli+1; i < t->nentries; i++ ) {
-			thisone.idx = i;
-			tstaddr = gaddr( &thisone );
-			limaddr = ar[n-1].mod ? gaddr(&ar[n-1]) : (void*)UINTPTR_MAX;
+	if ( (m = cexpSystemModule) && addrInModule(addr, m) )
+		cand[nc++] = m;
+	if ( (m = lazyLookup(addr)) )
+		cand[nc++] = m;
+#ifdef USE_LOADER
+	if ( (m = amapLookup(modIdx, addr)) )
+		cand[nc++] = m;
+#endif
+	return nc;
+}
 
-			/* if there is no entry [n-1] then there is space;
-			 * we set 'limaddr' == UINTPTR_MAX above
-			 * so the tstaddr > limaddr test can never succeed
-			 */
-			if ( tstaddr <= addr || tstaddr > limaddr )
-				break;
+void
+cexpSymLkAddrRange(void *addr, CexpSymAIdx ar, int margin)
+{
+const int      n = 2*margin + 1;
+int            i,k,nc;
+CexpModule     m, cand[3];
+CexpSymTbl     t;
+CexpEpochTok	rd;
 
-			for ( j=n-2; j>margin && (! ar[j].mod || tstaddr < gaddr(&ar[j]) ); j-- ) {
-				ar[j+1] = ar[j];
-			}
-			ar[j+1].idx = i;
-			ar[j+1].mod = m;
-		}
+	for ( i=0; i<n; i++ )
+		ar[i].mod = 0;	
+
+	__RLOCK(&rd);
+
+	/* no module covers 'addr'; it might be in a library which
+	 * was dlopen()ed in the meantime.
+	 */
+	if ( 0 == (nc = addrModules(addr, cand)) && cexpLoadFileChanged() ) {
+		__RUNLOCK(&rd);
+		cexpModuleRescan();
+		__RLOCK(&rd);
+		nc = addrModules(addr, cand);
+	}
+
+	for ( k = 0; k < nc; k++ ) {
+
+		m = cand[k];
+
+		t = m->symtbl;
+
+		/* the address index of a lazy table is built on first use */
+		if ( cexpSymTblFill(t) || 0 == t->nentries )
+			continue;
+
+		lkAddrMerge(addr, ar, margin, m, t, 0);
+
+		/* static functions and objects (globals take precedence) */
+		if ( (t = cexpSymTblLocals(t)) )
+			lkAddrMerge(addr, ar, margin, m, t, 1);
 	}
 
-	__RUNLOCK();
+	__RUNLOCK(&rd);
 }
 
 /* search for (the closest) address in all modules giving its
@@ -279,49 +1299,274 @@ CexpSymTbl     t;
  * RETURNS: -1 if not found (i.e. within the boundaries of) any module.
  */
 int
-cexpSymLkAddrIdx(void *addr, int margin, FILE *f, CexpModule *pmod)
+cexpSymLkAddrIdx(void *addr, int margin, FILE *f, CexpModule *pmod, CexpSymTbl *ptbl)
 {
 CexpSymAIdxRec ar[margin<0 ? 1 : 2*margin+1];
 int            i;
 CexpModule	   mfnd = 0, m;
 
-	if ( margin < 0 || !f )
-		margin = 0;
+	if ( margin < 0 || !f )
+		margin = 0;
+
+	cexpSymLkAddrRange(addr, ar, margin);
+
+	if ( f ) {
+		for ( i=0; i<2*margin+1; i++ ) {
+			if ( ! (m = ar[i].mod) )
+				continue;
+			if ( mfnd != m ) {
+				fprintf(f,"=====  In module '%s' =====:\n",m->name);
+				mfnd = m;
+			}
+			cexpSymPrintInfo( cexpSymTblResolve(ar[i].tbl, CEXP_ASYM(ar[i].tbl, ar[i].idx)), f );
+		}
+	}
+
+	if ( pmod ) 
+		*pmod = ar[margin].mod;
+	if ( ptbl )
+		*ptbl = ar[margin].mod ? ar[margin].tbl : 0;
+
+	return ar[margin].mod ? ar[margin].idx : -1;
+}
+
+/* search for an address in all modules */
+CexpSym
+cexpSymLkAddr(void *addr, int margin, FILE *f, CexpModule *pmod)
+{
+int			i;
+CexpSymTbl	t;
+
+	i=cexpSymLkAddrIdx(addr,margin,f,pmod,&t);
+
+	return i >= 0 ? cexpSymTblResolve(t, CEXP_ASYM(t, i)) : 0;
+}
+
+
+/* address to resolve, in cexpSymLkAddrBatch() */
+typedef struct BatchAddrRec_ {
+	myuintptr_t	a;
+	int			i;		/* position in the caller's array */
+} BatchAddrRec, *BatchAddr;
+
+/* LSD radix sort by address (stable, i.e., equal addresses stay
+ * in the caller's order); 'tmp' provides space for 'n' entries.
+ */
+static BatchAddr
+batchSort(BatchAddr ba, BatchAddr tmp, int n)
+{
+unsigned long	cnt[256], sum, c;
+BatchAddr		x;
+unsigned		sh;
+int				i;
+
+	for ( sh = 0; sh < 8*sizeof(myuintptr_t); sh += 8 ) {
+		memset(cnt, 0, sizeof(cnt));
+		for ( i=0; i<n; i++ )
+			cnt[ (ba[i].a >> sh) & 0xff ]++;
+		/* all keys have the same digit; nothing to do */
+		if ( n == cnt[ (ba[0].a >> sh) & 0xff ] )
+			continue;
+		for ( c = 0, sum = 0; c < 256; c++ ) {
+			sum    += cnt[c];
+			cnt[c]  = sum - cnt[c];
+		}
+		for ( i=0; i<n; i++ )
+			tmp[ cnt[ (ba[i].a >> sh) & 0xff ]++ ] = ba[i];
+		x   = ba;
+		ba  = tmp;
+		tmp = x;
+	}
+	return ba;
+}
+
+static myuintptr_t
+aaddr(CexpSymTbl t, unsigned long i)
+{
+	return (myuintptr_t)CEXP_ASYM(t,i)->value.ptv;
+}
+
+/* Advance 'j' to the last entry of the address index at or below
+ * 'a' ('j' must not be beyond it). Gallops, so that a few sparse
+ * addresses don't cost a walk through the entire table.
+ */
+static unsigned long
+aidxAdvance(CexpSymTbl t, unsigned long j, myuintptr_t a)
+{
+unsigned long step, hi, mid;
+
+	for ( step = 1; j + step < t->nentries && aaddr(t, j + step) <= a; step <<= 1 )
+		j += step;
+
+	/* the entry is in [j, j + step) */
+	hi = j + step < t->nentries ? j + step : t->nentries;
+	while ( hi - j > 1 ) {
+		mid = (j + hi) >> 1;
+		if ( aaddr(t, mid) <= a )
+			j  = mid;
+		else
+			hi = mid;
+	}
+	return j;
+}
+
+/* resolve the sorted addresses ba[i..] below 'hi' in table 't' of
+ * module 'm'; unless 'strict' is zero, the symbols found already
+ * take precedence over ones of 't' at the same address.
+ */
+static int
+batchResolveTbl(CexpModule m, CexpSymTbl t, int strict, BatchAddr ba, int i, int n, myuintptr_t hi, CexpSym *syms, CexpModule *mods)
+{
+CexpSym			s;
+unsigned long	j;
+int				k;
+
+	for ( j = 0; i < n && ba[i].a < hi; i++ ) {
+		if ( ! t->nentries )
+			continue;
+		j = aidxAdvance(t, j, ba[i].a);
+		if ( aaddr(t, j) > ba[i].a )
+			continue;
+		s = CEXP_ASYM(t, j);
+		k = ba[i].i;
+		/* same precedence as cexpSymLkAddrRange() */
+		if ( ! syms[k] || (char*)s->value.ptv > (char*)syms[k]->value.ptv
+		     || ( ! strict && s->value.ptv == syms[k]->value.ptv ) ) {
+			syms[k] = cexpSymTblResolve(t, s);
+			if ( mods )
+				mods[k] = m;
+		}
+	}
+	return i;
+}
+
+/* resolve the sorted addresses ba[i..] below 'hi' in module 'm' */
+static int
+batchResolve(CexpModule m, BatchAddr ba, int i, int n, myuintptr_t hi, CexpSym *syms, CexpModule *mods)
+{
+CexpSymTbl	t;
+int			l;
+
+	l = batchResolveTbl(m, m->symtbl, 0, ba, i, n, hi, syms, mods);
+	if ( l > i && (t = cexpSymTblLocals(m->symtbl)) )
+		batchResolveTbl(m, t, 1, ba, i, l, hi, syms, mods);
+	return l;
+}
+
+/* resolve the 'n' sorted addresses 'ba' in all modules (read
+ * lock held); clears the results first.
+ */
+static void
+batchResolveAll(BatchAddr ba, int n, CexpSym *syms, CexpModule *mods)
+{
+CexpModule		m;
+int				i, l;
+#ifdef USE_LOADER
+CexpAddrMap		c;
+CexpModIdx		x;
+#endif
+
+	for ( i=0; i<n; i++ ) {
+		syms[i] = 0;
+		if ( mods )
+			mods[i] = 0;
+	}
+
+	/* the system module (which may enclose others) first */
+	if ( (m = cexpSystemModule) ) {
+		for ( i = 0; i < n; i = l ) {
+			for ( ; i < n && ! addrInModule((void*)ba[i].a, m); i++ )
+				/* nothing else to do */;
+			for ( l = i; l < n && addrInModule((void*)ba[l].a, m); l++ )
+				/* nothing else to do */;
+			batchResolve(m, ba, i, l, UINTPTR_MAX, syms, mods);
+		}
+	}
+
+	/* shared libraries (lazy tables); their index is built only
+	 * if any address falls into their range.
+	 */
+	for ( m = cexpSystemModule && lazyModules ? cexpSystemModule->next : 0; m; m = m->next ) {
+		if ( ! m->symtbl->lazy )
+			continue;
+		for ( i = 0, l = n; i < l; ) {
+			if ( ba[(i + l) >> 1].a < m->symtbl->lazy->lo )
+				i = ((i + l) >> 1) + 1;
+			else
+				l = (i + l) >> 1;
+		}
+		if ( i < n && ba[i].a < m->symtbl->lazy->hi && ! cexpSymTblFill(m->symtbl) )
+			batchResolve(m, ba, i, n, m->symtbl->lazy->hi, syms, mods);
+	}
+
+#ifdef USE_LOADER
+	/* the segments of all other modules are disjoint; skip
+	 * to the next one along with the addresses.
+	 */
+	for ( i = 0, x = modIdx; i < n && (c = amapCeil(x, ba[i].a)); ) {
+		if ( ba[i].a < c->lo ) {
+			while ( ++i < n && ba[i].a < c->lo )
+				/* nothing else to do */;
+		} else {
+			i = batchResolve(c->mod, ba, i, n, c->hi, syms, mods);
+		}
+	}
+#endif
+}
+
+int
+cexpSymLkAddrBatch(void **addr, int n, CexpSym *syms, CexpModule *mods, unsigned long *offs)
+{
+BatchAddr		buf = 0, ba;
+CexpModule		cand[3];
+int				i, rval = -1;
+CexpEpochTok	rd;
+
+	if ( n <= 0 )
+		return 0;
 
-	cexpSymLkAddrRange(addr, ar, margin);
+	if ( ! (buf = malloc(2 * n * sizeof(*buf))) )
+		goto cleanup;
 
-	if ( f ) {
-		for ( i=0; i<2*margin+1; i++ ) {
-			if ( ! (m = ar[i].mod) )
-				continue;
-			if ( mfnd != m ) {
-				fprintf(f,"=====  In module '%s' =====:\n",m->name);
-				mfnd = m;
-			}
-			cexpSymPrintInfo( m->symtbl->aindex[ar[i].idx], f );
-		}
+	for ( i=0, ba=buf; i<n; i++ ) {
+		ba[i].a = (myuintptr_t)addr[i];
+		ba[i].i = i;
+		if ( offs )
+			offs[i] = 0;
 	}
 
-	if ( pmod ) 
-		*pmod = ar[margin].mod;
+	ba = batchSort(ba, buf + n, n);
 
-	return ar[margin].mod ? ar[margin].idx : -1;
-}
+	__RLOCK(&rd);
 
-/* search for an address in all modules */
-CexpSym
-cexpSymLkAddr(void *addr, int margin, FILE *f, CexpModule *pmod)
-{
-int			i;
-CexpModule	m;
+	batchResolveAll(ba, n, syms, mods);
+
+	/* addresses no module covers might be in a library which
+	 * was dlopen()ed in the meantime.
+	 */
+	for ( i=0; i<n && (syms[ba[i].i] || addrModules((void*)ba[i].a, cand)); i++ )
+		/* nothing else to do */;
+	if ( i < n && cexpLoadFileChanged() ) {
+		__RUNLOCK(&rd);
+		cexpModuleRescan();
+		__RLOCK(&rd);
+		batchResolveAll(ba, n, syms, mods);
+	}
 
-	if (!pmod)
-		pmod = &m;
-	i=cexpSymLkAddrIdx(addr,margin,f,pmod);
+	__RUNLOCK(&rd);
 
-	return i >= 0 ? (*pmod)->symtbl->aindex[i] : 0;
-}
+	for ( i = 0, rval = 0; i < n; i++ ) {
+		if ( syms[i] ) {
+			if ( offs )
+				offs[i] = (char*)addr[i] - (char*)syms[i]->value.ptv;
+			rval++;
+		}
+	}
 
+cleanup:
+	free(buf);
+	return rval;
+}
 
 int
 cexpAddrFind(void **addr, char *buf, int size)
@@ -347,17 +1592,63 @@ cexpModuleName(CexpModule mod)
 	return mod->name;
 }
 
+/* scan one module's table for matches of 'rc' starting at 's'
+ * (NULL: at the beginning); the module header counts as one of
+ * the '*pmax' lines.
+ *
+ * RETURNS: the symbol at which '*pmax' was exhausted, NULL if
+ *          the end of the table was reached first.
+ */
+static CexpSym
+regexScanModule(cexp_regex *rc, int *pmax, CexpSym s, FILE *f, CexpModule m)
+{
+CexpSymTblScanRec	sc;
+CexpSym				rval = 0;
+int					found = 0;
+
+	/* only look at the names which can match; 'scoped' ones are
+	 * the demangled names (the caller fills the table for these,
+	 * see dmglTable()).
+	 */
+	if ( ! rc->scoped )
+		cexpSymTblFill(m->symtbl);
+	cexpSymTblScanInit(&sc, rc, m->symtbl);
+	if (!s || s < sc.first) s=sc.first;
+	for (; s < sc.last && *pmax; s++) {
+		if (cexpSymTblScanMatch(&sc,rc,m->symtbl,s)) {
+			if (!found) {
+				if (f) fprintf(f,"=====  In module '%s' (0x%08"MYPRIxPTR") =====:\n",m->name, (myuintptr_t)m);
+				found=1; /* print module name only once */
+				(*pmax)--;
+			}
+			cexpSymTblResolve(m->symtbl,s);
+			if (f) cexpSymPrintInfoAs(s,sc.dn ? sc.dn[s - m->symtbl->syms] : s->name,f);
+			if (--(*pmax) <= 0) {
+				rval=s;
+				break;
+			}
+		}
+	}
+	cexpSymTblScanFini(&sc);
+	return rval;
+}
+
 /* see comments in cexpsyms.c about this routine. The version
  * here is just a wrapper for looping over modules
  */
 CexpSym
 _cexpSymLookupRegex(cexp_regex *rc, int *pmax, CexpSym s, FILE *f, CexpModule *pmod)
 {
-CexpModule	m=0,mfound;
-int			max=24;
+CexpModule			m=0;
+int					max=24;
+CexpEpochTok	rd;
 
 	if (!pmax)	pmax=&max;
 
+	/* don't pull modules from under a scan in progress */
+	if (!s)
+		lazyRescan();
+
 	if (pmod)	{
 		/* start at module/symbol passed in */
 		m=*pmod;
@@ -372,78 +1663,428 @@ int			max=24;
 	}
 	if (!m)	m=cexpSystemModule;
     
-	__RLOCK();
+	__RLOCK(&rd);
 
-	if (modIsStale(m)) {
-		__RUNLOCK();
+	if (modIsStale(m, 0)) {
+		__RUNLOCK(&rd);
 		fprintf(f ? f : stderr,"Got a stale module handle; giving up...\n");
 		return 0;
 	}
 
-	for (; m; m=m->next) {
-    	if (!s) s=m->symtbl->syms;
-		mfound=0;
-		while (s->name && *pmax) {
-      		if (cexp_regexec(rc,s->name)) {
-				if (!mfound) {
-					if (f) fprintf(f,"=====  In module '%s' (0x%08"MYPRIxPTR") =====:\n",m->name, (myuintptr_t)m);
-					mfound=m; /* print module name only once */
-					(*pmax)--;
-				}
-				if (f) cexpSymPrintInfo(s,f);
-				if (--(*pmax) <= 0) {
-					if (pmod)
-						*pmod=m;
+	for (; m; m=m->next, s=0) {
+		/* 'scoped' expressions match the demangled names */
+		if (rc->scoped)
+			dmglTable(m, 0);
+		if ( (s = regexScanModule(rc, pmax, s, f, m)) ) {
+			if (pmod)
+				*pmod=m;
+			break;
+		}
+	}
 
-					__RUNLOCK();
-					return s;
-				}
-			}
-			s++;
+	__RUNLOCK(&rd);
+
+    return s;
+}
+
+/* Module snapshots; every module holds one reference for being
+ * on the list and one for each snapshot it is part of. Whoever
+ * drops the last one releases it.
+ */
+struct CexpModSnapRec_ {
+	int			n;
+	CexpModule	*mods;
+};
+
+static void
+modUnref(CexpModule m)
+{
+	if ( 0 == CEXP_ATOMIC_ADD(&m->refs, -1) )
+		cexpModuleFree(&m);
+}
+
+CexpModSnap
+cexpModuleSnapshot(void)
+{
+CexpModSnap	rval;
+CexpModule	m;
+int			n;
+CexpEpochTok	rd;
+
+	__RLOCK(&rd);
+
+	for ( n = 0, m = cexpSystemModule; m; m = m->next )
+		n++;
+
+	if ( (rval = malloc(sizeof(*rval) + n * sizeof(rval->mods[0]))) ) {
+		rval->mods = (CexpModule*)(rval + 1);
+		for ( rval->n = 0, m = cexpSystemModule; m; m = m->next ) {
+			CEXP_ATOMIC_ADD(&m->refs, 1);
+			rval->mods[rval->n++] = m;
 		}
+	}
+
+	__RUNLOCK(&rd);
+
+	return rval;
+}
+
+CexpModule
+cexpModSnapModule(CexpModSnap snap, int i)
+{
+	return snap && i >= 0 && i < snap->n ? snap->mods[i] : 0;
+}
+
+void
+cexpModuleSnapshotRelease(CexpModSnap snap)
+{
+int i;
+
+	if ( snap ) {
+		for ( i = 0; i < snap->n; i++ )
+			modUnref(snap->mods[i]);
+		free(snap);
+	}
+}
+
+/* Same as _cexpSymLookupRegex() but scans the modules of a
+ * snapshot (from module '*pidx' on) without holding the lock.
+ */
+CexpSym
+_cexpSymLookupRegexSnap(cexp_regex *rc, int *pmax, CexpSym s, FILE *f, CexpModSnap snap, int *pidx)
+{
+int					max=24, i;
+CexpEpochTok	rd;
+
+	if (!pmax)	pmax=&max;
+
+	i = *pidx;
+
+	if (s && !(++s)->name) {
+		/* was the last one */
 		s=0;
+		i++;
 	}
 
-	__RUNLOCK();
+	for (; i < snap->n; i++, s=0) {
+		/* 'scoped' expressions match the demangled names */
+		if (rc->scoped) {
+			__RLOCK(&rd);
+			dmglTable(snap->mods[i], 0);
+			__RUNLOCK(&rd);
+		}
+		if ( (s = regexScanModule(rc, pmax, s, f, snap->mods[i])) ) {
+			*pidx = i;
+			return s;
+		}
+	}
 
-    return 0;
+	*pidx = i;
+	return 0;
 }
 
+/* state of a _cexpSymLookupPrefix() operation */
+typedef struct PrefixLkRec_ {
+	const char	*pfx;
+	int			plen;
+	int			count;
+	char		*ext;
+	int			elen;		/* < 0 while there is no name yet */
+	int			extsz;
+	void		(*cb)(CexpSym s, void *arg);
+	void		*arg;
+} PrefixLkRec, *PrefixLk;
+
+/* shorten the common extension to what 'name' (of 'len' chars)
+ * shares with it
+ */
 static void
-bitmapInfo(FILE *f, BitmapWord *bm)
+prefixExtN(PrefixLk pl, const char *name, unsigned long len)
 {
-CexpModule m;
+int i;
 
-	for (m=cexpSystemModule; m; m=m->next) {
-		if (BITMAP_TST(bm, m->id))
+	if ( ! pl->ext )
+		return;
+
+	name += pl->plen;
+	len  -= pl->plen;
+
+	if ( pl->elen < 0 ) {
+		for ( i = 0; i < pl->extsz - 1 && i < len; i++ )
+			pl->ext[i] = name[i];
+	} else {
+		for ( i = 0; i < pl->elen && i < len && name[i] == pl->ext[i]; i++ )
+			/* nothing else to do */;
+	}
+	pl->ext[pl->elen = i] = 0;
+}
+
+static void
+prefixExt(PrefixLk pl, const char *name)
+{
+	prefixExtN(pl, name, strlen(name));
+}
+
+static void *
+prefixCountVar(const char *name, CexpSym s, void *arg)
+{
+PrefixLk pl = arg;
+
+	if ( ! strncmp(name, pl->pfx, pl->plen) ) {
+		pl->count++;
+		prefixExt(pl, name);
+	}
+	return 0;
+}
+
+static void *
+prefixVisitVar(const char *name, CexpSym s, void *arg)
+{
+PrefixLk pl = arg;
+
+	if ( ! strncmp(name, pl->pfx, pl->plen) )
+		pl->cb(s, pl->arg);
+	return 0;
+}
+
+/* count the symbols of all modules whose names start with
+ * the prefix and update the common extension (read lock held);
+ * the matching names of each table are adjacent and sorted,
+ * i.e., the first and last ones have the common extension.
+ */
+static void
+prefixCountMods(PrefixLk pl)
+{
+CexpModule		m;
+CexpSym			s;
+unsigned long	n;
+
+	for ( m = cexpSystemModule; m; m = m->next ) {
+		cexpSymTblFill(m->symtbl);
+		if ( (n = cexpSymTblPrefixRange(pl->pfx, m->symtbl, &s)) ) {
+			pl->count += n;
+			prefixExt(pl, cexpSymTblResolve(m->symtbl, s)->name);
+			prefixExt(pl, cexpSymTblResolve(m->symtbl, s + n - 1)->name);
+		}
+	}
+}
+
+/* Count the symbols (of all modules) and user variables whose
+ * names start with 'pfx' and store the longest extension they
+ * have in common in 'ext' (at most 'extsz' - 1 chars plus NUL;
+ * 'ext' may be NULL). If there are no more than 'max' names
+ * then 'cb' (if non-NULL) is called for every one of them.
+ *
+ * RETURNS: number of names starting with 'pfx'.
+ *
+ * NOTE: this is a semi-public routine (for command line completion);
+ *       'cb' is executed with the module lock held for reading.
+ */
+int
+_cexpSymLookupPrefix(const char *pfx, int max, char *ext, int extsz, void (*cb)(CexpSym s, void *arg), void *arg)
+{
+PrefixLkRec		pl;
+CexpModule		m;
+CexpSym			s;
+unsigned long	n, i;
+int				nvar;
+CexpEpochTok	rd;
+
+	pl.pfx   = pfx;
+	pl.plen  = strlen(pfx);
+	pl.count = 0;
+	pl.ext   = extsz > 0 ? ext : 0;
+	pl.elen  = -1;
+	pl.extsz = extsz;
+	pl.cb    = cb;
+	pl.arg   = arg;
+
+	if ( pl.ext )
+		*pl.ext = 0;
+
+	/* user variables are few; just look at all of them */
+	cexpVarWalk(prefixCountVar, &pl);
+
+	nvar = pl.count;
+
+	__RLOCK(&rd);
+
+	prefixCountMods(&pl);
+
+	/* no symbol matches; maybe one of a library which was
+	 * dlopen()ed in the meantime.
+	 */
+	if ( nvar == pl.count && cexpLoadFileChanged() ) {
+		__RUNLOCK(&rd);
+		cexpModuleRescan();
+		__RLOCK(&rd);
+		prefixCountMods(&pl);
+	}
+
+	if ( cb && pl.count <= max ) {
+		for ( m = cexpSystemModule; m; m = m->next ) {
+			n = cexpSymTblPrefixRange(pfx, m->symtbl, &s);
+			for ( i = 0; i < n; i++ )
+				cb(cexpSymTblResolve(m->symtbl, s + i), arg);
+		}
+	}
+
+	__RUNLOCK(&rd);
+
+	if ( cb && pl.count <= max )
+		cexpVarWalk(prefixVisitVar, &pl);
+
+	return pl.count;
+}
+
+/* same qualified name as the preceding entry (overloads) */
+#define DMGL_SAME(e)	( (e)[0].qlen == (e)[-1].qlen && ! memcmp((e)[0].name, (e)[-1].name, (e)[0].qlen) )
+
+/* count the qualified names of all modules which start with
+ * the prefix and update the common extension (read lock held)
+ */
+static void
+dmglCountMods(PrefixLk pl)
+{
+CexpModule		m;
+CexpDmglEnt		e;
+unsigned long	n, i;
+const char		*key;
+char			buf[80];
+
+	key = dmglKey(pl->pfx, 1, buf, sizeof(buf));
+
+	for ( m = cexpSystemModule; m; m = m->next ) {
+		if ( dmglTable(m, key) && (n = cexpSymTblDemangledRange(pl->pfx, m->symtbl, &e)) ) {
+			for ( i = 0; i < n; i++ ) {
+				if ( 0 == i || ! DMGL_SAME(e + i) )
+					pl->count++;
+			}
+			prefixExtN(pl, e[0].name, e[0].qlen);
+			prefixExtN(pl, e[n-1].name, e[n-1].qlen);
+		}
+	}
+}
+
+/* Like _cexpSymLookupPrefix() but for the qualified demangled
+ * (C++) names; overloaded functions count (and are visited) once.
+ * 'cb' is passed the qualified name which is not NUL-terminated
+ * after 'len' chars. There are no user variables with such names.
+ *
+ * NOTE: this is a semi-public routine (for command line completion);
+ *       'cb' is executed with the module lock held for reading.
+ */
+int
+_cexpSymLookupDemangledPrefix(const char *pfx, int max, char *ext, int extsz, void (*cb)(CexpSym s, const char *name, int len, void *arg), void *arg)
+{
+PrefixLkRec		pl;
+CexpModule		m;
+CexpDmglEnt		e;
+unsigned long	n, i;
+CexpEpochTok	rd;
+
+	pl.pfx   = pfx;
+	pl.plen  = strlen(pfx);
+	pl.count = 0;
+	pl.ext   = extsz > 0 ? ext : 0;
+	pl.elen  = -1;
+	pl.extsz = extsz;
+	pl.cb    = 0;
+	pl.arg   = arg;
+
+	if ( pl.ext )
+		*pl.ext = 0;
+
+	__RLOCK(&rd);
+
+	dmglCountMods(&pl);
+
+	/* nothing; maybe in a library dlopen()ed in the meantime */
+	if ( 0 == pl.count && cexpLoadFileChanged() ) {
+		__RUNLOCK(&rd);
+		cexpModuleRescan();
+		__RLOCK(&rd);
+		dmglCountMods(&pl);
+	}
+
+	if ( cb && pl.count <= max ) {
+		for ( m = cexpSystemModule; m; m = m->next ) {
+			n = cexpSymTblDemangledRange(pfx, m->symtbl, &e);
+			for ( i = 0; i < n; i++ ) {
+				if ( 0 == i || ! DMGL_SAME(e + i) )
+					cb(cexpSymTblResolve(m->symtbl, e[i].sym), e[i].name, e[i].qlen, arg);
+			}
+		}
+	}
+
+	__RUNLOCK(&rd);
+
+	return pl.count;
+}
+
+static void
+needsInfo(FILE *f, CexpModule mod)
+{
+unsigned i;
+
+	for ( i = 0; i < mod->nNeeds; i++ )
+		fprintf(f," %s",mod->needs[i]->name);
+}
+
+/* print the modules which depend on 'mod'; walks the
+ * list (write lock held) if there is no snapshot.
+ */
+static void
+neededByInfo(FILE *f, CexpModule mod, CexpModSnap snap)
+{
+CexpModule	m;
+unsigned	j;
+int			i = 0;
+
+	for ( m = snap ? cexpModSnapModule(snap, 0) : cexpSystemModule; m; m = snap ? cexpModSnapModule(snap, ++i) : m->next ) {
+		for ( j = 0; j < m->nNeeds && m->needs[j] != mod; j++ )
+			/* nothing else to do */;
+		if ( j < m->nNeeds )
 			fprintf(f," %s",m->name);
 	}
 }
 
+/* The callbacks run w/o the lock held on a snapshot (they may
+ * print to a slow stream).
+ */
 CexpModule
 cexpModIterate(CexpModule mod, FILE *f, void mcallback(CexpModule m, FILE *f, void *arg), void *arg)
 {
-CexpModule m = mod ? mod : cexpSystemModule;
+CexpModSnap	snap;
+int			i;
 
 	if (!f) f=stdout;
 
-	__RLOCK();
+	lazyRescan();
+
+	if ( ! (snap = cexpModuleSnapshot()) ) {
+		fprintf(f,"No memory for module list\n");
+		return 0;
+	}
+
+	for ( i = 0; i < snap->n && mod && snap->mods[i] != mod; i++ )
+		/* nothing else to do */;
 
-	if (modIsStale(m)) {
-		__RUNLOCK();
+	if ( i >= snap->n ) {
+		cexpModuleSnapshotRelease(snap);
 		fprintf(f,"Got a stale module handle; giving up...\n");
 		return 0;
 	}
 
-	for (; m; m=m->next) {
-		mcallback(m, f, arg);
+	for (; i < snap->n; i++) {
+		mcallback(snap->mods[i], f, arg);
 		if (mod) {
-			mod = mod->next;
+			mod = cexpModSnapModule(snap, i+1);
 			break; /* info only for the particular module requested */
 		}
 	}
 
-	__RUNLOCK();
+	cexpModuleSnapshotRelease(snap);
 
 	return mod;
 }
@@ -454,13 +2095,15 @@ modPrintInfo(CexpModule m, FILE *f, void *closure)
 myintptr_t	level = (myintptr_t)closure;
 CexpSym	*psects;
 CexpSegment s;
+CexpModSnap	snap;
 	fprintf(f,"Module '%s' (0x%08"MYPRIxPTR"):\n",
 				m->name, (myuintptr_t)m);
 	if ( level > 0 )
 		fprintf(f,"Full path '%s'\n",m->fileName);
 	if ( level > 1 ) {
-		fprintf(f,"  %li symbol table entries\n",
-						m->symtbl->nentries);
+		fprintf(f,"  %li symbol table entries%s\n",
+						m->symtbl->nentries,
+						m->symtbl->lazy && ! m->symtbl->lazy->filled ? " (not populated yet)" : "");
 		fprintf(f,"  %li bytes of memory allocated to binary\n",
 						m->memSize);
 		if ( m->segs ) {
@@ -476,8 +2119,13 @@ CexpSegment s;
 	fprintf(f,"  Text starts at: 0x%08x\n",
 					(unsigned)m->text_vma);
 	if ( level > 0 ) {
-		fprintf(f,"  Needs:"); bitmapInfo(f,m->needs); fputc('\n',f);
-		fprintf(f,"  Needed by:"); bitmapInfo(f,m->neededby); fputc('\n',f);
+		fprintf(f,"  Needs:"); needsInfo(f,m); fputc('\n',f);
+		if ( m->nNeededBy && (snap = cexpModuleSnapshot()) ) {
+			fprintf(f,"  Needed by:"); neededByInfo(f,m,snap); fputc('\n',f);
+			cexpModuleSnapshotRelease(snap);
+		} else {
+			fprintf(f,"  Needed by:\n");
+		}
 	}
 	if ( level > 2 && ( psects = m->section_syms ) ) {
 		fprintf(f,"  Section load info:\n");
@@ -520,23 +2168,56 @@ cexpModuleDumpGdbSectionInfo(CexpModule mod, const char *prefix, FILE *feil)
 	return cexpModIterate(mod, feil, modPrintGdbSects, (void*)prefix);
 }
 
+/* A pattern "^name$" (no other special characters)
+ * matches nothing but 'name'.
+ *
+ * RETURNS: length of 'name', 0 if 'needle' is not
+ *          such a pattern.
+ */
+static int
+literalName(const char *needle)
+{
+int l = strlen(needle);
+
+	if ( l < 3 || '^' != needle[0] || '$' != needle[l-1] )
+		return 0;
+	return (int)strcspn(needle+1, ".[]()*+?{}|\\^$") == l-2 ? l-2 : 0;
+}
+
 CexpModule
 cexpModuleFindByName(const char *needle, FILE *f)
 {
 cexp_regex	*rc=0;
 CexpModule	m,found=0;
+CexpEpochTok	rd;
+char		*name;
+int			l;
 
 	if (!f)
 		f=stdout;
 	else if (CEXP_FILE_QUIET == f)
 		f=0;
 
+	/* exact names are looked up in the registry */
+	if ( (l = literalName(needle)) && (name = malloc(l+1)) ) {
+		memcpy(name, needle+1, l);
+		name[l] = 0;
+
+		__RLOCK(&rd);
+		if ( (found = modFind(modIdx, name)) && f )
+			fprintf(f,"0x%08"MYPRIxPTR": %s\n",(myuintptr_t)found, found->name);
+		__RUNLOCK(&rd);
+
+		free(name);
+		return found;
+	}
+
 	if (!(rc=cexp_regcomp(needle))) {
 		fprintf(stderr,"unable to compile regexp '%s'\n", needle);
 		return 0;
 	}
 
-	__RLOCK();
+	__RLOCK(&rd);
 
 	for (m=cexpSystemModule; m; m=m->next) {
 		if (cexp_regexec(rc,m->name)) {
@@ -550,54 +2231,72 @@ CexpModule	m,found=0;
 		}
 	}
 
-	__RUNLOCK();
+	__RUNLOCK(&rd);
 
 	cexp_regfree(rc);
 	return found;
 }
 
 #ifdef USE_LOADER
-int
-cexpModuleUnload(CexpModule mod)
+/* unload 'mod' or, if 'id' is nonzero, the module with that ID */
+static int
+moduleUnload(CexpModule mod, ModuleId id)
 {
-int			i;
-CexpModule	pred,m;
+unsigned	i;
+CexpModule	pred;
 CexpSegment s;
+CexpModIdx	nidx, old;
 
 	__WLOCK();
 
-	/* is mod in the list at all ? */
-	pred=predecessor(mod);
+	if ( id )
+		mod = modFindId(modIdx, id);
 
 	if (mod && mod==cexpSystemModule) {
 		fprintf(stderr,"Cannot unload system symbol table\n");
 		goto cleanup;
 	}
 
-	if (!mod || !pred) {
+	/* is mod in the list at all ? */
+	if (modIsStale(mod, id)) {
 		fprintf(stderr,"Cannot unload: bad module handle\n");
 		goto cleanup;
 	}
 
-	for (i=0; i<BITMAP_DEPTH; i++) {
-		if (mod->neededby[i]) {
-			fprintf(stderr,"Cannot unload %s; still needed by:", mod->name);
-			bitmapInfo(stderr,mod->neededby);
-			fputc('\n',stderr);
-			goto cleanup;
-		}
+	pred=mod->prev;
+
+	if (mod->nNeededBy) {
+		fprintf(stderr,"Cannot unload %s; still needed by:", mod->name);
+		neededByInfo(stderr,mod,0);
+		fputc('\n',stderr);
+		goto cleanup;
+	}
+
+	/* prepare the index before the module is finalized (this
+	 * needs memory); the lists are only modified once the
+	 * finalizer has agreed.
+	 */
+	if (    ! (nidx = idxCopy())
+	     || gsymDelModule(nidx, mod)
+	     || amapDelModule(nidx, mod)
+	     || modDel(nidx, mod) ) {
+		idxFree(nidx);
+		fprintf(stderr,"Cannot unload %s: no memory\n", mod->name);
+		goto cleanup;
 	}
 
 	if (mod->finiCallback && mod->finiCallback(mod)) {
+		idxFree(nidx);
 		fprintf(stderr,"Unload rejected by module finalizer!\n");
 		/* unload rejected by module */
 		goto cleanup;
 	}
 
 
-	/* remove from dependency bitmaps */
-	for (m=cexpSystemModule; m; m=m->next)
-		BITMAP_CLR(m->neededby, mod->id);
+	/* release the modules we depend on */
+	for (i=0; i<mod->nNeeds; i++)
+		mod->needs[i]->nNeededBy--;
+	mod->nNeeds = 0;
 
 	/* call destructors */
 	{
@@ -612,12 +2311,30 @@ CexpSegment s;
 	if (mod->cleanup)
 		mod->cleanup(mod);
 
-	/* remove from list */
-	pred->next=mod->next;
-	mod->next=0;
+	/* remove from list; readers still walking it may be
+	 * on 'mod' so its 'next' pointer is kept until they
+	 * are gone.
+	 */
+	PUBLISH(pred->next, mod->next);
+	if (mod->next)
+		mod->next->prev = pred;
+	else
+		lastModule = pred;
+	dropGen++;
+
+	gsymUnlink(nidx, mod);
+	old = idxPublish(nidx);
+	if ( mod->symtbl->lazy )
+		lazyModules--;
+
+	cexpSymGenerationBump();
 
 	__WUNLOCK();
 
+	__SYNC();
+	mod->next = 0;
+	idxFree(old);
+
 	if ( mod->segs ) {
 		for ( s = mod->segs; s->name; s++ ) {
 
@@ -647,7 +2364,8 @@ CexpSegment s;
 
 	/* could flush the caches here */
 
-	cexpModuleFree(&mod);
+	/* released once no snapshot holds it anymore */
+	modUnref(mod);
 
 	return 0;
 
@@ -655,49 +2373,74 @@ cleanup:
 	__WUNLOCK();
 	return -1;
 }
+
+int
+cexpModuleUnload(CexpModule mod)
+{
+	return moduleUnload(mod, 0);
+}
+
+int
+cexpModuleUnloadId(unsigned long id)
+{
+	return id ? moduleUnload(0, id) : -1;
+}
 #endif
 
-static void
-addDependencies(CexpModule nmod)
+unsigned long
+cexpModuleId(CexpModule mod)
 {
-CexpModule m;
-	for (m=cexpSystemModule; m; m=m->next) {
-		if (BITMAP_TST(nmod->needs,m->id))
-			BITMAP_SET(m->neededby,nmod->id);
-	}
+CexpEpochTok	rd;
+unsigned long	rval;
+
+	__RLOCK(&rd);
+	rval = modIsStale(mod, 0) ? 0 : mod->id;
+	__RUNLOCK(&rd);
+
+	return rval;
 }
 
-/* NOTE: the caller of this helper must hold the module lock
- *
- * This routine is NOT reentrant.
- *
- * RETURNS: new unused module id, -1 on error
- */
+CexpModule
+cexpModuleFindById(unsigned long id)
+{
+CexpEpochTok	rd;
+CexpModule		rval;
 
-static int
-idAlloc(CexpModule mod)
+	__RLOCK(&rd);
+	rval = id ? modFindId(modIdx, id) : 0;
+	__RUNLOCK(&rd);
+
+	return rval;
+}
+
+static void
+addDependencies(CexpModule nmod)
 {
-static ModuleId id=MAX_NUM_MODULES-1;
-ModuleId	new_id;
-BITMAP_DECLARE(used);
-CexpModule	m;
+unsigned i;
+	for (i=0; i<nmod->nNeeds; i++)
+		nmod->needs[i]->nNeededBy++;
+}
 
-	memset(used,0,sizeof(used));
+int
+cexpModuleAddNeed(CexpModule mod, CexpModule dep)
+{
+CexpModule	*n;
+unsigned	i;
 
-	/* mark all used ids */
-	for (m=cexpSystemModule; m; m=m->next) {
-			BITMAP_SET(used,m->id);
+	/* most likely a module we just recorded */
+	for (i=mod->nNeeds; i>0; i--) {
+		if (mod->needs[i-1] == dep)
+			return 0;
 	}
 
-	new_id = id;
-	do {
-		new_id = (new_id + 1) % MAX_NUM_MODULES;
-		if (new_id == id)
+	if (mod->nNeeds >= mod->needsSize) {
+		i = mod->needsSize ? 2*mod->needsSize : 4;
+		if ( ! (n = realloc(mod->needs, i * sizeof(*n))) )
 			return -1;
-	} while (BITMAP_TST(used,new_id));
-
-	mod->id=id=new_id;
-
+		mod->needs     = n;
+		mod->needsSize = i;
+	}
+	mod->needs[mod->nNeeds++] = dep;
 	return 0;
 }
 
@@ -705,6 +2448,11 @@ static CexpSym cexpNoBuiltinSymbols = 0;
 char           *cexpBuiltinCpuArch  = 0;
 
 extern CexpSym cexpSystemSymbols __attribute__((weak, alias("cexpNoBuiltinSymbols")));
+
+/* index of a (pre-sorted) table generated by recent versions of 'xsyms -C' */
+static const CexpSymTblPrebuiltRec *cexpNoBuiltinIndex = 0;
+
+extern const CexpSymTblPrebuiltRec *cexpSystemSymbolsIndex __attribute__((weak, alias("cexpNoBuiltinIndex")));
 #ifdef USE_PMBFD
 static unsigned      cexpNoBuiltinAttributesSize = 0;
 
@@ -727,13 +2475,30 @@ CexpSym s;
 			nsect_syms++;
 	}
 
-	if ( !(nmod->symtbl = cexpCreateSymTbl(cexpSystemSymbols, sizeof(*cexpSystemSymbols), nsyms, 0, 0, 0)) ) {
-		fprintf(stderr,"Reading builtin system symbol table failed\n");
-		return -1;
-	}
+	if ( cexpSystemSymbolsIndex ) {
+		/* sorted and typed already; the records may be read-only */
+		if ( !(nmod->symtbl = cexpInstallPrebuiltSymTbl(cexpSystemSymbols, cexpSystemSymbolsIndex)) ) {
+			fprintf(stderr,"Reading builtin system symbol table failed\n");
+			return -1;
+		}
+	} else {
+		if ( !(nmod->symtbl = cexpCreateSymTbl(cexpSystemSymbols, sizeof(*cexpSystemSymbols), nsyms, 0, 0, 0)) ) {
+			fprintf(stderr,"Reading builtin system symbol table failed\n");
+			return -1;
+		}
+
+		if ( cexpIndexSymTbl(nmod->symtbl) )
+			return -1;
 
-	if ( cexpIndexSymTbl(nmod->symtbl) )
-		return -1;
+		/* duplicates have been eliminated */
+		nsyms = nmod->symtbl->nentries;
+
+		for ( i = 0, s = cexpSystemSymbols; i<nsyms; i++, s++ ) {
+			/* guess type */
+			if ( TVoid == s->value.type )
+				s->value.type = cexpTypeGuessFromSize(s->size);
+		}
+	}
 
 	nmod->text_vma = 0xdeadbeef;
 
@@ -749,9 +2514,6 @@ CexpSym s;
 				nmod->text_vma = (unsigned long)s->value.ptv;
 			}
 		}
-		/* guess type */
-		if ( TVoid == s->value.type )
-			s->value.type = cexpTypeGuessFromSize(s->size);
 	}
 	nmod->section_syms[nsect_syms] = 0; /* tag end */
 
@@ -815,60 +2577,274 @@ cleanup:
 }
 
 
-CexpModule
-cexpModuleLoad(const char *filename, const char *modulename)
+/* modules registered by cexpLoadFile() or cexpLoadFileRescan();
+ * protected by the write lock which is held while these run
+ */
+static CexpModule companions = 0;
+
+static unsigned long seq_no = 0;
+
+int
+cexpModuleAddCompanion(const char *name, const char *fileName, CexpSymTbl symtbl)
 {
-CexpModule m,tail,nmod,rval=0;
-char       *slash = filename ? strrchr(filename,'/') : 0;
+CexpModule m, *pp;
 
-	if (slash)
-		slash++;
+	if ( ! (m = (CexpModule)malloc(sizeof(*m))) )
+		goto cleanup;
+	memset(m,0,sizeof(*m));
 
-	if (!modulename)
-		modulename=slash ? slash : filename;
+	if ( ! (m->name = (char*)malloc(strlen(name)+1)) )
+		goto cleanup;
+	strcpy(m->name, name);
 
-	if (!modulename)
-		modulename="SYSTEM-BUILTIN";
+	if ( fileName ) {
+		if ( ! (m->fileName = (char*)malloc(strlen(fileName)+1)) )
+			goto cleanup;
+		strcpy(m->fileName, fileName);
+	}
 
-	if (!(nmod=(CexpModule)malloc(sizeof(*nmod))))
-		return 0;
+	m->symtbl = symtbl;
+	m->refs   = 1;
 
-	memset(nmod,0,sizeof(*nmod));
+	for ( pp = &companions; *pp; pp = &(*pp)->next )
+		/* nothing else to do */;
+	*pp = m;
+
+	return 0;
+
+cleanup:
+	if ( m ) {
+		free(m->name);
+		free(m);
+	}
+	cexpFreeSymTbl(&symtbl);
+	return -1;
+}
+
+/* Enter the pending companions after 'tail' (which is
+ * the last one of a run of modules which belong together)
+ * and into the registry of index 'x' (to be published by
+ * the caller).
+ * NOTE: the caller must hold the write lock
+ *
+ * RETURNS: number of companions entered
+ */
+static int
+enterCompanions(CexpModule tail, CexpModIdx x)
+{
+CexpModule	nmod;
+int			rval = 0;
+
+	while ( (nmod=companions) ) {
+		companions = nmod->next;
+		nmod->next = 0;
+		nmod->id   = ++lastId;
+		if ( modFind(x, nmod->name) || modAdd(x, nmod) ) {
+			fprintf(stderr,"Unable to add module '%s' (duplicate name or no memory)\n",nmod->name);
+			cexpModuleFree(&nmod);
+			continue;
+		}
+		if ( nmod->symtbl->lazy )
+			lazyModules++;
+		nmod->seq  = seq_no++;
+		nmod->next = tail->next;
+		nmod->prev = tail;
+		PUBLISH(tail->next, nmod);
+		if ( nmod->next )
+			nmod->next->prev = nmod;
+		else
+			lastModule = nmod;
+		tail       = nmod;
+		rval++;
+	}
+	return rval;
+}
+
+int
+cexpModuleDropCompanion(CexpModule mod)
+{
+CexpModule	pred;
+CexpModIdx	nidx, old;
+unsigned	i;
+
+	if ( mod == cexpSystemModule || modIsStale(mod, 0) )
+		return -1;
+
+	if ( ! (nidx = idxCopy()) || modDel(nidx, mod) ) {
+		idxFree(nidx);
+		return -1;
+	}
+
+	pred = mod->prev;
+
+	for (i=0; i<mod->nNeeds; i++)
+		mod->needs[i]->nNeededBy--;
+	mod->nNeeds = 0;
+
+	/* companions are not entered into the symbol index or the
+	 * address map (enterCompanions()); only the list and the
+	 * registry need to be updated.
+	 */
+	PUBLISH(pred->next, mod->next);
+	if ( mod->next )
+		mod->next->prev = pred;
+	else
+		lastModule = pred;
+	dropGen++;
+
+	old = idxPublish(nidx);
+
+	if ( mod->symtbl->lazy )
+		lazyModules--;
+
+	cexpSymGenerationBump();
+
+	/* readers may still be on 'mod' */
+	__SYNC();
+	mod->next = 0;
+	idxFree(old);
+
+	modUnref(mod);
+	return 0;
+}
+
+int
+cexpModuleRescan(void)
+{
+CexpModule	m,tail;
+CexpModIdx	nidx = 0, old = 0;
+int			rval;
 
 	__WLOCK();
 
-	for (m=cexpSystemModule, tail=0; m; m=m->next) {
-		tail=m;
-		if (!strcmp(m->name,modulename)) {
-			fprintf(stderr,
-				"ERROR: a module '%s' exists already\n",
-				modulename);
+	if ( ! cexpSystemModule ) {
+		rval = 0;
+		goto cleanup;
+	}
+
+	if ( (rval = cexpLoadFileRescan(cexpSystemModule)) > 0 && companions ) {
+		if ( ! (nidx = idxCopy()) ) {
+			fprintf(stderr,"Unable to copy module registry (no memory)\n");
+			rval = -1;
 			goto cleanup;
 		}
+		/* new companions of the system module go after the last one */
+		for ( tail=cexpSystemModule; tail->next && tail->next->symtbl->lazy; tail=tail->next )
+			/* nothing else to do */;
+		if ( enterCompanions(tail, nidx) > 0 )
+			cexpSymGenerationBump();
+		old = idxPublish(nidx);
+	}
+
+cleanup:
+	/* companions which could not be entered */
+	while ( (m=companions) ) {
+		companions = m->next;
+		m->next    = 0;
+		cexpModuleFree(&m);
+	}
+
+	__WUNLOCK();
+
+	if ( old ) {
+		__SYNC();
+		idxFree(old);
 	}
 
-	if (idAlloc(nmod)) {
+	return rval;
+}
+
+/* A module is loaded in two phases:
+ *  1) the object file is read, its symbols resolved and the
+ *     sections relocated (cexpLoadFile()) with only the load
+ *     lock held (loads are serialized). Readers and unloads
+ *     proceed meanwhile; the modules we may link against are
+ *     pinned by a snapshot.
+ *  2) the write lock is taken, the module is entered and its
+ *     constructors are run. If any module was removed from the
+ *     list since phase 1 started (something we linked against
+ *     may be gone) the load has to be repeated.
+ * With 'locked' set both phases are done holding the write lock.
+ *
+ * RETURNS: the new module or 0 on error; *pretry is set if the
+ *          load should be repeated.
+ */
+static CexpModule
+moduleLoad(const char *filename, const char *modulename, CexpObjScan scan, int locked, int *pretry)
+{
+CexpModule		m,tail,nmod,rval=0;
+CexpModIdx		nidx=0, old=0;
+CexpModSnap		pin=0;
+unsigned long	gen=0;
+int				wlocked;
+
+	*pretry = 0;
+
+	if (!(nmod=(CexpModule)malloc(sizeof(*nmod))))
+		return 0;
+
+	memset(nmod,0,sizeof(*nmod));
+	nmod->refs = 1;
+
+	__WLOCK();
+	wlocked = 1;
+
+	if (modFind(modIdx, modulename)) {
 		fprintf(stderr,
-			"Unable to allocate a module ID (more than %i loaded?)\n",
-			MAX_NUM_MODULES);
+			"ERROR: a module '%s' exists already\n",
+			modulename);
 		goto cleanup;
 	}
 
+	if ( ! locked ) {
+		/* consistent with the list and the index */
+		gen = dropGen;
+		pin = cexpModuleSnapshot();
+		__WUNLOCK();
+		wlocked = 0;
+		if ( ! pin ) {
+			fprintf(stderr,"Unable to pin the module list (no memory)\n");
+			goto cleanup;
+		}
+	}
+
 	if (!(nmod->name=(char*)malloc(strlen(modulename)+1))) {
 			goto cleanup;
 	}
 	strcpy(nmod->name,modulename);
 
 	if ( filename ) {
+		nmod->prefetch = scan;
 		if (cexpLoadFile(filename,nmod)) {
+			nmod->prefetch = 0;
 			goto cleanup;
 		}
+		nmod->prefetch = 0;
 	} else {
 		if (cexpLoadBuiltinSymtab(nmod)) {
 			goto cleanup;
 		}
 	}
 
+	if ( ! wlocked ) {
+		__WLOCK();
+		wlocked = 1;
+		if ( gen != dropGen ) {
+			*pretry = 1;
+			goto cleanup;
+		}
+	}
+
+	/* could have been entered by cexpModuleRescan() meanwhile */
+	if (modFind(modIdx, modulename)) {
+		fprintf(stderr,
+			"ERROR: a module '%s' exists already\n",
+			modulename);
+		goto cleanup;
+	}
+
+	tail = lastModule;
+
 	/* add help tables */
 	{
 	CexpSym found;
@@ -881,6 +2857,38 @@ char       *slash = filename ? strrchr(filename,'/') : 0;
 		cexp_regfree(rc);
 	}
 
+	/* the (big, never unloaded) system table keeps its names front-coded */
+	if ( ! tail && cexpSymTblFcRestart )
+		cexpSymTblFrontCode(nmod->symtbl, cexpSymTblFcRestart);
+
+	/* the system module is always first; it is not entered into the global index */
+	nmod->seq = seq_no++;
+	if ( ! (nidx = idxCopy()) ) {
+		fprintf(stderr,"Unable to copy global symbol index (no memory)\n");
+		goto cleanup;
+	}
+
+	if ( tail && gsymAddModule(nidx, nmod) ) {
+		fprintf(stderr,"Unable to add '%s' to global symbol index (no memory)\n", modulename);
+		gsymUnlink(nidx, nmod);
+		goto cleanup;
+	}
+
+#ifdef USE_LOADER
+	if ( tail && amapAddModule(nidx, nmod) ) {
+		fprintf(stderr,"Unable to add '%s' to global address map (no memory)\n", modulename);
+		gsymUnlink(nidx, nmod);
+		goto cleanup;
+	}
+#endif
+
+	nmod->id = ++lastId;
+	if ( modAdd(nidx, nmod) ) {
+		fprintf(stderr,"Unable to register module '%s' (no memory)\n", modulename);
+		gsymUnlink(nidx, nmod);
+		goto cleanup;
+	}
+
 #ifdef HAVE_SYS_MMAN_H
 	if ( nmod->segs ) {
 	CexpSegment s;
@@ -923,17 +2931,50 @@ char       *slash = filename ? strrchr(filename,'/') : 0;
 	addDependencies(nmod);
 
 	/* chain to the list of modules */
+	nmod->prev = tail;
 	if (tail)
-		tail->next=nmod;
+		PUBLISH(tail->next, nmod);
 	else
-		cexpSystemModule=nmod;
+		PUBLISH(cexpSystemModule, nmod);
+	lastModule = nmod;
 	rval=nmod;
 	nmod=0;
 
+	/* enter the companions right after the module */
+	enterCompanions(rval, nidx);
+
+	old  = idxPublish(nidx);
+	nidx = 0;
+
+	cexpSymGenerationBump();
+
 cleanup:
-	__WUNLOCK();
+	if ( wlocked ) {
+		/* companions of a module which failed to load */
+		while ( (m=companions) ) {
+			companions = m->next;
+			m->next    = 0;
+			cexpModuleFree(&m);
+		}
+
+		__WUNLOCK();
+	}
+
+	cexpModuleSnapshotRelease(pin);
+
+	/* unused (load failed) or superseded index */
+	idxFree(nidx);
+	if ( old ) {
+		__SYNC();
+		idxFree(old);
+	}
 
 	if (nmod) {
+		/* undo what the object file handling did (e.g., frame
+		 * info registration); the constructors have not run.
+		 */
+		if (nmod->cleanup)
+			nmod->cleanup(nmod);
 		cexpModuleFree(&nmod);
 		return 0;
 	}
@@ -941,6 +2982,311 @@ cleanup:
 	return rval;
 }
 
+/* load a module, repeating the attempt if necessary;
+ * the caller must hold the load lock.
+ */
+static CexpModule
+loadRetry(const char *filename, const char *modulename, CexpObjScan scan)
+{
+CexpModule rval;
+char       *slash = filename ? strrchr(filename,'/') : 0;
+int        attempt, retry;
+
+	if (slash)
+		slash++;
+
+	if (!modulename)
+		modulename=slash ? slash : filename;
+
+	if (!modulename)
+		modulename="SYSTEM-BUILTIN";
+
+	/* the system module (which may register companions) and the
+	 * last attempt are loaded with the write lock held throughout
+	 */
+	for ( attempt = 0; ; attempt++ ) {
+		rval = moduleLoad(filename, modulename, scan, ! cexpSystemModule || attempt >= LOAD_RETRIES, &retry);
+		if ( ! retry )
+			break;
+	}
+
+	return rval;
+}
+
+CexpModule
+cexpModuleLoad(const char *filename, const char *modulename)
+{
+CexpModule rval;
+
+	__LLOCK();
+	rval = loadRetry(filename, modulename, 0);
+	__LUNLOCK();
+
+	return rval;
+}
+
+/* Batch loads (cexpModuleLoadList()); the files are read and
+ * scanned for the symbols they define and need by several
+ * threads. The contents are kept for linking (up to a total of
+ * LOAD_PREFETCH bytes; larger batches read the rest again).
+ */
+#define LOAD_WORKERS	4
+#define LOAD_PREFETCH	(16*1024*1024)
+
+typedef struct BatchRec_ {
+	int						n;
+	const char				**files;
+	CexpObjScanRec			*scans;
+	char					*scanned;	/* nonzero if the scan succeeded */
+	volatile long			next;		/* next file to scan */
+	volatile unsigned long	held;		/* bytes of file contents kept */
+} BatchRec, *Batch;
+
+static void
+batchScan(Batch b)
+{
+CexpObjScan	sc;
+int			i;
+	while ( (i = CEXP_ATOMIC_ADD(&b->next, 1) - 1) < b->n ) {
+		sc            = &b->scans[i];
+		b->scanned[i] = ! cexpLoadFileScan(b->files[i], sc);
+		if ( sc->image && CEXP_ATOMIC_ADD(&b->held, sc->size) > LOAD_PREFETCH ) {
+			free(sc->image);
+			sc->image = 0;
+		}
+	}
+}
+
+#ifdef HAVE_PTHREADS
+static void *
+batchWorker(void *arg)
+{
+	batchScan(arg);
+	return 0;
+}
+#endif
+
+/* Map of the symbols defined by the files of a batch */
+typedef struct BatchDefRec_ {
+	const char	*name;
+	int			file;
+} BatchDefRec, *BatchDef;
+
+static BatchDef
+batchDefSlot(BatchDef tbl, unsigned long mask, const char *name)
+{
+unsigned long h;
+	for ( h = _cexp_namehash(name) & mask; tbl[h].name; h = (h+1) & mask ) {
+		if ( !strcmp(name, tbl[h].name) )
+			break;
+	}
+	return &tbl[h];
+}
+
+/* Compute the load order; a file comes after the files defining
+ * symbols it needs (unless a loaded module defines them already).
+ * Otherwise, the order of the list is preserved.
+ * 'dep[j*n+i]' is set if file 'j' needs file 'i'.
+ */
+static int
+batchOrder(Batch b, char *dep, int *order)
+{
+BatchDefRec		*tbl = 0;
+BatchDef		d;
+CexpObjScan		sc;
+unsigned long	mask, ndefd, l;
+char			*placed = 0;
+int				n = b->n, i, j, k, rval = -1;
+
+	for ( i = 0, ndefd = 0; i < n; i++ )
+		ndefd += b->scans[i].ndefd;
+
+	for ( mask = 64; mask < 2*ndefd; mask <<= 1 )
+		/* nothing else to do */;
+
+	if ( ! (tbl = calloc(mask--, sizeof(*tbl))) || ! (placed = calloc(n, 1)) )
+		goto cleanup;
+
+	/* the first file in the list defining a symbol provides it */
+	for ( i = 0; i < n; i++ ) {
+		for ( l = 0, sc = &b->scans[i]; l < sc->ndefd; l++ ) {
+			if ( ! (d = batchDefSlot(tbl, mask, sc->defd[l]))->name ) {
+				d->name = sc->defd[l];
+				d->file = i;
+			}
+		}
+	}
+
+	memset(dep, 0, n*n);
+	for ( j = 0; j < n; j++ ) {
+		for ( l = 0, sc = &b->scans[j]; l < sc->nundf; l++ ) {
+			d = batchDefSlot(tbl, mask, sc->undf[l]);
+			if ( d->name && d->file != j && ! cexpSymLookup(d->name, 0) )
+				dep[j*n + d->file] = 1;
+		}
+	}
+
+	for ( k = 0; k < n; k++ ) {
+		/* first file (in list order) whose dependencies are placed */
+		for ( j = 0; j < n; j++ ) {
+			if ( placed[j] )
+				continue;
+			for ( i = 0; i < n && ( ! dep[j*n + i] || placed[i] ); i++ )
+				/* nothing else to do */;
+			if ( i == n )
+				break;
+		}
+		if ( j == n ) {
+			for ( j = 0; placed[j]; j++ )
+				/* nothing else to do */;
+			fprintf(stderr,"WARNING: circular dependency involving '%s'\n", b->files[j]);
+		}
+		placed[j] = 1;
+		order[k]  = j;
+	}
+
+	rval = 0;
+
+cleanup:
+	free(tbl);
+	free(placed);
+	return rval;
+}
+
+int
+cexpModuleLoadList(int n, const char **files, const char **names)
+{
+BatchRec		b;
+char			*dep = 0, *loaded = 0;
+int				*order = 0, i, j, k, nthr = 0, rval = 0;
+#ifdef HAVE_PTHREADS
+pthread_t		thr[LOAD_WORKERS-1];
+#endif
+
+	if ( n <= 0 )
+		return 0;
+
+	memset(&b, 0, sizeof(b));
+	b.n     = n;
+	b.files = files;
+
+	if (    ! (b.scans   = calloc(n, sizeof(*b.scans)))
+	     || ! (b.scanned = calloc(n, 1))
+	     || ! (loaded    = calloc(n, 1))
+	     || ! (order     = malloc(n * sizeof(*order)))
+	     || ! (dep       = malloc(n * n)) ) {
+		fprintf(stderr,"cexpModuleLoadList: no memory\n");
+		goto cleanup;
+	}
+
+	/* read the files in parallel (this thread helps) */
+#ifdef HAVE_PTHREADS
+	while ( nthr < LOAD_WORKERS-1 && nthr < n-1 && ! pthread_create(&thr[nthr], 0, batchWorker, &b) )
+		nthr++;
+#endif
+	batchScan(&b);
+#ifdef HAVE_PTHREADS
+	for ( i = 0; i < nthr; i++ )
+		pthread_join(thr[i], 0);
+#endif
+
+	/* files which could not be scanned are loaded in list order */
+	if ( batchOrder(&b, dep, order) ) {
+		fprintf(stderr,"cexpModuleLoadList: no memory\n");
+		goto cleanup;
+	}
+
+	/* each module is entered (and published) as soon as it is
+	 * linked; later files are linked against it (see cexp.h)
+	 */
+	__LLOCK();
+
+	for ( k = 0; k < n; k++ ) {
+		j = order[k];
+		for ( i = 0; i < n && ! ( dep[j*n + i] && ! loaded[i] ); i++ )
+			/* nothing else to do */;
+		if ( i < n ) {
+			fprintf(stderr,"Not loading '%s'; it needs '%s' which is not loaded\n", files[j], files[i]);
+			continue;
+		}
+		if ( loadRetry(files[j], names ? names[j] : 0, &b.scans[j]) ) {
+			loaded[j] = 1;
+			rval++;
+		}
+		free(b.scans[j].image);
+		b.scans[j].image = 0;
+	}
+
+	__LUNLOCK();
+
+cleanup:
+	if ( b.scans ) {
+		for ( i = 0; i < n; i++ ) {
+			free(b.scans[i].mem);
+			free(b.scans[i].image);
+			free(b.scans[i].path);
+		}
+	}
+	free(b.scans);
+	free(b.scanned);
+	free(loaded);
+	free(order);
+	free(dep);
+	return rval;
+}
+
+/* max. length of a line in a manifest */
+#define MANIFEST_LINE	1024
+
+int
+cexpModuleLoadManifest(const char *manifest)
+{
+FILE		*f;
+char		buf[MANIFEST_LINE], *fnam, *mnam, *p;
+const char	**files = 0, **names = 0, **nf, **nn;
+int			n = 0, i, rval = -1;
+
+	if ( ! (f = fopen(manifest, "r")) ) {
+		perror("opening manifest");
+		return -1;
+	}
+
+	while ( fgets(buf, sizeof(buf), f) ) {
+		if ( (p = strchr(buf, '#')) )
+			*p = 0;
+		if ( ! (fnam = strtok_r(buf, " \t\r\n", &p)) )
+			continue;
+		mnam = strtok_r(0, " \t\r\n", &p);
+		if ( ! (nf = realloc(files, (n+1) * sizeof(*files))) )
+			goto nomem;
+		files = nf;
+		if ( ! (nn = realloc(names, (n+1) * sizeof(*names))) )
+			goto nomem;
+		names = nn;
+		files[n] = strdup(fnam);
+		names[n] = mnam ? strdup(mnam) : 0;
+		n++;
+		if ( ! files[n-1] || ( mnam && ! names[n-1] ) )
+			goto nomem;
+	}
+
+	rval = cexpModuleLoadList(n, files, names);
+	goto cleanup;
+
+nomem:
+	fprintf(stderr,"cexpModuleLoadManifest: no memory\n");
+
+cleanup:
+	for ( i = 0; i < n; i++ ) {
+		free((char*)files[i]);
+		free((char*)names[i]);
+	}
+	free(files);
+	free(names);
+	fclose(f);
+	return rval;
+}
+
 void
 cexpModuleFree(CexpModule *mp)
 {
@@ -959,12 +3305,14 @@ CexpModule mod=*mp;
 		free(mod->dtor_list);
 		free(mod->section_syms);
 		free(mod->fileName);
+		free(mod->gsyms);
+		free(mod->needs);
 		cexpFreeSymTbl(&mod->symtbl);
-		free(mod);
 #ifdef USE_PMBFD
 		if (mod->fileAttributes)
 			pmelf_destroy_attribute_set(mod->fileAttributes);
 #endif
+		free(mod);
 	}
-	*mp=mod;
+	*mp=0;
 }
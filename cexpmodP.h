@@ -57,16 +57,7 @@
 #include "cexpsegsP.h"
 
 /* implementation of a module */
-#define MAX_NUM_MODULES 256
-#define LD_WORDLEN		5
-#define BITMAP_DEPTH	((MAX_NUM_MODULES)>>(LD_WORDLEN))
-#define BITMAP_SET(bm,bitno) (((bm)[(bitno)>>LD_WORDLEN]) |= (1<<((bitno)&((1<<LD_WORDLEN)-1))))
-#define BITMAP_CLR(bm,bitno) (((bm)[(bitno)>>LD_WORDLEN]) &= ~(1<<((bitno)&((1<<LD_WORDLEN)-1))))
-#define BITMAP_TST(bm,bitno) (((bm)[(bitno)>>LD_WORDLEN]) &  (1<<((bitno)&((1<<LD_WORDLEN)-1))))
-#define BITMAP_DECLARE(bm)	BitmapWord bm[BITMAP_DEPTH]
-
-typedef	unsigned long	BitmapWord;
-typedef short			ModuleId;	/* Id < 0 means INVALID */
+typedef unsigned long	ModuleId;	/* Id 0 means INVALID; ids are never reused */
 
 typedef void			(*VoidFnPtr)(void);
 
@@ -79,7 +70,7 @@ typedef void			(*VoidFnPtr)(void);
 #define CEXPMOD_FINALIZER_SYM   "_cexpModuleFinalize"
 
 /* Version to protect the layout of CexpModuleRec, CexpSymRec, CexpTARec */
-#define CEXPMOD_MAGIC	"cexp0000"
+#define CEXPMOD_MAGIC	"cexp0001"
 
 typedef struct CexpModuleRec_ {
 	char				*name;
@@ -96,8 +87,11 @@ typedef struct CexpModuleRec_ {
 	ModuleId 			id;			/* unique ID                                   */
 	CexpSegment         segs;       /* array of actual memory segments             */
 	unsigned long       memSize;    /* total memory occupied by binary             */
-	BITMAP_DECLARE(neededby);		/* bitmap module ids that depend on this one   */
-	BITMAP_DECLARE(needs);			/* bitmap of module ids this module depends on */
+	CexpModule			*needs;		/* modules this one depends on (no duplicates) */
+	unsigned			nNeeds;
+	unsigned			needsSize;	/* number of slots allocated to 'needs'        */
+	unsigned long		nNeededBy;	/* number of modules depending on this one     */
+	CexpModule			prev;		/* predecessor in the list (for the writer)    */
 	VoidFnPtr			*ctor_list;
 	unsigned			nCtors;
 	VoidFnPtr			*dtor_list;
@@ -125,6 +119,17 @@ typedef struct CexpModuleRec_ {
 	                                /* compatibility attributes as described by '.gnu.attributes'
 									 * section. Currently, only pmbfd supports this.
 									 */
+	unsigned long		seq;		/* load sequence number; symbols of modules with
+									 * lower numbers shadow those of later modules
+									 */
+	struct CexpGSymRec_	*gsyms;		/* this module's nodes in the global symbol index */
+	volatile long		refs;		/* one for being on the list plus one per snapshot
+									 * holding the module; freed when the last is gone
+									 */
+	struct CexpObjScanRec_	*prefetch;
+									/* while cexpLoadFile() runs: the file as read by
+									 * cexpLoadFileScan() (batch loads) or NULL
+									 */
 } CexpModuleRec;
 
 /* This routine must be provided by the underlying
@@ -132,36 +137,126 @@ typedef struct CexpModuleRec_ {
  * allocating all of the necessary members of the
  * new modules (except for the name).
  *
- * In particular, this routine must raise the
- * bits for all module dependencies in the 'needs'
- * bitmap:
+ * In particular, this routine must record all module
+ * dependencies:
  *    if (need(some_module))
- *      BITMAP_SET(this_module->needs,some_module->id);
+ *      cexpModuleAddNeed(this_module,some_module);
+ *
+ * Loads are serialized but (except for the system module)
+ * this runs without the write lock; symbols may be looked
+ * up but the module list must not be modified.
  */
 int
 cexpLoadFile(const char *filename, CexpModule new_module);
 
+/* Record that 'mod' depends on 'dep' (which then can't be
+ * unloaded while 'mod' is loaded); duplicates are ignored.
+ *
+ * RETURNS: 0 on success, nonzero if no memory.
+ */
+int
+cexpModuleAddNeed(CexpModule mod, CexpModule dep);
+
+/* Names of the global symbols an object file defines and
+ * of the ones it needs; used to order the files of a batch
+ * (cexpModuleLoadList()). All of it is stored in 'mem'.
+ * The scan may keep the contents of the file ('image', 'size')
+ * and its full 'path' (both malloc()ed); cexpLoadFile() then
+ * uses them instead of reading the file again (see 'prefetch').
+ */
+typedef struct CexpObjScanRec_ {
+	char			**defd;
+	unsigned long	ndefd;
+	char			**undf;
+	unsigned long	nundf;
+	void			*mem;
+	void			*image;
+	unsigned long	size;
+	char			*path;
+} CexpObjScanRec, *CexpObjScan;
+
+/* This routine must be provided by the underlying object file
+ * handling, too. It fills in 'scan' (which is zeroed on error)
+ * and must be reentrant; the files of a batch are read and
+ * scanned in parallel.
+ *
+ * RETURNS: 0 on success, nonzero on error (or if not supported)
+ */
+int
+cexpLoadFileScan(const char *filename, CexpObjScan scan);
+
+/* May be called by cexpLoadFile() to have an additional module
+ * (e.g., a shared library the program is linked against) entered
+ * right after the one being loaded; it is discarded if loading
+ * fails. The module owns 'symtbl' (which is released on error).
+ * Only allowed if the write lock is held, i.e., for the system
+ * module (or any module if built w/o the loader).
+ *
+ * RETURNS: 0 on success, nonzero on error (no memory).
+ */
+int
+cexpModuleAddCompanion(const char *name, const char *fileName, CexpSymTbl symtbl);
+
+/* These routines must be provided by the underlying object
+ * file handling, too.
+ *
+ * cexpLoadFileChanged() tells (no lock held) if
+ * cexpLoadFileRescan() has anything to do; it may have to look
+ * at the link map, so it is only called when a lookup misses.
+ *
+ * cexpLoadFileRescan() is called with the write lock held to
+ * reconcile the companions registered for 'mod' with the state
+ * of the process (libraries dlopen()ed or dlclose()d since). New
+ * ones are added with cexpModuleAddCompanion(), obsolete ones
+ * removed with cexpModuleDropCompanion().
+ *
+ * RETURNS: (cexpLoadFileRescan) number of companions added or
+ *          dropped, -1 on error.
+ */
+int
+cexpLoadFileChanged(void);
+
+int
+cexpLoadFileRescan(CexpModule mod);
+
+/* Remove a companion module (from cexpLoadFileRescan());
+ * the caller must hold the write lock. This waits for
+ * readers of the module list to move on (the caller must
+ * not be one).
+ *
+ * RETURNS: 0 on success, nonzero if 'mod' is not in the list
+ *          (or no memory).
+ */
+int
+cexpModuleDropCompanion(CexpModule mod);
+
 /* Release all data structures associated with *pmod
  *
  * NOTE: this must only be called once the module
- *       has been dequeued from the list
+ *       has been dequeued from the list (and isn't
+ *       held by a snapshot).
  */
 void
 cexpModuleFree(CexpModule *pmod);
 
 /* search for an address in all modules giving its aindex 
- * to the *pmod's aindex table
+ * to the aindex table *ptbl (the symbol table of module *pmod
+ * or its index of local symbols).
  *
  * RETURNS: aindex or -1 if the address is not within the
  *          boundaries of any module.
  */
 int
-cexpSymLkAddrIdx(void *addr, int margin, FILE *f, CexpModule *pmod);
+cexpSymLkAddrIdx(void *addr, int margin, FILE *f, CexpModule *pmod, CexpSymTbl *ptbl);
 
-/* Symbol and associated module */
+/* Symbol and associated module; 'idx' is a position in the
+ * aindex of 'tbl' which is the module's table or the index
+ * of its local symbols.
+ */
 typedef struct CexpSymAIdxRec_ {
 	int          idx;
 	CexpModule   mod;
+	CexpSymTbl   tbl;
 } CexpSymAIdxRec, *CexpSymAIdx;
 
 /* Search for an address in all modules; returns the 2*margin+1
@@ -0,0 +1,133 @@
+/* $Id$ */
+
+/* layout of pre-sorted symbol table images generated by 'xsyms -I' */
+
+/* SLAC Software Notices, Set 4 OTT.002a, 2004 FEB 03
+ *
+ * Authorship
+ * ----------
+ * This software (CEXP - C-expression interpreter and runtime
+ * object loader/linker) was created by
+ *
+ *    Till Straumann <strauman@slac.stanford.edu>, 2002-2008,
+ * 	  Stanford Linear Accelerator Center, Stanford University.
+ *
+ * Acknowledgement of sponsorship
+ * ------------------------------
+ * This software was produced by
+ *     the Stanford Linear Accelerator Center, Stanford University,
+ * 	   under Contract DE-AC03-76SFO0515 with the Department of Energy.
+ * 
+ * Government disclaimer of liability
+ * ----------------------------------
+ * Neither the United States nor the United States Department of Energy,
+ * nor any of their employees, makes any warranty, express or implied, or
+ * assumes any legal liability or responsibility for the accuracy,
+ * completeness, or usefulness of any data, apparatus, product, or process
+ * disclosed, or represents that its use would not infringe privately owned
+ * rights.
+ * 
+ * Stanford disclaimer of liability
+ * --------------------------------
+ * Stanford University makes no representations or warranties, express or
+ * implied, nor assumes any liability for the use of this software.
+ * 
+ * Stanford disclaimer of copyright
+ * --------------------------------
+ * Stanford University, owner of the copyright, hereby disclaims its
+ * copyright and all other rights in this software.  Hence, anyone may
+ * freely use it for any purpose without restriction.  
+ * 
+ * Maintenance of notices
+ * ----------------------
+ * In the interest of clarity regarding the origin and status of this
+ * SLAC software, this and all the preceding Stanford University notices
+ * are to remain affixed to any copy or derivative of this software made
+ * or distributed by the recipient and are to be affixed to any copy of
+ * software made or distributed by the recipient that contains a copy or
+ * derivative of this software.
+ * 
+ * SLAC Software Notices, Set 4 OTT.002a, 2004 FEB 03
+ */ 
+
+#ifndef CEXP_SYMIMG_H
+#define CEXP_SYMIMG_H
+
+/* A symbol table image is a file holding a ready-to-use
+ * symbol table in the *target's* native layout so that it
+ * can be mapped and installed without any parsing, copying
+ * or sorting:
+ *
+ *   header | CexpSymRec[nentries+1] | aindex[nentries] | hindex[hmask+1]
+ *          | eytz | tsig[nentries] | strings
+ *
+ * - The symbol records are sorted by name (_cexp_namecomp()
+ *   order) and duplicates are eliminated, i.e., exactly what
+ *   cexpSortSymTbl() produces. The last record is all zero.
+ * - The 'name' fields hold offsets relative to the start of
+ *   the image; a name is converted to a pointer when the symbol
+ *   is handed out (only the pages of these records are copied).
+ * - The 'value.type' fields are assigned by xsyms; 'tsizes'
+ *   records the sizes of the basic types it assumed.
+ * - 'aindex' and 'hindex' are 32-bit indices exactly as in
+ *   CexpSymTblRec; names are hashed with _cexp_namehash().
+ * - 'eytz' holds the addresses in eytzinger order (pointer-sized,
+ *   1-based, nentries+1 slots) followed by their aindex positions
+ *   (32-bit), i.e., what cexpEytzSymTbl() builds.
+ * - 'tsig' holds the 64-bit trigram signatures of the names
+ *   (cexpSigSymTbl()).
+ * - 'off_path' (if nonzero) is the offset of the (absolute) name
+ *   of the ELF file the image was made from; the local symbols
+ *   are read from it when needed.
+ * - All offsets are multiples of 8.
+ * - 'id' holds the build-id (NT_GNU_BUILD_ID note) of the
+ *   executable the image was made from ('idlen' is 0 if it has
+ *   none); an image is rejected if the running executable has
+ *   a different one.
+ *
+ * Installing an image only checks the header; the indices are
+ * validated when they are used first.
+ *
+ * All header fields are 32-bit words in target byte order.
+ *
+ * NOTE: the version must be changed whenever this layout or
+ *       the layout of CexpSymRec (i.e., CEXPMOD_MAGIC) changes.
+ */
+
+#include <stdint.h>
+
+#define CEXP_SYMIMG_MAGIC	"CEXPSYMI"
+#define CEXP_SYMIMG_VERSION	3
+#define CEXP_SYMIMG_ENDIAN	0x01020304
+
+#define CEXP_SYMIMG_IDMAX	20	/* SHA-1 build-id */
+
+/* sizes of short, int, long, float and double */
+#define CEXP_SYMIMG_TSIZES(s,i,l,f,d) \
+	((s) | ((i) << 4) | ((l) << 8) | ((f) << 12) | ((d) << 16))
+
+/* used by xsyms only; not present in the image */
+#define CEXP_SYMIMG_FLG_FUNC	(1U<<30)
+#define CEXP_SYMIMG_FLG_OBJ		(1U<<31)
+
+typedef struct CexpSymImgHdrRec_ {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	endian;		/* CEXP_SYMIMG_ENDIAN in target byte order */
+	uint32_t	recsize;	/* sizeof(CexpSymRec) on the target        */
+	uint32_t	tsizes;		/* CEXP_SYMIMG_TSIZES() on the target      */
+	uint32_t	nentries;
+	uint32_t	hmask;		/* number of hash slots - 1                */
+	uint32_t	off_syms;
+	uint32_t	off_aindex;
+	uint32_t	off_hindex;
+	uint32_t	off_eytz;
+	uint32_t	off_tsig;
+	uint32_t	off_strings;
+	uint32_t	off_path;	/* 0 if unknown                            */
+	uint32_t	size;		/* total size of the image                 */
+	uint32_t	idlen;		/* length of the build-id                  */
+	uint8_t		id[CEXP_SYMIMG_IDMAX];
+} CexpSymImgHdrRec, *CexpSymImgHdr;
+
+#endif
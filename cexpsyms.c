@@ -60,11 +60,24 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sys/stat.h>
 
 #include <cexp_regex.h>
 
 #include "cexpsymsP.h"
+#include "cexpsymimg.h"
 #include "cexpmod.h"
+#include "cexplock.h"
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif
 #include "vars.h"
 /* NOTE: DONT EDIT 'cexp.tab.h'; it is automatically generated by 'bison' */
 #include "cexp.tab.h"
@@ -99,6 +112,27 @@ register const char	*k=sa->name, *c=sb->name;
 #endif
 }
 
+/* FNV-1a over the name up to the version separator; must be
+ * consistent with _cexp_namecomp() which regards "foo" and
+ * "foo@VERS" as equal.
+ */
+unsigned long
+_cexp_namehash(const char *name)
+{
+register const unsigned char *p = (const unsigned char*)name;
+register unsigned long        h = 2166136261UL;
+
+	while ( *p ) {
+#if	LINKER_VERSION_SEPARATOR
+		if ( LINKER_VERSION_SEPARATOR == *p )
+			break;
+#endif
+		h ^= *p++;
+		h *= 16777619UL;
+	}
+	return h;
+}
+
 /* compare the 'values' of two symbols, i.e. the addresses
  * they represent.
  */
@@ -112,15 +146,726 @@ _cexp_addrcomp(const void *a, const void *b)
 		return 1;
 	else if ( (*sa)->value.ptv < (*sb)->value.ptv )
 		return -1;
+	/* keep symbols at the same address in table order
+	 * (this is what the radix sort produces, too)
+	 */
+	else if ( *sa > *sb )
+		return 1;
+	else if ( *sa < *sb )
+		return -1;
 	else
 		return 0;
 }
 
+/* total order on symbol records; sorts by name like _cexp_namecomp()
+ * but breaks all ties so that the result of sorting (and hence the
+ * entries surviving duplicate elimination) does not depend on the
+ * algorithm (serial qsort vs. parallel merge).
+ */
+static int
+symcomp(const void *a, const void *b)
+{
+CexpSym	sa = (CexpSym)a;
+CexpSym	sb = (CexpSym)b;
+int		rval;
+
+	if ( (rval = _cexp_namecomp(a, b)) )
+		return rval;
+	if ( (rval = strcmp(sa->name, sb->name)) )
+		return rval;
+	if ( sa->value.ptv != sb->value.ptv )
+		return sa->value.ptv > sb->value.ptv ? 1 : -1;
+	if ( sa->size != sb->size )
+		return sa->size > sb->size ? 1 : -1;
+	if ( sa->flags != sb->flags )
+		return sa->flags > sb->flags ? 1 : -1;
+	return (int)sa->value.type - (int)sb->value.type;
+}
+
+/* see cexpsyms.h */
+volatile unsigned long cexpSymGeneration = 0;
+
+void
+cexpSymGenerationBump(void)
+{
+	CEXP_ATOMIC_ADD(&cexpSymGeneration, 1);
+}
+
+/* Multi-threaded table construction. Large tables are built by
+ * splitting the work into (up to CEXP_SYMTBL_MAX_THREADS) chunks
+ * which are processed in parallel. The results are identical to
+ * what a single thread produces.
+ */
+int cexpSymTblThreads = 0;
+
+/* smaller tables are always built by a single thread */
+#define MT_MIN_SYMS	(1<<15)
+
+static int
+symtblNThreads(unsigned long n)
+{
+#ifdef HAVE_PTHREADS
+int nthr = cexpSymTblThreads;
+
+	if ( n < MT_MIN_SYMS )
+		return 1;
+
+	if ( nthr <= 0 ) {
+#ifdef _SC_NPROCESSORS_ONLN
+		nthr = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+		nthr = 1;
+#endif
+	}
+	if ( nthr > CEXP_SYMTBL_MAX_THREADS )
+		nthr = CEXP_SYMTBL_MAX_THREADS;
+	return nthr < 1 ? 1 : nthr;
+#else
+	return 1;
+#endif
+}
+
+typedef void *(*SymTblWorkProc)(void *arg);
+
+/* Run 'work' on 'nthr' argument records of 'argsz' bytes each;
+ * the first one is processed by the caller. If a thread cannot
+ * be created then its record is processed by the caller, too.
+ */
+static void
+symtblRun(SymTblWorkProc work, void *args, size_t argsz, int nthr)
+{
+int			i;
+#ifdef HAVE_PTHREADS
+pthread_t	tid[CEXP_SYMTBL_MAX_THREADS];
+int			ok[CEXP_SYMTBL_MAX_THREADS];
+
+	for ( i=1; i<nthr; i++ )
+		ok[i] = ! pthread_create(&tid[i], 0, work, (char*)args + i*argsz);
+
+	work(args);
+
+	for ( i=1; i<nthr; i++ ) {
+		if ( ok[i] )
+			pthread_join(tid[i], 0);
+		else
+			work((char*)args + i*argsz);
+	}
+#else
+	for ( i=0; i<nthr; i++ )
+		work((char*)args + i*argsz);
+#endif
+}
+
+/* one chunk of external symbols to be converted by cexpAddSymTbl() */
+typedef struct AddChunkRec_ {
+	char				*syms;
+	int					symSize;
+	int					nsyms;
+	CexpSymFilterProc	filter;
+	CexpSymAssignProc	*assign;
+	void				*closure;
+	unsigned			flags;
+	int					nDstSyms;	/* counted by addChunkCount() */
+	int					nDstChars;
+	CexpSym				dst;		/* where addChunkCopy() stores */
+	char				*chars;
+} AddChunkRec, *AddChunk;
+
+static void *
+addChunkCount(void *arg)
+{
+AddChunk	c = arg;
+char		*sp;
+const char	*symname;
+int			n;
+
+	for ( sp=c->syms, n=0; n<c->nsyms; sp+=c->symSize, n++ ) {
+		if ( (symname=c->filter(sp, c->closure)) ) {
+			if ( ! (c->flags & CEXP_SYMTBL_FLAG_NO_STRCPY) )
+				c->nDstChars+=strlen(symname)+1;
+			c->nDstSyms++;
+		}
+	}
+	return 0;
+}
+
+static void *
+addChunkCopy(void *arg)
+{
+AddChunk	c    = arg;
+char		*dst = c->chars;
+CexpSym		cesp = c->dst;
+char		*sp;
+const char	*symname;
+int			n;
+
+	for ( sp=c->syms, n=0; n<c->nsyms; sp+=c->symSize, n++ ) {
+		if ((symname=c->filter(sp, c->closure))) {
+				memset(cesp,0,sizeof(*cesp));
+				if ( (c->flags & CEXP_SYMTBL_FLAG_NO_STRCPY) ) {
+					cesp->name=symname;
+				} else {
+					/* copy the name to the string table and put a pointer
+					 * into the symbol table.
+					 */
+					cesp->name=dst;
+					while ((*(dst++)=*(symname++)))
+						/* do nothing else */;
+				}
+				cesp->flags = 0;
+
+				c->assign(sp,cesp,c->closure);
+
+				cesp++;
+		}
+	}
+	return 0;
+}
+
+/* sort a chunk ('a') or merge two sorted runs 'a' and 'b' into 'dst' */
+typedef struct SortChunkRec_ {
+	CexpSym			a, b, dst;
+	unsigned long	na, nb;
+} SortChunkRec, *SortChunk;
+
+static void *
+sortChunk(void *arg)
+{
+SortChunk c = arg;
+	qsort((void*)c->a, c->na, sizeof(*c->a), symcomp);
+	return 0;
+}
+
+static void *
+mergeChunk(void *arg)
+{
+SortChunk	c = arg;
+CexpSym		a = c->a, ae = c->a + c->na;
+CexpSym		b = c->b, be = c->b + c->nb;
+CexpSym		d = c->dst;
+
+	while ( a < ae && b < be )
+		*d++ = symcomp(b, a) < 0 ? *b++ : *a++;
+	while ( a < ae )
+		*d++ = *a++;
+	while ( b < be )
+		*d++ = *b++;
+	return 0;
+}
+
+/* sort 'n' symbols by name using up to 'nthr' threads */
+static void
+symtblSort(CexpSym syms, unsigned long n, int nthr)
+{
+SortChunkRec	c[CEXP_SYMTBL_MAX_THREADS];
+unsigned long	off[CEXP_SYMTBL_MAX_THREADS + 1];
+CexpSym			tmp, src, dst, x;
+int				i, nruns;
+
+	if ( nthr < 2 || ! (tmp = malloc(n * sizeof(*tmp))) ) {
+		qsort((void*)syms, n, sizeof(*syms), symcomp);
+		return;
+	}
+
+	for ( i=0; i<=nthr; i++ )
+		off[i] = n / nthr * i + ( i < n % nthr ? i : n % nthr );
+
+	for ( i=0; i<nthr; i++ ) {
+		c[i].a  = syms + off[i];
+		c[i].na = off[i+1] - off[i];
+	}
+	symtblRun(sortChunk, c, sizeof(c[0]), nthr);
+
+	/* merge pairs of runs until there is only one left */
+	for ( src = syms, dst = tmp, nruns = nthr; nruns > 1; nruns = (nruns + 1)/2 ) {
+		for ( i=0; i<nruns; i+=2 ) {
+			SortChunk m = &c[i/2];
+			m->a   = src + off[i];
+			m->na  = off[i+1] - off[i];
+			m->b   = src + off[i+1];
+			m->nb  = i + 1 < nruns ? off[i+2] - off[i+1] : 0;
+			m->dst = dst + off[i];
+		}
+		for ( i=0; i<nruns; i+=2 )
+			off[i/2] = off[i];
+		off[(nruns+1)/2] = n;
+		symtblRun(mergeChunk, c, sizeof(c[0]), (nruns + 1)/2);
+		x = src; src = dst; dst = x;
+	}
+
+	if ( src != syms )
+		memcpy(syms, src, n * sizeof(*syms));
+
+	free(tmp);
+}
+
+/* LSD radix sort of the address index, one byte per pass;
+ * stable, hence symbols at the same address stay in table order.
+ */
+typedef struct RadixChunkRec_ {
+	uintptr_t		*key, *keyd;
+	unsigned		*idx, *idxd;
+	unsigned long	from, to;
+	int				shift;
+	unsigned long	cnt[256];
+} RadixChunkRec, *RadixChunk;
+
+static void *
+radixCount(void *arg)
+{
+RadixChunk		c = arg;
+unsigned long	i;
+
+	memset(c->cnt, 0, sizeof(c->cnt));
+	for ( i=c->from; i<c->to; i++ )
+		c->cnt[ (c->key[i] >> c->shift) & 255 ]++;
+	return 0;
+}
+
+static void *
+radixScatter(void *arg)
+{
+RadixChunk		c = arg;
+unsigned long	i, pos;
+
+	for ( i=c->from; i<c->to; i++ ) {
+		pos = c->cnt[ (c->key[i] >> c->shift) & 255 ]++;
+		c->keyd[pos] = c->key[i];
+		c->idxd[pos] = c->idx[i];
+	}
+	return 0;
+}
+
+static int
+symtblRadixIndex(CexpSymTbl t, unsigned *aidx, int nthr)
+{
+unsigned long	n = t->nentries, i, tot, tmp;
+RadixChunk		c;
+uintptr_t		*key = 0, *keyd = 0, *xk, any = 0, all = ~(uintptr_t)0;
+unsigned		*idx, *idxd = 0, *xi;
+int				shift, j, d, rval = -1;
+
+	if ( ! (c = malloc(nthr * sizeof(*c))) )
+		goto cleanup;
+	if ( ! (key = malloc(2 * n * sizeof(*key))) || ! (idxd = malloc(n * sizeof(*idxd))) )
+		goto cleanup;
+
+	keyd = key + n;
+	idx  = aidx;
+
+	for ( i=0; i<n; i++ ) {
+		key[i] = (uintptr_t)t->syms[i].value.ptv;
+		idx[i] = i;
+		any   |= key[i];
+		all   &= key[i];
+	}
+
+	for ( j=0; j<nthr; j++ ) {
+		c[j].from = n / nthr * j + ( j < n % nthr ? j : n % nthr );
+		c[j].to   = c[j].from + n / nthr + ( j < n % nthr ? 1 : 0 );
+	}
+
+	for ( shift = 0; shift < 8*sizeof(uintptr_t); shift += 8 ) {
+		/* skip bytes which are the same in all keys */
+		if ( 0 == ( ((any ^ all) >> shift) & 255 ) )
+			continue;
+
+		for ( j=0; j<nthr; j++ ) {
+			c[j].key   = key;   c[j].keyd = keyd;
+			c[j].idx   = idx;   c[j].idxd = idxd;
+			c[j].shift = shift;
+		}
+		symtblRun(radixCount, c, sizeof(*c), nthr);
+
+		/* convert counts into start positions */
+		for ( d=0, tot=0; d<256; d++ ) {
+			for ( j=0; j<nthr; j++ ) {
+				tmp         = c[j].cnt[d];
+				c[j].cnt[d] = tot;
+				tot        += tmp;
+			}
+		}
+		symtblRun(radixScatter, c, sizeof(*c), nthr);
+
+		xk = key; key = keyd; keyd = xk;
+		xi = idx; idx = idxd; idxd = xi;
+	}
+
+	if ( idx != aidx ) {
+		memcpy(aidx, idx, n * sizeof(*idx));
+		idxd = idx;
+	}
+
+	rval = 0;
+
+cleanup:
+	/* 'key' and 'keyd' share one allocation */
+	free( key < keyd || ! keyd ? key : keyd );
+	free(idxd);
+	free(c);
+	return rval;
+}
+
+/* Front-coded names (see cexpSymTblFrontCode())
+ *
+ * The names of a block of 'k' symbols are stored back to back.
+ * The first one (the 'head') is a plain string which the block's
+ * first symbol keeps pointing to. Each of the others is encoded as
+ * the length of the prefix it shares with its predecessor (7 bits
+ * per byte, least significant first, MSB set if more follow) and
+ * the NUL-terminated rest. Symbols other than heads point to
+ * 'fcPending' until their name is decoded into the 'arena'.
+ */
+#ifdef __rtems__
+unsigned cexpSymTblFcRestart = 16;
+#else
+unsigned cexpSymTblFcRestart = 0;
+#endif
+
+#define FC_ARENA_CHUNK	4096
+
+typedef struct CexpFcNamesRec_ {
+	unsigned		k;			/* restart interval                  */
+	unsigned long	maxlen;		/* length of the longest name        */
+	char			*enc;		/* encoded names                     */
+	CexpStrTbl		arena;		/* decoded names                     */
+	char			*afree;		/* free space in the current chunk   */
+	unsigned long	avail;
+	CexpLock		lock;		/* protects the arena                */
+} CexpFcNamesRec, *CexpFcNames;
+
+static const char fcPending[] = "";
+
+/* RETURNS: the encoded name following 'enc' (which points to
+ *          the string part of a head or encoded name); the
+ *          length of the shared prefix is stored in *plcp.
+ */
+static const char *
+fcNext(const char *enc, unsigned long *plcp)
+{
+const unsigned char	*p   = (const unsigned char*)enc + strlen(enc) + 1;
+unsigned long		lcp  = 0;
+int					sh   = 0;
+
+	do {
+		lcp |= (unsigned long)(*p & 0x7f) << sh;
+		sh  += 7;
+	} while ( *p++ & 0x80 );
+
+	*plcp = lcp;
+	return (const char*)p;
+}
+
+/* Compare 'key' and the name of symbol 'i' w/o decoding the latter;
+ * consistent with _cexp_namecomp() or (if 'pfx' is nonzero) pfxcomp().
+ * Only the characters which differ from the predecessor are looked at.
+ */
+static int
+fcCompare(CexpSymTbl t, unsigned long i, const char *key, int pfx)
+{
+const char		*q;
+unsigned long	j, l, m, lcp;
+char			c;
+
+	q = t->syms[i - i % t->fc->k].name;
+
+	/* 'm' is the length of the prefix the current name shares
+	 * with 'key' and 'c' the name's next character
+	 */
+	for ( m = 0; key[m] && key[m] == q[m]; m++ )
+		/* nothing else to do */;
+	c = q[m];
+
+	for ( j = i % t->fc->k; j > 0; j-- ) {
+		q = fcNext(q, &lcp);
+		if ( lcp < m ) {
+			/* differs from 'key' where it differs from the predecessor */
+			m = lcp;
+			c = q[0];
+		} else if ( lcp == m ) {
+			for ( l = 0; key[m] && key[m] == q[l]; m++, l++ )
+				/* nothing else to do */;
+			c = q[l];
+		}
+		/* else it differs from 'key' where the predecessor does */
+	}
+
+	if ( pfx )
+		return key[m] ? c - key[m] : 0;
+#if	LINKER_VERSION_SEPARATOR
+	if ( key[m] )
+		return key[m] - c;
+	return !c || LINKER_VERSION_SEPARATOR == c ? 0 : -1;
+#else
+	return (unsigned char)key[m] - (unsigned char)c;
+#endif
+}
+
+/* Decode the name of 's' into 'buf' (fc->maxlen + 1 chars). If 'buf'
+ * holds the name of the predecessor already (*pbsym, encoded at *pbenc)
+ * only the difference is applied; *pbsym and *pbenc are updated.
+ */
+static void
+fcDecode(CexpSymTbl t, CexpSym s, char *buf, CexpSym *pbsym, const char **pbenc)
+{
+unsigned long	i = s - t->syms, j, lcp;
+const char		*q;
+
+	if ( *pbsym == s )
+		return;
+
+	if ( *pbsym == s - 1 && i % t->fc->k ) {
+		j = i - 1;
+		q = *pbenc;
+	} else {
+		j = i - i % t->fc->k;
+		q = t->syms[j].name;
+		strcpy(buf, q);
+	}
+
+	while ( j++ < i ) {
+		q = fcNext(q, &lcp);
+		strcpy(buf + lcp, q);
+	}
+
+	*pbsym = s;
+	*pbenc = q;
+}
+
+/* The names of a table installed from an image are offsets (into
+ * the image) until the symbol is handed out; the image is never
+ * mapped below its size so offsets and pointers can't be confused.
+ * RETURNS: the name 'n' of a symbol of 't' as a pointer.
+ */
+static const char imgBadName[] = "<bad offset>";
+
+static const char *
+imgName(CexpSymTbl t, const char *n)
+{
+uintptr_t	off = (uintptr_t)n;
+
+	if ( ! t->image || off - (uintptr_t)t->image < t->imgsize )
+		return n;
+	if ( off >= ((CexpSymImgHdr)t->image)->off_strings && off < t->imgsize )
+		return (const char*)t->image + off;
+	/* the terminating record has no name */
+	return off ? imgBadName : 0;
+}
+
+CexpSym
+cexpSymTblResolve(CexpSymTbl t, CexpSym s)
+{
+CexpFcNames		fc;
+CexpStrTbl		a;
+CexpSym			bsym = 0;
+const char		*benc;
+unsigned long	l;
+const char		*n;
+
+	if ( s && t->image ) {
+		/* the same is stored if others do this concurrently */
+		if ( (n = imgName(t, s->name)) != s->name )
+			s->name = n;
+		return s;
+	}
+
+	if ( ! s || fcPending != s->name )
+		return s;
+
+	fc = t->fc;
+
+	cexpLock(fc->lock);
+
+	if ( fcPending != s->name )
+		goto cleanup;
+
+	if ( fc->avail < fc->maxlen + 1 ) {
+		l = fc->maxlen + 1 > FC_ARENA_CHUNK ? fc->maxlen + 1 : FC_ARENA_CHUNK;
+		if ( ! (a = malloc(sizeof(*a))) )
+			goto cleanup;
+		if ( ! (a->chars = malloc(l)) ) {
+			free(a);
+			goto cleanup;
+		}
+		a->next   = fc->arena;
+		fc->arena = a;
+		fc->afree = a->chars;
+		fc->avail = l;
+	}
+
+	fcDecode(t, s, fc->afree, &bsym, &benc);
+
+	/* the name must be complete before others can see it */
+	CEXP_ATOMIC_BARRIER();
+	s->name    = fc->afree;
+
+	l          = strlen(fc->afree) + 1;
+	fc->afree += l;
+	fc->avail -= l;
+
+cleanup:
+	cexpUnlock(fc->lock);
+	/* on error the name remains empty */
+	return s;
+}
+
+int
+cexpSymTblFrontCode(CexpSymTbl t, unsigned k)
+{
+CexpFcNames		fc = 0;
+CexpStrTbl		strs;
+const char		*name, *prev = 0;
+unsigned long	i, len, lcp, v, sz;
+char			*p;
+
+	/* nothing to gain unless we hold copies of the names */
+	if ( k < 2 || t->fc || t->image || t->lazy || ! t->strtbl || 0 == t->nentries )
+		return 0;
+
+	if ( ! (fc = calloc(1, sizeof(*fc))) )
+		goto cleanup;
+
+	fc->k = k;
+
+	/* size the encoded names */
+	for ( i = sz = 0; i < t->nentries; i++, prev = name ) {
+		name = t->syms[i].name;
+		len  = strlen(name);
+		if ( len > fc->maxlen )
+			fc->maxlen = len;
+		if ( i % k ) {
+			for ( lcp = 0; name[lcp] && name[lcp] == prev[lcp]; lcp++ )
+				/* nothing else to do */;
+			for ( v = lcp; v >= 0x80; v >>= 7 )
+				sz++;
+			sz += 1 + len - lcp + 1;
+		} else {
+			sz += len + 1;
+		}
+	}
+
+	if ( ! (fc->enc = malloc(sz)) )
+		goto cleanup;
+
+	cexpLockCreate(&fc->lock);
+
+	/* the original names remain valid until we're done */
+	for ( i = 0, p = fc->enc; i < t->nentries; i++, prev = name ) {
+		name = t->syms[i].name;
+		if ( i % k ) {
+			for ( lcp = 0; name[lcp] && name[lcp] == prev[lcp]; lcp++ )
+				/* nothing else to do */;
+			for ( v = lcp; v >= 0x80; v >>= 7 )
+				*p++ = (char)(0x80 | (v & 0x7f));
+			*p++ = (char)v;
+			strcpy(p, name + lcp);
+			p += strlen(p) + 1;
+			t->syms[i].name = fcPending;
+		} else {
+			strcpy(p, name);
+			t->syms[i].name = p;
+			p += strlen(p) + 1;
+		}
+	}
+
+	t->fc = fc;
+
+	while ( (strs = t->strtbl) ) {
+		t->strtbl = strs->next;
+		free(strs->chars);
+		free(strs);
+	}
+
+	return 0;
+
+cleanup:
+	if ( fc ) {
+		free(fc->enc);
+		free(fc);
+	}
+	return -1;
+}
+
+/* _cexp_namecomp() of 'name' and the name of symbol 'i' */
+static int
+tblNameComp(CexpSymTbl t, unsigned long i, const char *name)
+{
+CexpSymRec key;
+
+CexpSymRec sym;
+
+	if ( fcPending == t->syms[i].name )
+		return fcCompare(t, i, name, 0);
+	key.name = name;
+	if ( t->image ) {
+		sym.name = imgName(t, t->syms[i].name);
+		return _cexp_namecomp(&key, &sym);
+	}
+	return _cexp_namecomp(&key, &t->syms[i]);
+}
+
+/* bloom filter with two probes; 'bmask' is the number of bits - 1 */
+#define BLOOM_BITS_PER_SYM	8
+#define BLOOM_LONG_BITS		(8*sizeof(unsigned long))
+#define BLOOM_H1(h,m)		((h) & (m))
+#define BLOOM_H2(h,m)		((((h) * 0x9e3779b1UL) >> 8) & (m))
+#define BLOOM_SET(bm,b)		((bm)[(b)/BLOOM_LONG_BITS] |= (1UL << ((b) % BLOOM_LONG_BITS)))
+#define BLOOM_TST(bm,b)		((bm)[(b)/BLOOM_LONG_BITS] &  (1UL << ((b) % BLOOM_LONG_BITS)))
+
+int
+cexpSymTblMayContain(unsigned long h, CexpSymTbl t)
+{
+	return ! t->bloom
+	       || ( BLOOM_TST(t->bloom, BLOOM_H1(h, t->bmask)) && BLOOM_TST(t->bloom, BLOOM_H2(h, t->bmask)) );
+}
+
 CexpSym
 cexpSymTblLookup(const char *name, CexpSymTbl t)
 {
-CexpSymRec key;
+CexpSymRec     key;
+CexpSymTblLazy l;
+CexpSym        s;
+unsigned long  h, lo, hi, mid;
+unsigned       i;
+int            c;
+
+	if ( (l = t->lazy) && ! l->filled ) {
+		cexpLock(l->lock);
+		if ( ! l->filled ) {
+			s = l->lookup(name, l->arg);
+			cexpUnlock(l->lock);
+			return s;
+		}
+		cexpUnlock(l->lock);
+	}
+
 	key.name = name;
+	if ( t->hindex ) {
+		h = _cexp_namehash(name);
+		if ( ! cexpSymTblMayContain(h, t) )
+			return 0;
+		for ( h &= t->hmask; (i = t->hindex[h]); h = (h+1) & t->hmask ) {
+			/* the index of an image is not validated up front */
+			if ( i > t->nentries )
+				return 0;
+			if ( 0 == tblNameComp(t, i-1, name) )
+				return cexpSymTblResolve(t, &t->syms[i-1]);
+		}
+		return 0;
+	}
+	if ( t->fc ) {
+		/* what bsearch() does, on the encoded names */
+		for ( lo = 0, hi = t->nentries; lo < hi; ) {
+			mid = (lo + hi) >> 1;
+			if ( 0 == (c = tblNameComp(t, mid, name)) )
+				return cexpSymTblResolve(t, &t->syms[mid]);
+			if ( c < 0 )
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		return 0;
+	}
 	return (CexpSym)bsearch((void*)&key,
 				t->syms,
 				t->nentries,
@@ -136,24 +881,31 @@ CexpSymRec key;
 CexpSym
 _cexpSymTblLookupRegex(cexp_regex *rc, int *pmax, CexpSym s, FILE *f, CexpSymTbl t)
 {
-CexpSym	found=0;
-int		max=24;
+CexpSym				found=0;
+int					max=24;
+CexpSymTblScanRec	sc;
 
 	if (!pmax)
 		pmax=&max;
 
-	if (!s)		s=t->syms;
+	cexpSymTblScanInit(&sc, rc, t);
 
-	while (s->name && *pmax) {
-		if (cexp_regexec(rc,s->name)) {
-			if (f) cexpSymPrintInfo(s,f);
+	if (!s || s < sc.first)
+		s=sc.first;
+
+	while (s < sc.last && *pmax) {
+		if (cexpSymTblScanMatch(&sc,rc,t,s)) {
+			found=cexpSymTblResolve(t,s);
+			if (f) cexpSymPrintInfoAs(found,sc.dn ? sc.dn[s - t->syms] : s->name,f);
 			(*pmax)--;
-			found=s;
 		}
 		s++;
 	}
 
-	return s->name ? found : 0;
+	cexpSymTblScanFini(&sc);
+
+	/* found only counts if we stopped before the end of the table */
+	return 0 == *pmax && s->name ? found : 0;
 }
 
 CexpSym
@@ -200,61 +952,811 @@ cleanup:
 	return 0;
 }
 
-void
-cexpSortSymTbl(CexpSymTbl stbl)
+CexpSymTbl
+cexpNewLazySymTbl(CexpSymTblLazy methods)
 {
-int fr,to;
-const char *old;
+CexpSymTbl rval;
 
-	if ( 0 == stbl->nentries )
-		return;
+	if ( ! (rval = cexpNewSymTbl(0)) )
+		goto cleanup;
 
-	qsort((void*)stbl->syms,
-		stbl->nentries,
-		sizeof(*stbl->syms),
-		_cexp_namecomp);
+	/* empty but properly terminated */
+	if (   ! (rval->syms = calloc(1, sizeof(*rval->syms)))
+	    || ! (rval->lazy = malloc(sizeof(*rval->lazy))) )
+		goto cleanup;
 
-	/* Sometimes the same symbol is present in an executable's symbol table AND 
-	 * dynamic symbol table. Eliminate redundant entries simply by wasting memory...
-	 */
+	*rval->lazy        = *methods;
+	rval->lazy->filled = 0;
 
-	/* Add a marker to the end of the table (using the extra element there)
-	 * to make sure the while loop breaks.
-	 */
-	old = stbl->syms[stbl->nentries].name;
-	/* Use an invalid symbol as a marker */
-	stbl->syms[stbl->nentries].name = "+%2W";
+	cexpLockCreate(&rval->lazy->lock);
 
-	for ( fr=1, to=0; fr<stbl->nentries; fr++ ) {
-		while ( 0 == _cexp_namecomp( &stbl->syms[to], &stbl->syms[fr] ) ) {
-#ifdef DEBUG /* There seem to be redundant symbols (plt and executable); don't warn for now */
-			if ( _cexp_addrcomp( &stbl->syms[to], &stbl->syms[fr] ) ) {
-				fprintf(stderr,"WARNING: Eliminating redundant symbol '%s' but values differ (%p vs. %p [eliminated])\n",
-				               stbl->syms[to].name,
-				               stbl->syms[to].value.ptv,
+	return rval;
+
+cleanup:
+	if ( rval ) {
+		free(rval->lazy);
+		free(rval->syms);
+		free(rval);
+	}
+	methods->cleanup(methods->arg);
+	return 0;
+}
+
+int cexpSymTblLocalsEnable = 1;
+
+int
+cexpSymTblSetLocals(CexpSymTbl t, CexpSymTbl (*build)(void *arg), void (*cleanup)(void *arg), void *arg)
+{
+CexpSymTblLocals l;
+
+	if ( ! (l = calloc(1, sizeof(*l))) ) {
+		cleanup(arg);
+		return -1;
+	}
+
+	l->build   = build;
+	l->cleanup = cleanup;
+	l->arg     = arg;
+
+	cexpLockCreate(&l->lock);
+
+	t->locals  = l;
+
+	return 0;
+}
+
+CexpSymTbl
+cexpSymTblLocals(CexpSymTbl t)
+{
+CexpSymTblLocals l = t->locals;
+
+	if ( ! l )
+		return 0;
+
+	if ( l->built )
+		return l->tbl;
+
+	if ( ! cexpSymTblLocalsEnable )
+		return 0;
+
+	cexpLock(l->lock);
+
+	if ( ! l->built ) {
+		l->tbl   = l->build(l->arg);
+		l->arg   = 0;
+		/* the index must be complete before others can see it */
+		CEXP_ATOMIC_BARRIER();
+		l->built = 1;
+	}
+
+	cexpUnlock(l->lock);
+
+	return l->tbl;
+}
+
+int
+cexpSymTblFill(CexpSymTbl t)
+{
+CexpSymTblLazy	l = t->lazy;
+CexpSymTbl		n;
+CexpSymTblRec	tmp;
+int				rval = 0;
+
+	if ( ! l || l->filled )
+		return 0;
+
+	cexpLock(l->lock);
+
+	if ( ! l->filled ) {
+		if ( ! (n = l->fill(l->arg)) ) {
+			rval = -1;
+		} else {
+			/* concurrent readers look at 'nentries' (still 0) only;
+			 * set up everything else first.
+			 */
+			free(t->syms);
+			tmp          = *n;
+			tmp.nentries = 0;
+			tmp.lazy     = l;
+			tmp.next     = t->next;
+			*t           = tmp;
+			CEXP_ATOMIC_BARRIER();
+			t->nentries  = n->nentries;
+			CEXP_ATOMIC_BARRIER();
+			l->filled    = 1;
+			free(n);
+		}
+	}
+
+	cexpUnlock(l->lock);
+
+	return rval;
+}
+
+void
+cexpSortSymTbl(CexpSymTbl stbl)
+{
+int fr,to;
+const char *old;
+
+	if ( 0 == stbl->nentries )
+		return;
+
+	symtblSort(stbl->syms, stbl->nentries, symtblNThreads(stbl->nentries));
+
+	/* Sometimes the same symbol is present in an executable's symbol table AND 
+	 * dynamic symbol table. Eliminate redundant entries simply by wasting memory...
+	 */
+
+	/* Add a marker to the end of the table (using the extra element there)
+	 * to make sure the while loop breaks.
+	 */
+	old = stbl->syms[stbl->nentries].name;
+	/* Use an invalid symbol as a marker */
+	stbl->syms[stbl->nentries].name = "+%2W";
+
+	for ( fr=1, to=0; fr<stbl->nentries; fr++ ) {
+		while ( 0 == _cexp_namecomp( &stbl->syms[to], &stbl->syms[fr] ) ) {
+#ifdef DEBUG /* There seem to be redundant symbols (plt and executable); don't warn for now */
+			if ( _cexp_addrcomp( &stbl->syms[to], &stbl->syms[fr] ) ) {
+				fprintf(stderr,"WARNING: Eliminating redundant symbol '%s' but values differ (%p vs. %p [eliminated])\n",
+				               stbl->syms[to].name,
+				               stbl->syms[to].value.ptv,
 				               stbl->syms[fr].value.ptv);
 			}
 #endif
 			fr++;
 		}
+		/* don't copy the marker if the table ends with duplicates */
+		if ( fr >= stbl->nentries )
+			break;
 		stbl->syms[++to] = stbl->syms[fr];
 	}
 
 	stbl->syms[stbl->nentries].name = old;
 
+	/* terminate the (shortened) table */
+	if ( to + 1 < stbl->nentries )
+		stbl->syms[to + 1].name = 0;
+
 	stbl->nentries = to + 1;
+
+	/* failure is not fatal; lookups fall back to bsearch */
+	cexpHashSymTbl( stbl );
+
+	/* stale; rebuilt by the next regex search (if at all) */
+	free( stbl->tsig );
+	stbl->tsig = 0;
+}
+
+/* one of 64 bits for a trigram */
+#define TRIGRAM_BIT(p) \
+	(1ULL << (((  ((uint32_t)(unsigned char)(p)[0] << 16) \
+	            | ((uint32_t)(unsigned char)(p)[1] <<  8) \
+	            |  (uint32_t)(unsigned char)(p)[2]) * 2654435761U) >> 26))
+
+static uint64_t
+trigramSig(const char *s)
+{
+uint64_t rval = 0;
+	if ( s[0] && s[1] ) {
+		for ( ; s[2]; s++ )
+			rval |= TRIGRAM_BIT(s);
+	}
+	return rval;
+}
+
+#ifdef __rtems__
+int cexpSymTblSignatures = 0;
+#else
+int cexpSymTblSignatures = 1;
+#endif
+
+int
+cexpSigSymTbl(CexpSymTbl t)
+{
+unsigned long	i;
+uint64_t		*sig;
+char			*buf  = 0;
+CexpSym			bsym  = 0;
+const char		*benc = 0, *name;
+
+	if ( t->tsig || 0 == t->nentries )
+		return 0;
+
+	if ( t->imgTsig ) {
+		CEXP_ATOMIC_CASPTR(&t->tsig, 0, (uint64_t*)t->imgTsig);
+		return 0;
+	}
+
+	if ( ! (sig = malloc( t->nentries * sizeof(*sig) )) )
+		return -1;
+
+	/* don't decode the names permanently */
+	if ( t->fc && ! (buf = malloc( t->fc->maxlen + 1 )) ) {
+		free( sig );
+		return -1;
+	}
+
+	for ( i = 0; i < t->nentries; i++ ) {
+		name = imgName(t, t->syms[i].name);
+		if ( fcPending == name ) {
+			fcDecode(t, &t->syms[i], buf, &bsym, &benc);
+			name = buf;
+		}
+		sig[i] = trigramSig( name );
+	}
+
+	free( buf );
+
+	/* somebody else might have been faster */
+	if ( ! CEXP_ATOMIC_CASPTR(&t->tsig, 0, sig) )
+		free( sig );
+
+	return 0;
+}
+
+/* compare a name against a prefix; consistent with _cexp_namecomp() */
+static int
+pfxcomp(const char *name, const char *pfx)
+{
+register int rval;
+	while ( *pfx ) {
+		if ( (rval = *name++ - *pfx++) )
+			return rval;
+	}
+	return 0;
+}
+
+/* pfxcomp() of the name of symbol 'i' */
+static int
+tblPfxComp(CexpSymTbl t, unsigned long i, const char *pfx)
+{
+	if ( fcPending == t->syms[i].name )
+		return fcCompare(t, i, pfx, 1);
+	return pfxcomp(imgName(t, t->syms[i].name), pfx);
+}
+
+unsigned long
+cexpSymTblPrefixRange(const char *pfx, CexpSymTbl t, CexpSym *pfirst)
+{
+unsigned long lo, hi, mid, end;
+
+	/* the names are sorted; find the range starting with the prefix */
+	for ( lo = 0, hi = t->nentries; lo < hi; ) {
+		mid = (lo + hi) >> 1;
+		if ( tblPfxComp( t, mid, pfx ) < 0 )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for ( end = t->nentries; hi < end; ) {
+		mid = (hi + end) >> 1;
+		if ( tblPfxComp( t, mid, pfx ) > 0 )
+			end = mid;
+		else
+			hi = mid + 1;
+	}
+	*pfirst = t->syms + lo;
+	return end - lo;
+}
+
+/* Demangled names (see cexpSymTblDemangle())
+ *
+ * Every symbol with a C++ (Itanium ABI) name gets its demangled
+ * name in 'dn'; 'ents' is sorted by qualified name (w/o return
+ * type and parameter list) and then by the name including the
+ * parameters. Thus, all overloads of a function are adjacent
+ * and the qualified names starting with a prefix, too.
+ */
+typedef struct CexpDmglIdxRec_ {
+	const char		**dn;		/* per symbol; NULL if not a C++ name */
+	CexpDmglEnt		ents;
+	unsigned long	n;
+	CexpStrTbl		strs;
+} CexpDmglIdxRec, *CexpDmglIdx;
+
+#define DMGL_ARENA_CHUNK	16384
+
+/* RETURNS: length of demangled name 'd' w/o its parameter
+ *          list (the last parenthesized group, if only
+ *          qualifiers such as "const" or "&" follow it) and
+ *          w/o " [clone .xxx]" suffixes.
+ */
+static unsigned long
+dmglQLen(const char *d)
+{
+const char	*e = d + strlen(d), *p;
+int			depth;
+
+	while ( e > d && ']' == e[-1] ) {
+		for ( p = e - 1, depth = 0; p > d; p-- ) {
+			if ( ']' == *p )
+				depth++;
+			else if ( '[' == *p && 0 == --depth )
+				break;
+		}
+		while ( p > d && ' ' == p[-1] )
+			p--;
+		e = p;
+	}
+
+	for ( p = e; p > d && ( (p[-1] >= 'a' && p[-1] <= 'z') || ' ' == p[-1] || '&' == p[-1] ); p-- )
+		/* skip qualifiers */;
+
+	if ( p == d || ')' != p[-1] )
+		return e - d;
+
+	for ( p--, depth = 0; p >= d; p-- ) {
+		if ( ')' == *p )
+			depth++;
+		else if ( '(' == *p && 0 == --depth )
+			return p - d;
+	}
+	return e - d;
+}
+
+/* RETURNS: start of the name proper within the first 'qlen'
+ *          chars of 'd', i.e., past the return type (which
+ *          only template functions have).
+ */
+static const char *
+dmglSkipRet(const char *d, unsigned long qlen)
+{
+const char	*p, *b = d;
+int			depth = 0;
+
+	for ( p = d; p < d + qlen; p++ ) {
+		switch ( *p ) {
+			case '<': case '(': case '[':
+				depth++;
+			break;
+			case '>': case ')': case ']':
+				depth--;
+			break;
+			case ' ':
+				if ( 0 == depth )
+					b = p + 1;
+			break;
+			case 'o':
+				/* blanks and brackets of operator names separate nothing */
+				if ( 0 == depth && ( p == d || ':' == p[-1] || ' ' == p[-1] ) && ! strncmp(p, "operator", 8) )
+					return b;
+			break;
+			default:
+			break;
+		}
+	}
+	return b;
+}
+
+/* memcmp() of strings of length 'al' and 'bl' */
+static int
+dmglcomp(const char *a, unsigned long al, const char *b, unsigned long bl)
+{
+int c = memcmp(a, b, al < bl ? al : bl);
+	return c ? c : (al > bl) - (al < bl);
+}
+
+static int
+dmglEntComp(const void *a, const void *b)
+{
+CexpDmglEnt	x = (CexpDmglEnt)a;
+CexpDmglEnt	y = (CexpDmglEnt)b;
+int			c;
+
+	if ( (c = dmglcomp(x->name, x->qlen, y->name, y->qlen)) )
+		return c;
+	if ( (c = strcmp(x->name, y->name)) )
+		return c;
+	return (x->sym > y->sym) - (x->sym < y->sym);
+}
+
+/* Allocate 'len' chars from a list of chunks; *pfree and *pavail
+ * describe what is left in the current one.
+ *
+ * RETURNS: pointer or NULL (no memory).
+ */
+static char *
+arenaAlloc(CexpStrTbl *parena, char **pfree, unsigned long *pavail, unsigned long len)
+{
+CexpStrTbl		a;
+unsigned long	l;
+char			*rval;
+
+	if ( *pavail < len ) {
+		l = len > DMGL_ARENA_CHUNK ? len : DMGL_ARENA_CHUNK;
+		if ( ! (a = malloc(sizeof(*a))) )
+			return 0;
+		if ( ! (a->chars = malloc(l)) ) {
+			free(a);
+			return 0;
+		}
+		a->next = *parena;
+		*parena = a;
+		*pfree  = a->chars;
+		*pavail = l;
+	}
+	rval     = *pfree;
+	*pfree  += len;
+	*pavail -= len;
+	return rval;
+}
+
+static void
+strTblFree(CexpStrTbl strs)
+{
+CexpStrTbl	n;
+
+	for ( ; strs; strs = n ) {
+		n = strs->next;
+		free(strs->chars);
+		free(strs);
+	}
+}
+
+static void
+dmglFree(CexpDmglIdx d)
+{
+	if ( d ) {
+		strTblFree(d->strs);
+		free(d->ents);
+		free(d->dn);
+		free(d);
+	}
+}
+
+/* a range of symbols demangled by one thread */
+typedef struct DmglChunkRec_ {
+	CexpSymTbl			t;
+	CexpDemangleProc	dm;
+	unsigned long		lo, hi;
+	const char			**dn;
+	CexpDmglEnt			ents;		/* index entries of the C++ names */
+	unsigned long		n, size;
+	CexpStrTbl			strs;		/* holding the names              */
+	char				*afree;
+	unsigned long		avail;
+	int					err;
+} DmglChunkRec, *DmglChunk;
+
+static void *
+dmglChunk(void *arg)
+{
+DmglChunk		c    = arg;
+CexpSymTbl		t    = c->t;
+char			*fcb = 0, *vb = 0, *out = 0, *d, *p;
+size_t			outl = 0, vbl = 0, l;
+CexpSym			bsym = 0;
+CexpDmglEnt		e;
+const char		*benc, *name;
+unsigned long	i, q;
+int				st;
+
+	if ( t->fc && ! (fcb = malloc(t->fc->maxlen + 1)) )
+		goto cleanup;
+
+	for ( i = c->lo; i < c->hi; i++ ) {
+		name = imgName(t, t->syms[i].name);
+		if ( fcPending == name ) {
+			fcDecode(t, &t->syms[i], fcb, &bsym, &benc);
+			name = fcb;
+		}
+		if ( '_' != name[0] || 'Z' != name[1] )
+			continue;
+#if LINKER_VERSION_SEPARATOR
+		/* no version suffix (e.g., "@@GLIBCXX_3.4") */
+		if ( (p = strchr(name, LINKER_VERSION_SEPARATOR)) ) {
+			if ( (l = p - name + 1) > vbl ) {
+				if ( ! (p = realloc(vb, l)) )
+					goto cleanup;
+				vb  = p;
+				vbl = l;
+			}
+			memcpy(vb, name, l - 1);
+			vb[l - 1] = 0;
+			name = vb;
+		}
+#endif
+		if ( ! (d = c->dm(name, out, &outl, &st)) ) {
+			if ( -1 == st )
+				goto cleanup;
+			/* not a valid name */
+			continue;
+		}
+		out = d;
+		l   = strlen(d) + 1;
+		if ( ! (p = arenaAlloc(&c->strs, &c->afree, &c->avail, l)) )
+			goto cleanup;
+		memcpy(p, d, l);
+		c->dn[i] = p;
+
+		if ( c->n >= c->size ) {
+			if ( ! (e = realloc(c->ents, (c->size + 1024) * sizeof(*e))) )
+				goto cleanup;
+			c->ents  = e;
+			c->size += 1024;
+		}
+		e = &c->ents[c->n++];
+		q = dmglQLen(p);
+		/* special names ("vtable for X", "guard variable for x")
+		 * are kept whole
+		 */
+		if ( 'T' == name[2] || 'G' == name[2] ) {
+			e->name = p;
+			e->qlen = l - 1;
+		} else {
+			e->name = dmglSkipRet(p, q);
+			e->qlen = q - (e->name - p);
+		}
+		e->sym  = &t->syms[i];
+	}
+
+	c->err = 0;
+
+cleanup:
+	free(out);
+	free(vb);
+	free(fcb);
+	return 0;
+}
+
+int
+cexpSymTblDemangle(CexpSymTbl t, CexpDemangleProc dm)
+{
+CexpDmglIdx		d = 0;
+DmglChunkRec	c[CEXP_SYMTBL_MAX_THREADS];
+CexpStrTbl		s;
+int				nthr = 0, k, err = 0;
+
+	if ( t->dmgl || ! dm )
+		return 0;
+
+	if ( ! (d = calloc(1, sizeof(*d))) )
+		goto cleanup;
+
+	if ( t->nentries && ! (d->dn = calloc(t->nentries, sizeof(*d->dn))) )
+		goto cleanup;
+
+	/* the demangler takes time; split the work */
+	nthr = symtblNThreads(t->nentries);
+	for ( k = 0; k < nthr; k++ ) {
+		memset(&c[k], 0, sizeof(c[k]));
+		c[k].t   = t;
+		c[k].dm  = dm;
+		c[k].lo  = t->nentries * k / nthr;
+		c[k].hi  = t->nentries * (k + 1) / nthr;
+		c[k].dn  = d->dn;
+		c[k].err = -1;
+	}
+	symtblRun(dmglChunk, c, sizeof(c[0]), nthr);
+
+	for ( k = 0; k < nthr; k++ ) {
+		while ( (s = c[k].strs) ) {
+			c[k].strs = s->next;
+			s->next   = d->strs;
+			d->strs   = s;
+		}
+		d->n += c[k].n;
+		err  |= c[k].err;
+	}
+
+	if ( err || ( d->n && ! (d->ents = malloc(d->n * sizeof(*d->ents))) ) )
+		goto cleanup;
+
+	for ( k = 0, d->n = 0; k < nthr; k++ ) {
+		memcpy(d->ents + d->n, c[k].ents, c[k].n * sizeof(*d->ents));
+		d->n += c[k].n;
+		free(c[k].ents);
+		c[k].ents = 0;
+	}
+	qsort(d->ents, d->n, sizeof(*d->ents), dmglEntComp);
+
+	/* somebody else might have been faster */
+	if ( ! CEXP_ATOMIC_CASPTR(&t->dmgl, 0, d) )
+		dmglFree(d);
+
+	return 0;
+
+cleanup:
+	for ( k = 0; k < nthr; k++ )
+		free(c[k].ents);
+	dmglFree(d);
+	return -1;
+}
+
+int
+cexpSymTblMayHaveMangled(CexpSymTbl t, const char *key)
+{
+CexpSymTblLazy l = t->lazy;
+
+	if ( l && ! l->filled && l->mangled )
+		return l->mangled(key, l->arg);
+	return 1;
+}
+
+CexpSym
+cexpSymTblLookupDemangled(const char *name, CexpSymTbl t)
+{
+CexpDmglIdx		d = t->dmgl;
+CexpDmglEnt		e;
+unsigned long	lo, hi, mid, qlen;
+int				c, full;
+
+	if ( ! d )
+		return 0;
+
+	/* w/o a parameter list only the qualified names are compared */
+	qlen = dmglQLen(name);
+	full = 0 != name[qlen];
+
+	for ( lo = 0, hi = d->n; lo < hi; ) {
+		e   = &d->ents[mid = (lo + hi) >> 1];
+		c   = dmglcomp(e->name, e->qlen, name, qlen);
+		if ( 0 == c && full )
+			c = strcmp(e->name, name);
+		if ( c < 0 )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if ( lo < d->n ) {
+		e = &d->ents[lo];
+		if ( 0 == dmglcomp(e->name, e->qlen, name, qlen) && ( ! full || 0 == strcmp(e->name, name) ) )
+			return cexpSymTblResolve(t, e->sym);
+	}
+	return 0;
+}
+
+/* compare the qualified name of 'e' with prefix 'pfx' */
+static int
+dmglPfxComp(CexpDmglEnt e, const char *pfx, unsigned long plen)
+{
+int c = memcmp(e->name, pfx, e->qlen < plen ? e->qlen : plen);
+	return c ? c : ( e->qlen < plen ? -1 : 0 );
+}
+
+unsigned long
+cexpSymTblDemangledRange(const char *pfx, CexpSymTbl t, CexpDmglEnt *pfirst)
+{
+CexpDmglIdx		d    = t->dmgl;
+unsigned long	plen = strlen(pfx), lo, hi, mid, end;
+
+	if ( ! d )
+		return 0;
+
+	for ( lo = 0, hi = d->n; lo < hi; ) {
+		mid = (lo + hi) >> 1;
+		if ( dmglPfxComp( &d->ents[mid], pfx, plen ) < 0 )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for ( end = d->n; hi < end; ) {
+		mid = (hi + end) >> 1;
+		if ( dmglPfxComp( &d->ents[mid], pfx, plen ) > 0 )
+			end = mid;
+		else
+			hi = mid + 1;
+	}
+	*pfirst = d->ents + lo;
+	return end - lo;
+}
+
+void
+cexpSymTblScanInit(CexpSymTblScan sc, cexp_regex *rc, CexpSymTbl t)
+{
+unsigned long n;
+
+	sc->first = t->syms;
+	sc->last  = t->syms + t->nentries;
+	sc->sig   = rc->must ? trigramSig( rc->must ) : 0;
+	sc->bsym  = 0;
+	sc->benc  = 0;
+	sc->dn    = 0;
+	sc->buf   = 0;
+
+	if ( rc->scoped ) {
+		/* the literals are of no use for the mangled names */
+		sc->sig = 0;
+		if ( t->dmgl )
+			sc->dn = t->dmgl->dn;
+		else
+			sc->last = sc->first;
+		return;
+	}
+
+	/* on failure every name is matched */
+	if ( sc->sig && (cexpSymTblSignatures || t->imgTsig) )
+		cexpSigSymTbl( t );
+
+	/* if there is no memory names are decoded permanently */
+	sc->buf   = t->fc ? malloc( t->fc->maxlen + 1 ) : 0;
+
+	if ( rc->prefix ) {
+		n        = cexpSymTblPrefixRange( rc->prefix, t, &sc->first );
+		sc->last = sc->first + n;
+	}
+}
+
+int
+cexpSymTblScanMatch(CexpSymTblScan sc, cexp_regex *rc, CexpSymTbl t, CexpSym s)
+{
+	if ( sc->dn )
+		return sc->dn[s - t->syms] && cexp_regexec(rc, sc->dn[s - t->syms]);
+	if ( sc->sig && t->tsig && sc->sig != (t->tsig[s - t->syms] & sc->sig) )
+		return 0;
+	/* cexp_regexec() checks for 'must' */
+	if ( fcPending == s->name ) {
+		if ( ! sc->buf )
+			return cexp_regexec(rc, cexpSymTblResolve(t, s)->name);
+		fcDecode(t, s, sc->buf, &sc->bsym, &sc->benc);
+		return cexp_regexec(rc, sc->buf);
+	}
+	return cexp_regexec(rc, imgName(t, s->name));
+}
+
+void
+cexpSymTblScanFini(CexpSymTblScan sc)
+{
+	free(sc->buf);
+	sc->buf  = 0;
+	sc->bsym = 0;
+}
+
+int
+cexpHashSymTbl(CexpSymTbl t)
+{
+unsigned long n,h;
+unsigned      i;
+
+	free( t->hindex );
+	free( t->bloom );
+	t->hindex = 0;
+	t->hmask  = 0;
+	t->bloom  = 0;
+	t->bmask  = 0;
+
+	if ( 0 == t->nentries )
+		return 0;
+
+	/* keep the load factor <= 1/2 */
+	for ( n = 2; n < 2*t->nentries; n <<= 1 )
+		/* nothing else to do */;
+
+	if ( ! (t->hindex = calloc(n, sizeof(*t->hindex))) )
+		return -1;
+
+	t->hmask = n - 1;
+
+	/* the bloom filter is optional; n is a power of two >= 2*nentries */
+	if ( (t->bloom = calloc((n * BLOOM_BITS_PER_SYM/2 + BLOOM_LONG_BITS - 1)/BLOOM_LONG_BITS, sizeof(*t->bloom))) )
+		t->bmask = n * BLOOM_BITS_PER_SYM/2 - 1;
+
+	for ( i = 0; i < t->nentries; i++ ) {
+		h = _cexp_namehash(t->syms[i].name);
+		if ( t->bloom ) {
+			BLOOM_SET(t->bloom, BLOOM_H1(h, t->bmask));
+			BLOOM_SET(t->bloom, BLOOM_H2(h, t->bmask));
+		}
+		for ( h &= t->hmask; t->hindex[h]; h = (h+1) & t->hmask )
+			/* nothing else to do */;
+		t->hindex[h] = i + 1;
+	}
+
+	return 0;
 }
 
 
 CexpSymTbl
 cexpAddSymTbl(CexpSymTbl stbl, void *syms, int symSize, int nsyms, CexpSymFilterProc filter, CexpSymAssignProc assign, void *closure, unsigned flags)
 {
-char		*sp,*dst;
-const char	*symname;
+char		*sp;
 CexpSymTbl	rval;
-CexpSym		cesp;
-int			n,nDstSyms,nDstChars;
+int			i,nthr,nDstSyms,nDstChars;
 CexpStrTbl  strtbl = 0;
+AddChunkRec	chunk[CEXP_SYMTBL_MAX_THREADS];
 
 	if ( stbl ) {
 		rval = stbl;
@@ -263,133 +1765,493 @@ CexpStrTbl  strtbl = 0;
 			return 0;
 	}
 
-	if ( filter && assign ) {
+	if ( filter && assign ) {
+
+		if ( rval->syms && 0 == rval->size ) {
+			/* cannot add to a table that we didn't create */
+			return 0;
+		}
+
+		/* the callbacks may only be executed concurrently if the caller says so */
+		nthr = (flags & CEXP_SYMTBL_FLAG_MT_SAFE) ? symtblNThreads(nsyms) : 1;
+
+		for ( i=0, sp=syms; i<nthr; i++ ) {
+			memset(&chunk[i], 0, sizeof(chunk[i]));
+			chunk[i].syms    = sp;
+			chunk[i].symSize = symSize;
+			chunk[i].nsyms   = nsyms/nthr + ( i < nsyms%nthr ? 1 : 0 );
+			chunk[i].filter  = filter;
+			chunk[i].assign  = assign;
+			chunk[i].closure = closure;
+			chunk[i].flags   = flags;
+			sp += chunk[i].nsyms * symSize;
+		}
+
+		/* count the number of valid symbols */
+		symtblRun(addChunkCount, chunk, sizeof(chunk[0]), nthr);
+
+		for ( i=0, nDstSyms=0, nDstChars=0; i<nthr; i++ ) {
+			nDstSyms  += chunk[i].nDstSyms;
+			nDstChars += chunk[i].nDstChars;
+		}
+
+		/* create our copy of the symbol table - the object format contains
+		 * many things we're not interested in and also, it's not
+		 * sorted...
+		 */
+
+		if ( nDstSyms > rval->size - rval->nentries ) {
+			/* allocate all the table space */
+			if ( ! (rval->syms=(CexpSym)realloc(rval->syms, sizeof(rval->syms[0])*(rval->nentries + nDstSyms + 1))) )
+				goto cleanup;
+
+			rval->size = rval->nentries + nDstSyms;
+		}
+
+		if ( nDstChars ) {
+			if ( !(strtbl = malloc(sizeof(*strtbl))) )
+				goto cleanup;
+			if ( !(strtbl->chars = malloc(nDstChars)) ) {
+				free( strtbl );
+				strtbl = 0;
+				goto cleanup;
+			}
+			strtbl->next = rval->strtbl;
+			rval->strtbl = strtbl;
+		}
+	
+		/* now copy the relevant stuff; every chunk gets its slice of
+		 * the symbol and string tables so that the result is the same
+		 * as if all symbols were processed in order.
+		 */
+		chunk[0].dst   = rval->syms + rval->nentries;
+		chunk[0].chars = strtbl ? strtbl->chars : 0;
+		for ( i=1; i<nthr; i++ ) {
+			chunk[i].dst   = chunk[i-1].dst + chunk[i-1].nDstSyms;
+			chunk[i].chars = strtbl ? chunk[i-1].chars + chunk[i-1].nDstChars : 0;
+		}
+		symtblRun(addChunkCopy, chunk, sizeof(chunk[0]), nthr);
+
+		/* mark the last table entry */
+		rval->syms[rval->nentries + nDstSyms].name=0;
+	} else { /* no filter or assign callback -- they pass us a list of symbols in already */
+		if ( rval->syms ) {
+			/* cannot add an existing list of symbols to another */
+			return 0;
+		}
+		nDstSyms   = nsyms;
+		rval->syms = syms;
+	}
+
+	rval->nentries += nDstSyms;
+
+	return rval;
+
+cleanup:
+	if ( stbl ) {
+		/* leave old table alone */
+	} else {
+		cexpFreeSymTbl(&rval);
+	}
+	return 0;
+}
+
+void
+cexpSymTblAdoptStrings(CexpSymTbl t, void (*release)(void *owner), void *owner)
+{
+	t->strRelease = release;
+	t->strOwner   = owner;
+}
+
+CexpSymTbl
+cexpCreateSymTbl(void *syms, int symSize, int nsyms, CexpSymFilterProc filter, CexpSymAssignProc assign, void *closure)
+{
+CexpSymTbl rval;
+
+	if ( (rval = cexpAddSymTbl( 0, syms, symSize, nsyms, filter, assign, closure, 0)) ) {
+		cexpSortSymTbl( rval );
+	}
+	return rval;
+}
+
+/* Sort the indices of all symbols of 't' by address into 'aidx'
+ * RETURNS 0 on success, nonzero on error (no memory)
+ */
+static int
+symtblAddrIndex(CexpSymTbl t, unsigned *aidx)
+{
+int     i;
+CexpSym *tmp;
+
+	if ( symtblRadixIndex(t, aidx, symtblNThreads(t->nentries)) ) {
+		/* no memory for the radix sort; qsort() has no 'closure'
+		 * argument, sort pointers and convert them to the more
+		 * compact indices (the order is the same)
+		 */
+		if ( t->nentries && ! (tmp = malloc(t->nentries * sizeof(*tmp))) )
+			return -1;
+
+		for ( i = 0; i < t->nentries; i++ ) {
+			tmp[i] = &t->syms[i];
+		}
+		qsort((void*)tmp,
+			t->nentries,
+			sizeof(*tmp),
+			_cexp_addrcomp);
+
+		for ( i = 0; i < t->nentries; i++ ) {
+			aidx[i] = tmp[i] - t->syms;
+		}
+
+		if ( t->nentries )
+			free(tmp);
+	}
+	return 0;
+}
+
+/* (Re-) Build sorted index of addresses */
+int
+cexpIndexSymTbl(CexpSymTbl t)
+{
+	t->aindex = (unsigned*)realloc(t->aindex, t->nentries * sizeof(*t->aindex));
+
+	if ( t->nentries && ! t->aindex )
+		return -1;
+
+	if ( symtblAddrIndex(t, t->aindex) )
+		return -1;
+
+	/* stale; rebuilt by the next address lookup */
+	free( t->eaddr );
+	t->eaddr = 0;
+
+	return 0;
+}
+
+/* does 'p' point into the image of 't' (and must not be free()d)? */
+#define IMG_OWNS(t,p)	((t)->image && (uintptr_t)(p) - (uintptr_t)(t)->image < (t)->imgsize)
+
+unsigned *
+cexpSymTblAddrIndex(CexpSymTbl t)
+{
+CexpSymImgHdr	h = t->image;
+unsigned		*a, *b;
+unsigned long	i;
+
+	if ( t->aindex || ! h )
+		return t->aindex;
+
+	a = (unsigned*)((char*)h + h->off_aindex);
+	for ( i = 0; i < t->nentries && a[i] < t->nentries; i++ )
+		/* nothing else to do */;
+
+	if ( i < t->nentries ) {
+		fprintf(stderr,"Symbol table image corrupted (bad address index); rebuilding it\n");
+		/* the eytzinger array doesn't match ours */
+		t->imgEaddr = 0;
+		if ( (b = malloc(t->nentries * sizeof(*b))) && 0 == symtblAddrIndex(t, b) ) {
+			a = b;
+		} else {
+			free(b);
+			/* the pages are private; this is wrong but harmless */
+			for ( i = 0; i < t->nentries; i++ )
+				a[i] = i;
+		}
+	}
+
+	/* somebody else might have been faster */
+	if ( ! CEXP_ATOMIC_CASPTR(&t->aindex, 0, a) && ! IMG_OWNS(t, a) )
+		free(a);
+
+	return t->aindex;
+}
+
+void
+cexpSymTblRelocate(CexpSymTbl t, uintptr_t bias)
+{
+unsigned long	i;
+
+	for ( i = 0; i < t->nentries; i++ )
+		t->syms[i].value.ptv = (CexpVal)((uintptr_t)t->syms[i].value.ptv + bias);
+
+	/* the order is the same but the addresses are not */
+	if ( ! IMG_OWNS(t, t->eaddr) )
+		free( t->eaddr );
+	t->eaddr    = 0;
+	t->imgEaddr = 0;
+}
+
+#ifdef __rtems__
+int cexpSymTblEytzinger = 0;
+#else
+int cexpSymTblEytzinger = 1;
+#endif
+
+/* fill the eytzinger tree rooted at 'k' with the (sorted)
+ * addresses starting at aindex position 'i' (in-order walk)
+ */
+static unsigned long
+eytzFill(CexpSymTbl t, uintptr_t *e, unsigned *r, unsigned long i, unsigned long k)
+{
+	if ( k <= t->nentries ) {
+		i = eytzFill(t, e, r, i, 2*k);
+		e[k] = (uintptr_t)CEXP_ASYM(t,i)->value.ptv;
+		r[k] = i++;
+		i = eytzFill(t, e, r, i, 2*k+1);
+	}
+	return i;
+}
+
+int
+cexpEytzSymTbl(CexpSymTbl t)
+{
+uintptr_t		*e;
+unsigned		*r;
+unsigned long	k;
+
+	if ( t->eaddr || 0 == t->nentries )
+		return 0;
+
+	/* use the image's unless it doesn't match the address index */
+	if ( CEXP_AINDEX(t) && (e = (uintptr_t*)t->imgEaddr) ) {
+		r = (unsigned*)(e + t->nentries + 1);
+		for ( k = 1; k <= t->nentries && r[k] < t->nentries; k++ )
+			/* nothing else to do */;
+		if ( k > t->nentries ) {
+			CEXP_ATOMIC_CASPTR(&t->eaddr, 0, e);
+			return 0;
+		}
+		fprintf(stderr,"Symbol table image corrupted (bad eytzinger array); rebuilding it\n");
+		t->imgEaddr = 0;
+	}
+
+	/* 1-based; slot 0 is unused. The ranks follow the addresses */
+	if ( ! (e = malloc( (t->nentries + 1) * (sizeof(*e) + sizeof(unsigned)) )) )
+		return -1;
+
+	e[0] = 0;
+	eytzFill(t, e, (unsigned*)(e + t->nentries + 1), 0, 1);
+
+	/* somebody else might have been faster */
+	if ( ! CEXP_ATOMIC_CASPTR(&t->eaddr, 0, e) )
+		free( e );
+
+	return 0;
+}
+
+/* Check that the header describes a consistent image of
+ * (file) size 'fsize' before anything in it is dereferenced.
+ * Only the layout is checked (in constant time); the indices
+ * are validated when they are used.
+ *
+ * RETURNS: 0 if OK, nonzero otherwise.
+ */
+static int
+symImgCheck(CexpSymImgHdr h, unsigned long fsize)
+{
+unsigned long nhash = (unsigned long)h->hmask + 1;
+
+	if (   h->size != fsize
+	    || h->idlen > CEXP_SYMIMG_IDMAX
+	    || h->off_syms < sizeof(*h)
+	    || ((h->off_eytz | h->off_tsig) & 7)
+	    || h->off_syms > h->size || h->off_aindex > h->size
+	    || h->off_hindex > h->size || h->off_eytz > h->size
+	    || h->off_tsig > h->size || h->off_strings > h->size )
+		return -1;
+
+	/* the sizes are bounded by the image size; no overflow below */
+	if (   h->nentries >= (h->size - h->off_syms) / sizeof(CexpSymRec)
+	    || h->off_syms   + (h->nentries + 1) * sizeof(CexpSymRec) > h->off_aindex
+	    || h->off_aindex + h->nentries * sizeof(uint32_t)        > h->off_hindex )
+		return -1;
+
+	/* power of two; more slots than symbols (probing must end) */
+	if (   0 == nhash || (nhash & (nhash - 1))
+	    || nhash <= h->nentries
+	    || nhash > (h->size - h->off_hindex) / sizeof(uint32_t)
+	    || h->off_hindex + nhash * sizeof(uint32_t) > h->off_eytz )
+		return -1;
+
+	if (   h->off_eytz + (h->nentries + 1) * (sizeof(uintptr_t) + sizeof(uint32_t)) > h->off_tsig
+	    || h->off_tsig + h->nentries * sizeof(uint64_t) > h->off_strings )
+		return -1;
+
+	/* names are terminated by the end of the image at the latest */
+	if ( h->off_path && (h->off_path < h->off_strings || h->off_path >= h->size) )
+		return -1;
+
+	return 0;
+}
+
+CexpSymTbl
+cexpMapSymTblImage(FILE *f, const unsigned char *id, unsigned idlen)
+{
+CexpSymImgHdrRec	hdr;
+CexpSymTbl			rval = 0;
+char				*img = 0;
+struct stat			st;
+unsigned long		tsizes = CEXP_SYMIMG_TSIZES(sizeof(short), sizeof(int), sizeof(long), sizeof(float), sizeof(double));
+#ifdef HAVE_SYS_MMAN_H
+unsigned long		pgmsk, ro;
+#endif
 
-		if ( rval->syms && 0 == rval->size ) {
-			/* cannot add to a table that we didn't create */
-			return 0;
-		}
+	if (   1 != fread(&hdr, sizeof(hdr), 1, f)
+	    || memcmp(hdr.magic, CEXP_SYMIMG_MAGIC, sizeof(hdr.magic)) ) {
+		rewind(f);
+		return 0;
+	}
 
-		/* count the number of valid symbols */
-		if ( (flags & CEXP_SYMTBL_FLAG_NO_STRCPY) ) {
-			for (sp=syms,n=0,nDstSyms=0; n<nsyms; sp+=symSize,n++) {
-				if ((symname=filter(sp,closure))) {
-					nDstSyms++;
-				}
-			}
-			nDstChars = 0;
-		} else {
-			for (sp=syms,n=0,nDstSyms=0,nDstChars=0; n<nsyms; sp+=symSize,n++) {
-				if ((symname=filter(sp,closure))) {
-					nDstChars+=strlen(symname)+1;
-					nDstSyms++;
-				}
-			}
-		}
+	if (   CEXP_SYMIMG_VERSION != hdr.version
+	    || CEXP_SYMIMG_ENDIAN  != hdr.endian
+	    || sizeof(CexpSymRec)  != hdr.recsize
+	    || tsizes              != hdr.tsizes ) {
+		fprintf(stderr,"Symbol table image incompatible with this executable (rebuild with 'xsyms -I')\n");
+		return 0;
+	}
 
-		/* create our copy of the symbol table - the object format contains
-		 * many things we're not interested in and also, it's not
-		 * sorted...
-		 */
+	if ( fstat(fileno(f), &st) || symImgCheck(&hdr, st.st_size) ) {
+		fprintf(stderr,"Symbol table image corrupted or truncated\n");
+		return 0;
+	}
 
-		if ( nDstSyms > rval->size - rval->nentries ) {
-			/* allocate all the table space */
-			if ( ! (rval->syms=(CexpSym)realloc(rval->syms, sizeof(rval->syms[0])*(rval->nentries + nDstSyms + 1))) )
-				goto cleanup;
+	if ( idlen > CEXP_SYMIMG_IDMAX )
+		idlen = CEXP_SYMIMG_IDMAX;
+	if ( hdr.idlen && idlen && (hdr.idlen != idlen || memcmp(hdr.id, id, idlen)) ) {
+		fprintf(stderr,"Symbol table image was not made from this executable (build-ids differ)\n");
+		return 0;
+	}
 
-			rval->size = rval->nentries + nDstSyms;
-		}
+#ifdef HAVE_SYS_MMAN_H
+	/* private, writable mapping; nothing is copied unless modified,
+	 * i.e., the records of symbols which are handed out (names are
+	 * converted to pointers) and a corrupted address index. The
+	 * rest is made read-only below.
+	 */
+	img = mmap(0, hdr.size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(f), 0);
+	if ( MAP_FAILED == (void*)img ) {
+		fprintf(stderr,"Unable to map symbol table image: %s\n", strerror(errno));
+		img = 0;
+		goto cleanup;
+	}
+#else
+	if ( ! (img = malloc(hdr.size)) ) {
+		goto cleanup;
+	}
+	rewind(f);
+	if ( 1 != fread(img, hdr.size, 1, f) ) {
+		fprintf(stderr,"Unable to read symbol table image\n");
+		goto cleanup;
+	}
+#endif
 
-		if ( nDstChars ) {
-			if ( !(strtbl = malloc(sizeof(*strtbl))) )
-				goto cleanup;
-			if ( !(strtbl->chars = malloc(nDstChars)) ) {
-				free( strtbl );
-				strtbl = 0;
-				goto cleanup;
-			}
-			strtbl->next = rval->strtbl;
-			rval->strtbl = strtbl;
-		}
-	
-		/* now copy the relevant stuff */
-		dst = strtbl ? strtbl->chars : 0;
-		for (sp=syms,n=0,cesp=rval->syms + rval->nentries; n<nsyms; sp+=symSize,n++) {
-			if ((symname=filter(sp,closure))) {
-					memset(cesp,0,sizeof(*cesp));
-					if ( (flags & CEXP_SYMTBL_FLAG_NO_STRCPY) ) {
-						cesp->name=symname;
-					} else {
-						/* copy the name to the string table and put a pointer
-						 * into the symbol table.
-						 */
-						cesp->name=dst;
-						while ((*(dst++)=*(symname++)))
-							/* do nothing else */;
-					}
-					cesp->flags = 0;
-	
-					assign(sp,cesp,closure);
-	
-				
-					cesp++;
-			}
-		}
-		/* mark the last table entry */
-		cesp->name=0;
-	} else { /* no filter or assign callback -- they pass us a list of symbols in already */
-		if ( rval->syms ) {
-			/* cannot add an existing list of symbols to another */
-			return 0;
-		}
-		nDstSyms   = nsyms;
-		rval->syms = syms;
+	/* see imgName(); the last string must be terminated */
+	if ( (uintptr_t)img < hdr.size || (hdr.size > hdr.off_strings && img[hdr.size - 1]) ) {
+		fprintf(stderr,"Symbol table image corrupted or unusable at this address\n");
+		goto cleanup;
 	}
 
-	rval->nentries += nDstSyms;
+	if ( ! (rval = calloc(1, sizeof(*rval))) )
+		goto cleanup;
+
+	rval->image    = img;
+	rval->imgsize  = hdr.size;
+	rval->nentries = hdr.nentries;
+	rval->size     = 0; /* cannot add to this table */
+	rval->syms     = (CexpSym)(img + hdr.off_syms);
+	/* validated by its first use (CEXP_AINDEX()) */
+	rval->aindex   = 0;
+	rval->hindex   = (unsigned*)(img + hdr.off_hindex);
+	rval->hmask    = hdr.hmask;
+	rval->imgEaddr = (const uintptr_t*)(img + hdr.off_eytz);
+	rval->imgTsig  = (const uint64_t*)(img + hdr.off_tsig);
+
+#ifdef HAVE_SYS_MMAN_H
+	pgmsk = getpagesize() - 1;
+	ro    = (hdr.off_hindex + pgmsk) & ~pgmsk;
+	if ( ro < hdr.size )
+		mprotect(img + ro, hdr.size - ro, PROT_READ);
+#endif
 
-	return rval;
+	img  = 0;
 
 cleanup:
-	if ( stbl ) {
-		/* leave old table alone */
-	} else {
-		cexpFreeSymTbl(&rval);
+	if ( img ) {
+		free(rval);
+		rval = 0;
+#ifdef HAVE_SYS_MMAN_H
+		munmap(img, hdr.size);
+#else
+		free(img);
+#endif
 	}
-	return 0;
+	return rval;
 }
 
-CexpSymTbl
-cexpCreateSymTbl(void *syms, int symSize, int nsyms, CexpSymFilterProc filter, CexpSymAssignProc assign, void *closure)
+const char *
+cexpSymTblImagePath(CexpSymTbl t)
 {
-CexpSymTbl rval;
+CexpSymImgHdr	h = t->image;
 
-	if ( (rval = cexpAddSymTbl( 0, syms, symSize, nsyms, filter, assign, closure, 0)) ) {
-		cexpSortSymTbl( rval );
-	}
-	return rval;
+	return h && h->off_path ? (const char*)h + h->off_path : 0;
 }
 
-/* (Re-) Build sorted index of addresses */
-int
-cexpIndexSymTbl(CexpSymTbl t)
+/* records of the prebuilt table may be read-only; the
+ * help flags of these are not maintained (see helpText()).
+ * There is only one such table (the builtin one).
+ */
+static CexpSym			roSyms = 0;
+static unsigned long	roNum  = 0;
+
+#define SYM_RO(s)	((s) >= roSyms && (s) < roSyms + roNum)
+
+CexpSymTbl
+cexpInstallPrebuiltSymTbl(CexpSym syms, const CexpSymTblPrebuiltRec *idx)
 {
-int i;
+CexpSymTbl		rval;
+unsigned long	i;
 
-	t->aindex = (CexpSym*)realloc(t->aindex, t->nentries * sizeof(*t->aindex));
+	if (   CEXP_SYMTBL_PREBUILT_VERSION != idx->version
+	    || syms[idx->nentries].name ) {
+		fprintf(stderr,"Builtin symbol table incompatible with this executable (regenerate with 'xsyms -C')\n");
+		return 0;
+	}
 
-	if ( t->nentries && ! t->aindex )
-		return -1;
+	if ( ! (rval = calloc(1, sizeof(*rval))) )
+		return 0;
 
-	for ( i = 0; i < t->nentries; i++ ) {
-		t->aindex[i] = &t->syms[i];
+	rval->prebuilt = idx;
+	rval->nentries = idx->nentries;
+	rval->size     = 0; /* cannot add to this table */
+	rval->syms     = syms;
+	rval->aindex   = (unsigned*)idx->aindex;
+	rval->hindex   = (unsigned*)idx->hindex;
+	rval->hmask    = idx->hmask;
+
+	/* the final link may have moved things around (e.g., symbols
+	 * from shared libraries); use our own index in this case.
+	 * The order must be what cexpIndexSymTbl() produces, i.e.,
+	 * symbols at the same address in table order.
+	 */
+	for ( i = 1; i < rval->nentries; i++ ) {
+		if (   CEXP_ASYM(rval, i-1)->value.ptv > CEXP_ASYM(rval, i)->value.ptv
+		    || (   CEXP_ASYM(rval, i-1)->value.ptv == CEXP_ASYM(rval, i)->value.ptv
+		        && rval->aindex[i-1] > rval->aindex[i] ) )
+			break;
 	}
-	qsort((void*)t->aindex,
-		t->nentries,
-		sizeof(*t->aindex),
-		_cexp_addrcomp);
 
-	return 0;
+	if ( i < rval->nentries ) {
+		rval->aindex = 0;
+		if ( cexpIndexSymTbl( rval ) ) {
+			cexpFreeSymTbl( &rval );
+			return 0;
+		}
+	}
+
+	roSyms = syms;
+	roNum  = rval->nentries;
+
+	return rval;
 }
 
 void
@@ -402,17 +2264,68 @@ int			i;
 	if (st) {
 		/* release help info */
 		for (s=st->syms, i=0;  i<st->nentries; i++,s++) {
-			if (s->flags & CEXP_SYMFLG_MALLOC_HELP) {
-				free(s->help);
+			if ( (s->flags & CEXP_SYMFLG_HELP) || SYM_RO(s) ) {
+				cexpSymDropHelp(s);
 			}
 		}
-		free(st->syms);
+		if ( st->syms == roSyms ) {
+			roSyms = 0;
+			roNum  = 0;
+		}
+		if ( st->image ) {
+			/* unless it had to be rebuilt */
+			if ( ! IMG_OWNS(st, st->aindex) )
+				free(st->aindex);
+#ifdef HAVE_SYS_MMAN_H
+			munmap(st->image, st->imgsize);
+#else
+			free(st->image);
+#endif
+		} else if ( st->prebuilt ) {
+			if ( st->aindex != st->prebuilt->aindex )
+				free(st->aindex);
+		} else {
+			free(st->syms);
+			free(st->aindex);
+			free(st->hindex);
+		}
 		while ( (strs = st->strtbl) ) {
 			st->strtbl = strs->next;
 			free(strs->chars);
 			free(strs);
 		}
-		free(st->aindex);
+		if ( ! IMG_OWNS(st, st->eaddr) )
+			free(st->eaddr);
+		if ( ! IMG_OWNS(st, st->tsig) )
+			free(st->tsig);
+		free(st->bloom);
+		dmglFree(st->dmgl);
+		if ( st->fc ) {
+			while ( (strs = st->fc->arena) ) {
+				st->fc->arena = strs->next;
+				free(strs->chars);
+				free(strs);
+			}
+			cexpLockDestroy(st->fc->lock);
+			free(st->fc->enc);
+			free(st->fc);
+		}
+		if ( st->lazy ) {
+			st->lazy->cleanup(st->lazy->arg);
+			cexpLockDestroy(st->lazy->lock);
+			free(st->lazy);
+		}
+		if ( st->locals ) {
+			if ( st->locals->built )
+				cexpFreeSymTbl(&st->locals->tbl);
+			else
+				st->locals->cleanup(st->locals->arg);
+			cexpLockDestroy(st->locals->lock);
+			free(st->locals);
+		}
+		/* names of the locals may point there, too */
+		if ( st->strRelease )
+			st->strRelease(st->strOwner);
 		free(st);
 	}
 	*pt=0;
@@ -420,6 +2333,12 @@ int			i;
 
 int
 cexpSymPrintInfo(CexpSym s, FILE *f)
+{
+	return cexpSymPrintInfoAs(s, s->name, f);
+}
+
+int
+cexpSymPrintInfoAs(CexpSym s, const char *name, FILE *f)
 {
 int			i=0,k;
 CexpType	t=s->value.type;
@@ -439,11 +2358,43 @@ CexpType	t=s->value.type;
 	}
 	while (i++<50)
 		fputc(' ',f);
-	i+=fprintf(f,"%s\n", s->name);
+	i+=fprintf(f,"%s\n", name);
 	return i;
 }
 
-/* do a binary search for an address returning its aindex number;
+/* search the eytzinger tree for the first address > 'addr'
+ * and return the aindex number of its predecessor.
+ */
+static int
+eytzLkAddrIdx(uintptr_t addr, CexpSymTbl t)
+{
+const uintptr_t	*e = t->eaddr;
+unsigned long	n  = t->nentries;
+unsigned long	k  = 1;
+const unsigned	*r = (const unsigned*)(e + n + 1);
+
+	while ( k <= n ) {
+#ifdef __GNUC__
+		/* the nodes 3 levels down share a cache line */
+		__builtin_prefetch( e + 8*k );
+#endif
+		k = 2*k + ( e[k] <= addr );
+	}
+	/* undo the trailing 'right' turns and the last 'left' one */
+#ifdef __GNUC__
+	k >>= __builtin_ctzl(~k) + 1;
+#else
+	while ( k & 1 )
+		k >>= 1;
+	k >>= 1;
+#endif
+	/* k == 0: all addresses are <= 'addr' */
+	if ( 0 == k )
+		return n - 1;
+	return r[k] > 0 ? r[k] - 1 : 0;
+}
+
+/* search for an address returning its aindex number;
  * if multiple entries exist, return the highest index.
  */
 int
@@ -451,23 +2402,31 @@ cexpSymTblLkAddrIdx(void *addr, int margin, FILE *f, CexpSymTbl t)
 {
 int			lo,hi,mid;
 
-	lo=0; hi=t->nentries-1;
+	/* built on first use (an image's costs no memory); on failure we bsearch */
+	if ( ! t->eaddr && (cexpSymTblEytzinger || t->imgEaddr) )
+		cexpEytzSymTbl( t );
+
+	if ( t->eaddr ) {
+		mid = eytzLkAddrIdx((uintptr_t)addr, t);
+	} else {
+		lo=0; hi=t->nentries-1;
 		
-	while (lo < hi) {
-		mid=(lo+hi+1)>>1; /* round up */
-		if (addr < (void*)t->aindex[mid]->value.ptv)
-			hi = mid-1;
-		else
-			lo = mid;
-	}
+		while (lo < hi) {
+			mid=(lo+hi+1)>>1; /* round up */
+			if (addr < (void*)CEXP_ASYM(t,mid)->value.ptv)
+				hi = mid-1;
+			else
+				lo = mid;
+		}
 	
-	mid=lo;
+		mid=lo;
+	}
 
 	if (f) {
 		lo=mid-margin; if (lo<0) 		 	lo=0;
 		hi=mid+margin; if (hi>=t->nentries)	hi=t->nentries-1;
 		while (lo<=hi)
-			cexpSymPrintInfo(t->aindex[lo++],f);
+			cexpSymPrintInfo(cexpSymTblResolve(t, CEXP_ASYM(t,lo++)),f);
 	}
 	return mid;
 }
@@ -475,7 +2434,175 @@ int			lo,hi,mid;
 CexpSym
 cexpSymTblLkAddr(void *addr, int margin, FILE *f, CexpSymTbl t)
 {
-	return t->aindex[cexpSymTblLkAddrIdx(addr,margin,f,t)];
+	return cexpSymTblResolve(t, CEXP_ASYM(t, cexpSymTblLkAddrIdx(addr,margin,f,t)));
+}
+
+/* Sparse side table holding the help text of the few
+ * symbols that have any. Keyed by the symbol's address;
+ * CEXP_SYMFLG_HELP tells us whether to look at all (and
+ * protects us from stale entries of symbols which were
+ * released without dropping their help). Read-only
+ * symbols (SYM_RO()) don't have the flag; we always look.
+ * Readers get a copy (cexpSymHelpCopy()) but the 'help'
+ * member hands out the text itself (see README); it may still
+ * be in use when the help is replaced. Replaced malloc()ed text
+ * is therefore kept (on 'retired') until the help is dropped,
+ * i.e., the symbol goes away.
+ */
+#define HELP_TBL_SIZE	128	/* must be a power of two */
+
+typedef struct CexpHelpOldRec_ {
+	char					*text;
+	struct CexpHelpOldRec_	*next;
+} CexpHelpOldRec, *CexpHelpOld;
+
+typedef struct CexpHelpNodeRec_ {
+	CexpSym					sym;
+	char					*text;
+	int						malloced;
+	CexpHelpOld				retired;	/* replaced (malloc()ed) texts */
+	struct CexpHelpNodeRec_	*next;
+} CexpHelpNodeRec, *CexpHelpNode;
+
+static CexpHelpNode	helpTbl[HELP_TBL_SIZE] = { 0 };
+static CexpLock		helpLock = 0;
+
+#define HELP_HASH(s)	((((unsigned long)(s)) >> 4) & (HELP_TBL_SIZE - 1))
+
+void
+cexpSymTblInitOnce(void)
+{
+	if ( !helpLock )
+		cexpLockCreate(&helpLock);
+}
+
+/* NOTE: must be called with the help lock held */
+static CexpHelpNode *
+helpFind(CexpSym s)
+{
+CexpHelpNode *pp;
+	for ( pp = &helpTbl[HELP_HASH(s)]; *pp && (*pp)->sym != s; pp = &(*pp)->next )
+		/* nothing else to do */;
+	return pp;
+}
+
+/* RETURNS: the help text of 's' (NULL if none); it remains valid
+ *          until the help is dropped (not only until it is replaced).
+ */
+static const char *
+helpText(CexpSym s)
+{
+CexpHelpNode	n;
+const char		*rval = 0;
+
+	if ( ! s || ! ( (s->flags & CEXP_SYMFLG_HELP) || SYM_RO(s) ) )
+		return 0;
+
+	cexpLock(helpLock);
+	if ( (n = *helpFind(s)) )
+		rval = n->text;
+	cexpUnlock(helpLock);
+
+	return rval;
+}
+
+char *
+cexpSymHelpCopy(CexpSym s)
+{
+CexpHelpNode	n;
+char			*rval = 0;
+unsigned long	len  = 0, need;
+
+	if ( ! s || ! ( (s->flags & CEXP_SYMFLG_HELP) || SYM_RO(s) ) )
+		return 0;
+
+	/* (avoid calling malloc from locked section); retry if
+	 * the text was replaced by a longer one meanwhile
+	 */
+	for (;;) {
+		cexpLock(helpLock);
+		if ( ! (n = *helpFind(s)) ) {
+			cexpUnlock(helpLock);
+			free(rval);
+			return 0;
+		}
+		if ( (need = strlen(n->text) + 1) <= len ) {
+			strcpy(rval, n->text);
+			cexpUnlock(helpLock);
+			return rval;
+		}
+		cexpUnlock(helpLock);
+		free(rval);
+		if ( ! (rval = malloc(len = need)) )
+			return 0;
+	}
+}
+
+int
+cexpSymSetHelp(CexpSym s, char *text, int malloced)
+{
+CexpHelpNode	*pp, n = 0, old = 0;
+CexpHelpOld		r = 0, rl;
+char			*oldtxt = 0;
+
+	/* (avoid calling malloc from locked section) */
+	if ( text && ( ! (n = malloc(sizeof(*n))) || ! (r = malloc(sizeof(*r))) ) ) {
+		free(n);
+		return -1;
+	}
+
+	cexpLock(helpLock);
+	pp = helpFind(s);
+	if ( (old = *pp) ) {
+		if ( text ) {
+			if ( old->malloced ) {
+				/* may be in use; keep it until the help is dropped */
+				r->text      = old->text;
+				r->next      = old->retired;
+				old->retired = r;
+				r            = 0;
+			}
+			old->text     = text;
+			old->malloced = malloced;
+		} else {
+			if ( old->malloced )
+				oldtxt = old->text;
+			*pp = old->next;
+		}
+	} else if ( text ) {
+		n->sym      = s;
+		n->text     = text;
+		n->malloced = malloced;
+		n->retired  = 0;
+		n->next     = helpTbl[HELP_HASH(s)];
+		helpTbl[HELP_HASH(s)] = n;
+		n = 0;
+	}
+	if ( SYM_RO(s) ) {
+		/* cannot touch the flags */
+	} else if ( text ) {
+		s->flags |= CEXP_SYMFLG_HELP;
+		if ( malloced )
+			s->flags |= CEXP_SYMFLG_MALLOC_HELP;
+		else
+			s->flags &= ~CEXP_SYMFLG_MALLOC_HELP;
+	} else {
+		s->flags &= ~(CEXP_SYMFLG_HELP | CEXP_SYMFLG_MALLOC_HELP);
+	}
+	cexpUnlock(helpLock);
+
+	free(oldtxt);
+	free(n);
+	free(r);
+	if ( ! text && old ) {
+		while ( (rl = old->retired) ) {
+			old->retired = rl->next;
+			free(rl->text);
+			free(rl);
+		}
+		free(old);
+	}
+	return 0;
 }
 
 /* currently, we have only very rudimentary support; just enough
@@ -489,7 +2616,7 @@ char *newhelp=0;
 int  verbose=0;
 
 	returnVal->type=TUCharP;
-	returnVal->tv.p=sym->help;
+	returnVal->tv.p=(char*)helpText(sym);
 
 	if ((v=va_arg(ap,CexpTypedVal))) {
 		switch (v->type) {
@@ -509,17 +2636,18 @@ int  verbose=0;
 	}
 	
 	if (newhelp) {
-		if (sym->flags & CEXP_SYMFLG_MALLOC_HELP)
-			free(sym->help);
 #if defined(CONFIG_STRINGS_LIVE_FOREVER) && 0 /* might come from another module; we better make a copy */
 		/* the help storage is probably an 'eternal' string */
-		sym->help=newhelp;
+		cexpSymSetHelp(sym, newhelp, 0);
 #else
-		sym->help=strdup(newhelp);
-		sym->flags |= CEXP_SYMFLG_MALLOC_HELP;
+		if ( !(newhelp=strdup(newhelp)) || cexpSymSetHelp(sym, newhelp, 1) ) {
+			free(newhelp);
+			return "Cexp Help: no memory";
+		}
 #endif
 	} else {
-		if (verbose || !sym->help) {
+		char *help = cexpSymHelpCopy(sym);
+		if (verbose || !help) {
 			CexpSym		s;
 			CexpModule	m;
 			if ((s=cexpSymLkAddr(sym->value.ptv,0,0,&m)) &&
@@ -531,10 +2659,11 @@ int  verbose=0;
 			}
 			cexpSymPrintInfo(sym,stdout);
 		}
-		if (sym->help)
-			fprintf(stdout,"%s\n",sym->help);
+		if (help)
+			fprintf(stdout,"%s\n",help);
 		else
 			fprintf(stdout,"No help available\n");
+		free(help);
 	}
 	return 0;
 }
@@ -566,3 +2695,252 @@ cexpSymValue(CexpSym s)
 {
 	return s ? (void*)s->value.ptv : 0;
 }
+
+#ifdef CEXPSYMS_BENCH_MAIN
+/* only build this 'main' if we are benchmarking the symbol table */
+#include <time.h>
+
+static double
+nsDiff(struct timespec *a, struct timespec *b)
+{
+	return (double)(b->tv_sec - a->tv_sec)*1.0E9 + (double)(b->tv_nsec - a->tv_nsec);
+}
+
+/* Create a table with 'n' synthetic (C++-like) names and time
+ * lookups through the hash index vs. the plain bsearch,
+ * address lookups through the eytzinger array vs. bsearch
+ * and regex searches with and w/o narrowing.
+ */
+int
+cexpsyms_bench_main(int argc, char **argv)
+{
+int             n    = argc > 1 ? atoi(argv[1]) : 400000;
+int             reps = 4, i, r, miss = 0;
+CexpSym         syms;
+char            *names;
+CexpSymTbl      t;
+unsigned        *hindex;
+uintptr_t       a;
+unsigned long   sum[2];
+struct timespec t0, t1;
+const char      *pats[] = { "^_ZN7MyClass1234E", "Class1234E", 0 };
+cexp_regex      *rc;
+char            *prefix, *must;
+int             max, nfound[2], p;
+
+	if ( n <= 0 )
+		return 1;
+
+	syms  = calloc(n + 1, sizeof(*syms));
+	names = malloc(n * 40);
+	if ( ! syms || ! names )
+		return 1;
+
+	for ( i=0; i<n; i++ ) {
+		sprintf(names + 40*i, "_ZN7MyClass%dE%x@GLIBC_2.0", i, i*2654435761U);
+		if ( i & 1 )
+			*strchr(names + 40*i, '@') = 0;
+		syms[i].name      = names + 40*i;
+		syms[i].value.ptv = (CexpVal)(names + 40*i);
+	}
+
+	if ( ! (t = cexpCreateSymTbl(syms, sizeof(*syms), n, 0, 0, 0)) )
+		return 1;
+
+	hindex = t->hindex;
+
+	for ( r=0; r<2; r++ ) {
+		/* r == 0: bsearch, r == 1: hash index */
+		t->hindex = r ? hindex : 0;
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		for ( i=0; i<reps*n; i++ ) {
+			if ( ! cexpSymTblLookup(syms[i % n].name, t) )
+				miss++;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		printf("%s: %8.1f ns/lookup (%i entries)\n",
+			r ? "hash   " : "bsearch", nsDiff(&t0, &t1)/(double)(reps*n), n);
+	}
+
+	t->hindex = hindex;
+
+	if ( cexpIndexSymTbl(t) )
+		return 1;
+
+	for ( r=0; r<2; r++ ) {
+		/* r == 0: bsearch, r == 1: eytzinger (built by the first lookup) */
+		cexpSymTblEytzinger = r;
+		sum[r]   = 0;
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		for ( i=0, a=0; i<reps*n; i++ ) {
+			/* pseudo-random addresses in (and around) the table */
+			a = a * 6364136223846793005ULL + 1442695040888963407ULL;
+			sum[r] += cexpSymTblLkAddrIdx((void*)(names - 40 + (a >> 20) % (40*(n+2))), 0, 0, t);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		printf("%s: %8.1f ns/lkaddr (%i entries)\n",
+			r ? "eytzing" : "bsearch", nsDiff(&t0, &t1)/(double)(reps*n), n);
+	}
+	if ( sum[0] != sum[1] ) {
+		fprintf(stderr,"ERROR: address lookups differ\n");
+		miss++;
+	}
+
+	for ( p=0; pats[p]; p++ ) {
+		if ( ! (rc = cexp_regcomp(pats[p])) )
+			return 1;
+		prefix = rc->prefix;
+		must   = rc->must;
+		for ( r=0; r<2; r++ ) {
+			/* r == 0: full scan, r == 1: narrowed */
+			rc->prefix = r ? prefix : 0;
+			rc->must   = r ? must   : 0;
+			cexpSymTblSignatures = r;
+			clock_gettime(CLOCK_MONOTONIC, &t0);
+			max = n + 1;
+			_cexpSymTblLookupRegex(rc, &max, 0, 0, t);
+			clock_gettime(CLOCK_MONOTONIC, &t1);
+			nfound[r] = n + 1 - max;
+			printf("%s: %10.1f us/regex '%s' (%i matches)\n",
+				r ? "narrow " : "scan   ", nsDiff(&t0, &t1)/1.0E3, pats[p], nfound[r]);
+		}
+		if ( nfound[0] != nfound[1] ) {
+			fprintf(stderr,"ERROR: regex searches differ\n");
+			miss++;
+		}
+		cexp_regfree(rc);
+	}
+
+	if ( miss )
+		fprintf(stderr,"ERROR: %i lookups failed\n", miss);
+
+	/* releases 'syms', too */
+	cexpFreeSymTbl(&t);
+	free(names);
+	return miss ? 1 : 0;
+}
+
+/* synthetic 'external' symbols for cexpsyms_scale_main() */
+typedef struct BenchExtSymRec_ {
+	const char	*name;
+	uintptr_t	value;
+	int			size;
+	int			local;
+} BenchExtSymRec, *BenchExtSym;
+
+static const char *
+benchFilter(void *ext_sym, void *closure)
+{
+BenchExtSym	s = ext_sym;
+	return s->local ? 0 : s->name;
+}
+
+static void
+benchAssign(void *ext_sym, CexpSym cesp, void *closure)
+{
+BenchExtSym	s = ext_sym;
+	cesp->size       = s->size;
+	cesp->value.ptv  = (CexpVal)s->value;
+	cesp->value.type = s->size ? cexpTypeGuessFromSize(s->size) : TFuncP;
+	cesp->flags     |= CEXP_SYMFLG_GLBL;
+}
+
+static CexpSymTbl
+benchBuild(BenchExtSym ext, int n, int nthr, double *ns)
+{
+CexpSymTbl		t;
+struct timespec	t0, t1, t2, t3;
+
+	cexpSymTblThreads = nthr;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	t = cexpAddSymTbl(0, ext, sizeof(*ext), n, benchFilter, benchAssign, 0, CEXP_SYMTBL_FLAG_MT_SAFE);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	if ( t ) {
+		cexpSortSymTbl(t);
+		clock_gettime(CLOCK_MONOTONIC, &t2);
+		if ( cexpIndexSymTbl(t) )
+			cexpFreeSymTbl(&t);
+		clock_gettime(CLOCK_MONOTONIC, &t3);
+		ns[0] = nsDiff(&t0, &t1);
+		ns[1] = nsDiff(&t1, &t2);
+		ns[2] = nsDiff(&t2, &t3);
+	}
+	return t;
+}
+
+/* Build a table from 'n' synthetic external symbols (with duplicate
+ * names and shared addresses) using 1, 2, 4 and 8 threads; report
+ * the times and verify that all tables are identical.
+ */
+int
+cexpsyms_scale_main(int argc, char **argv)
+{
+int				n = argc > 1 ? atoi(argv[1]) : 2000000;
+int				i, nthr, bad = 0;
+BenchExtSym		ext;
+char			*names;
+CexpSymTbl		ref, t;
+double			ns[3], ref_ns = 0.;
+
+	if ( n <= 0 )
+		return 1;
+
+	ext   = calloc(n, sizeof(*ext));
+	names = malloc(n * 40);
+	if ( ! ext || ! names )
+		return 1;
+
+	for ( i=0; i<n; i++ ) {
+		/* every 8th name is a duplicate of an earlier one */
+		if ( (i & 7) == 7 ) {
+			ext[i].name  = ext[i/2].name;
+		} else {
+			sprintf(names + 40*i, "_ZN7MyClass%dE%x%s", i, i*2654435761U, (i & 3) ? "" : "@GLIBC_2.0");
+			ext[i].name  = names + 40*i;
+		}
+		/* a few symbols share an address */
+		ext[i].value = 0x10000000 + ((i*2654435761U) % (unsigned)n) * 16;
+		ext[i].size  = (i % 3) ? 0 : 4;
+		ext[i].local = (i % 11) == 0;
+	}
+
+	if ( ! (ref = benchBuild(ext, n, 1, ns)) )
+		return 1;
+
+	for ( nthr = 1; nthr <= CEXP_SYMTBL_MAX_THREADS; nthr <<= 1 ) {
+		if ( ! (t = benchBuild(ext, n, nthr, ns)) )
+			return 1;
+		if ( 1 == nthr )
+			ref_ns = ns[0] + ns[1] + ns[2];
+
+		if ( t->nentries != ref->nentries ) {
+			bad++;
+		} else {
+			for ( i=0; i<t->nentries; i++ ) {
+				if (   strcmp(t->syms[i].name, ref->syms[i].name)
+				    || t->syms[i].value.ptv  != ref->syms[i].value.ptv
+				    || t->syms[i].value.type != ref->syms[i].value.type
+				    || t->syms[i].size       != ref->syms[i].size
+				    || t->syms[i].flags      != ref->syms[i].flags
+				    || t->aindex[i]          != ref->aindex[i] ) {
+					bad++;
+					break;
+				}
+			}
+		}
+
+		printf("%i thread(s): add %7.1f ms, sort %7.1f ms, index %7.1f ms; speedup %4.2f%s\n",
+			nthr, ns[0]/1.0E6, ns[1]/1.0E6, ns[2]/1.0E6,
+			ref_ns/(ns[0] + ns[1] + ns[2]),
+			bad ? " MISMATCH" : "");
+		cexpFreeSymTbl(&t);
+	}
+
+	printf("(%lu of %i symbols)\n", ref->nentries, n);
+
+	cexpFreeSymTbl(&ref);
+	free(names);
+	free(ext);
+	return bad ? 1 : 0;
+}
+#endif
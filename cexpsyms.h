@@ -69,18 +69,53 @@ typedef struct CexpSymRec_ {
  */
 	int					size;
 	unsigned			flags;
-	char				*help;
+/* NOTE: help text is no longer stored here (it is NULL for almost all
+ *       symbols) but in a sparse side table; see cexpSymHelpCopy().
+ */
 } CexpSymRec;
 
 /* flags associated with symbols */
 #define CEXP_SYMFLG_GLBL		(1<<0) /* a global symbol */
 #define CEXP_SYMFLG_WEAK		(1<<1) /* a weak symbol   */
+#define CEXP_SYMFLG_HELP		(1<<2) /* symbol has an entry in the help table */
 #define CEXP_SYMFLG_MALLOC_HELP	(1<<3) /* whether the help info is static or malloc()ed */
 #define CEXP_SYMFLG_SECT		(1<<4) /* a section (name) symbol */
 
 
 typedef struct CexpSymTblRec_	*CexpSymTbl;
 
+/* Index emitted by 'xsyms -C' along with the builtin symbol
+ * table; the records are already sorted by name (duplicates
+ * eliminated) and have their types assigned. 'aindex' and
+ * 'hindex' are laid out exactly as in a CexpSymTblRec; the
+ * addresses were sorted before the final link (the order
+ * is verified when the table is installed).
+ *
+ * NOTE: the version must be changed whenever the sort order,
+ *       the name hash or this layout change.
+ */
+#define CEXP_SYMTBL_PREBUILT_VERSION	1
+
+typedef struct CexpSymTblPrebuiltRec_ {
+	unsigned		version;
+	unsigned long	nentries;
+	const unsigned	*aindex;
+	const unsigned	*hindex;	/* slot holds index+1; 0 marks an empty slot */
+	unsigned long	hmask;		/* number of hash slots - 1 (power of two)   */
+} CexpSymTblPrebuiltRec, *CexpSymTblPrebuilt;
+
+/* Incremented whenever a name may resolve differently,
+ * i.e., if a module is loaded or unloaded or a user variable
+ * is created or deleted. A symbol found by name remains the
+ * one to use as long as this does not change (the parser
+ * caches identifiers based on this).
+ */
+extern volatile unsigned long cexpSymGeneration;
+
+/* increment cexpSymGeneration (atomically) */
+void
+cexpSymGenerationBump(void);
+
 /* Symbol table management */
 
 /* lookup a symbol by name */
@@ -95,6 +130,30 @@ cexpSymTblLkAddr(void *addr, int margin, FILE *f, CexpSymTbl t);
 CexpSym
 cexpSymTblLookupRegex(char *re, int *pmax, CexpSym s, FILE *f, CexpSymTbl t);
 
+/* Copy a symbol's help text; the copy is made with the help
+ * table locked so the text can't be released meanwhile.
+ * RETURNS: malloc()ed copy (to be free()d by the caller) or
+ *          NULL if there is no help (or no memory).
+ */
+char *
+cexpSymHelpCopy(CexpSym s);
+
+/* Attach help text to a symbol; if 'malloced' is nonzero then
+ * the text is released when the help is removed (replaced text
+ * is kept until then; it may still be referenced by the value of
+ * a 'help' member call), e.g., because the symbol goes away.
+ * Passing a NULL 'text' removes any help.
+ * RETURNS: 0 on success, nonzero if no memory.
+ */
+int
+cexpSymSetHelp(CexpSym s, char *text, int malloced);
+
+/* remove a symbol's help entry; this must be called
+ * before releasing a symbol which may have help attached
+ * (i.e., has CEXP_SYMFLG_HELP set)
+ */
+#define cexpSymDropHelp(s)	cexpSymSetHelp((s),0,0)
+
 /* print info about a symbol to FILE */
 int
 cexpSymPrintInfo(CexpSym s, FILE *f);
@@ -51,7 +51,10 @@
 
 #ifndef CEXP_CEXPSYMS_P_H
 #define CEXP_CEXPSYMS_P_H
+#include <stdint.h>
+#include <stddef.h>
 #include "cexpsyms.h"
+#include "cexplock.h"
 #include <cexp_regex.h>
 
 /* our implementation of the symbol table holds more information
@@ -62,20 +65,113 @@ typedef struct CexpStrTblRec_ {
 	struct CexpStrTblRec_ *next;
 } CexpStrTblRec, *CexpStrTbl;
 
+/* Methods of a 'lazy' table (e.g., the dynamic symbols of a
+ * shared library) which is populated only once the sorted
+ * arrays are needed (regex, prefix or address searches); see
+ * cexpNewLazySymTbl() and cexpSymTblFill().
+ */
+typedef struct CexpSymTblLazyRec_ {
+	/* find a name w/o the sorted arrays; the symbol must remain
+	 * valid until 'cleanup' is called.
+	 */
+	CexpSym			(*lookup)(const char *name, void *arg);
+	/* RETURNS: a new (sorted and indexed) table holding all symbols */
+	CexpSymTbl		(*fill)(void *arg);
+	/* release 'arg' */
+	void			(*cleanup)(void *arg);
+	/* RETURNS: zero if no mangled (C++) name contains 'key' (or
+	 *          if there is none at all if 'key' is NULL); the
+	 *          method may be NULL.
+	 */
+	int				(*mangled)(const char *key, void *arg);
+	void			*arg;
+	uintptr_t		lo, hi;		/* address range of the symbols */
+	volatile int	filled;
+	CexpLock		lock;
+} CexpSymTblLazyRec, *CexpSymTblLazy;
+
+/* Index of the local (static) symbols of a table; it is used
+ * for address lookups only (the names are not visible to
+ * cexpSymTblLookup() etc.) and built on first use, see
+ * cexpSymTblSetLocals().
+ */
+typedef struct CexpSymTblLocalsRec_ {
+	/* RETURNS: a new table with address index holding the local
+	 *          symbols (NULL on error or if there are none);
+	 *          'arg' is released.
+	 */
+	CexpSymTbl		(*build)(void *arg);
+	/* release 'arg' if 'build' was never called */
+	void			(*cleanup)(void *arg);
+	void			*arg;
+	CexpSymTbl		tbl;
+	volatile int	built;
+	CexpLock		lock;
+} CexpSymTblLocalsRec, *CexpSymTblLocals;
+
 typedef struct CexpSymTblRec_ {
 	unsigned long	nentries;
 	unsigned long   size;
 	CexpSym			syms; 		/* symbol table, sorted in ascending order (key=name) */
 	CexpStrTbl      strtbl;
-	CexpSym			*aindex;	/* an index sorted to ascending addresses */
+	unsigned		*aindex;	/* indices into 'syms' sorted to ascending addresses */
+	uintptr_t		*eaddr;		/* the same addresses in eytzinger (BFS) order  */
+								/* for fast searching, followed by the aindex  */
+								/* positions. 1-based; built by the first      */
+								/* address lookup (cexpEytzSymTbl()).          */
+	unsigned		*hindex;	/* open-addressing hash index into 'syms'
+								 * (slot holds index+1; 0 marks an empty slot)
+								 */
+	unsigned long	hmask;		/* number of hash slots - 1 (power of two)     */
+	unsigned long	*bloom;		/* bloom filter over the name hashes; lets us  */
+	unsigned long	bmask;		/* reject most misses w/o probing 'hindex'     */
+	uint64_t		*tsig;		/* per symbol: one bit for each trigram (hash) */
+								/* of the name; for narrowing regex searches   */
+								/* (built by the first one, cexpSigSymTbl())   */
+	void			*image;		/* if the table was installed from an image    */
+	unsigned long	imgsize;	/* ('xsyms -I') then syms, aindex and hindex   */
+								/* point into it and must not be free()d       */
+								/* (nor eaddr and tsig, if taken from there)   */
+	const uintptr_t	*imgEaddr;	/* the image's eytzinger array and signatures  */
+	const uint64_t	*imgTsig;	/* (NULL if there are none or unusable)        */
+	const CexpSymTblPrebuiltRec
+					*prebuilt;	/* if the table was generated by 'xsyms -C'  */
+								/* then syms, hindex (and aindex, unless it  */
+								/* had to be rebuilt) must not be free()d    */
+	void			(*strRelease)(void *arg);
+	void			*strOwner;	/* what names (NO_STRCPY) point into, if owned */
+								/* by the table (see cexpSymTblAdoptStrings()) */
+	CexpSymTblLazy	lazy;		/* NULL unless the table is lazy; it is empty */
+								/* until cexpSymTblFill() was called        */
+	CexpSymTblLocals
+					locals;		/* local symbols (NULL if there are none)   */
+	struct CexpFcNamesRec_
+					*fc;		/* front-coded names (NULL unless the table */
+								/* was compacted by cexpSymTblFrontCode())  */
+	struct CexpDmglIdxRec_
+		* volatile	dmgl;		/* demangled names (NULL until needed, see  */
+								/* cexpSymTblDemangle())                    */
 	CexpSymTbl		next;		/* linked list of tables */
 } CexpSymTblRec;
 
+/* the address index (of an image it is validated by its first use) */
+#define CEXP_AINDEX(t)	((t)->aindex ? (t)->aindex : cexpSymTblAddrIndex(t))
+
+/* symbol at position 'i' of the address index */
+#define CEXP_ASYM(t,i)	(&(t)->syms[CEXP_AINDEX(t)[(i)]])
+
 int
 _cexp_addrcomp(const void *a, const void *b);
 int
 _cexp_namecomp(const void *a, const void *b);
 
+/* hash a symbol name up to (but not including) the
+ * linker version separator so that versioned and unversioned
+ * names land in the same bucket.
+ */
+unsigned long
+_cexp_namehash(const char *name);
+
 char *
 rshLoad(char *host, char *user, char *cmd, long *size_p);
 
@@ -96,16 +192,75 @@ typedef void (CexpSymAssignProc)(void *ext_sym, CexpSym int_sym, void *closure);
 CexpSymTbl
 cexpNewSymTbl(unsigned n_entries);
 
-/* Sort symbols and addresses */
+/* Number of threads used for converting, sorting and indexing
+ * large tables (only if HAVE_PTHREADS; otherwise everything is
+ * done by the caller). Zero (default) uses the number of online
+ * CPUs, at most CEXP_SYMTBL_MAX_THREADS. The resulting tables
+ * do not depend on this setting.
+ */
+#define CEXP_SYMTBL_MAX_THREADS		8
+extern int cexpSymTblThreads;
+
+/* Sort symbols by name, eliminate duplicates and
+ * build the name hash index.
+ */
 void
 cexpSortSymTbl(CexpSymTbl stbl);
 
+/* (Re-) Build the name hash index; this is done by
+ * cexpSortSymTbl() and only needs to be called explicitly
+ * if a table is installed in some other way.
+ * RETURNS 0 on success, nonzero on error (no memory); the
+ *         table remains usable (bsearch) in this case.
+ */
+int
+cexpHashSymTbl(CexpSymTbl stbl);
+
+/* Build the trigram signatures of all names unless the table
+ * has them already; done by the first regex search if
+ * cexpSymTblSignatures is nonzero. May be called on a table
+ * which is in use. cexpSortSymTbl() discards stale signatures.
+ * RETURNS 0 on success, nonzero on error (no memory); regex
+ *         searches look at every name in this case.
+ */
+int
+cexpSigSymTbl(CexpSymTbl stbl);
+
+/* whether regex searches build signatures (8 bytes per symbol);
+ * off on RTEMS. A symbol table image's signatures are used
+ * regardless (they cost no memory).
+ */
+extern int cexpSymTblSignatures;
+
+/* Quick negative test using the table's bloom filter;
+ * 'hash' is the value computed by _cexp_namehash().
+ * RETURNS: zero if the name is definitely not in the table.
+ */
+int
+cexpSymTblMayContain(unsigned long hash, CexpSymTbl stbl);
+
 /* Build sorted index of addresses
  * RETURNS 0 on success, nonzero on error (no memory of index table)
  */
 int
 cexpIndexSymTbl(CexpSymTbl stbl);
 
+/* Build the eytzinger ordered address array from 'aindex' unless
+ * the table has it already; done by the first address lookup if
+ * cexpSymTblEytzinger is nonzero. May be called on a table which
+ * is in use. cexpIndexSymTbl() discards a stale array.
+ * RETURNS 0 on success, nonzero on error (no memory); address
+ *         lookups use a binary search over 'aindex' in this case.
+ */
+int
+cexpEytzSymTbl(CexpSymTbl stbl);
+
+/* whether address lookups build the eytzinger array (one address
+ * and one index per symbol); off on RTEMS. A symbol table image's
+ * array is used regardless (unless the table is relocated).
+ */
+extern int cexpSymTblEytzinger;
+
 /* Convert 'nsyms' external symbols to internal representation and add to table;
  * 
  * NOTES: - 'stbl' may be NULL in which case a new table is allocated.
@@ -120,13 +275,27 @@ cexpIndexSymTbl(CexpSymTbl stbl);
  *          no copy of the symbol name is made. It is assumed that the
  *          external symbol table holds static strings which are safe
  *          to be re-used.
+ *
+ *        - if the CEXP_SYMTBL_FLAG_MT_SAFE is set in 'flags' then
+ *          the 'filter' and 'assign' callbacks may be executed by
+ *          several threads concurrently (on disjoint parts of 'syms')
+ *          and large tables are converted in parallel.
  */
 
 #define CEXP_SYMTBL_FLAG_NO_STRCPY  (1<<0)
+#define CEXP_SYMTBL_FLAG_MT_SAFE    (1<<1)
 
 CexpSymTbl
 cexpAddSymTbl(CexpSymTbl stbl, void *syms, int symSize, int nsyms, CexpSymFilterProc filter, CexpSymAssignProc assign, void *closure, unsigned flags);
 
+/* Hand the storage of names which were added w/o copying them
+ * (CEXP_SYMTBL_FLAG_NO_STRCPY) over to the table, e.g., a mapped
+ * string table; 'release(owner)' is called when the table is
+ * released.
+ */
+void
+cexpSymTblAdoptStrings(CexpSymTbl stbl, void (*release)(void *owner), void *owner);
+
 /* create and sort a Cexp symbol table from external representation */
 CexpSymTbl
 cexpCreateSymTbl(
@@ -138,6 +307,135 @@ cexpCreateSymTbl(
 	void *closure					/* aux pointer passed to filter/assign */
 	);
 
+/* Create a lazy table; the methods are copied. It appears
+ * empty (nentries == 0) to everything but cexpSymTblLookup()
+ * until cexpSymTblFill() is called.
+ *
+ * RETURNS: table or NULL (no memory); 'cleanup' is invoked
+ *          in the latter case.
+ */
+CexpSymTbl
+cexpNewLazySymTbl(CexpSymTblLazy methods);
+
+/* Attach an index of local symbols to a table; 'build(arg)'
+ * is called when the index is needed first (a table without
+ * name index, i.e., which is not sorted suffices). It is not
+ * built at all if 'cexpSymTblLocalsEnable' is zero.
+ *
+ * RETURNS: 0 on success, nonzero on error (no memory; 'cleanup'
+ *          is invoked).
+ */
+int
+cexpSymTblSetLocals(CexpSymTbl stbl, CexpSymTbl (*build)(void *arg), void (*cleanup)(void *arg), void *arg);
+
+/* Index of the local symbols of a table; built if necessary.
+ * May be called concurrently.
+ *
+ * RETURNS: index (to be searched by address only) or NULL.
+ */
+CexpSymTbl
+cexpSymTblLocals(CexpSymTbl stbl);
+
+/* lookups by address consult local symbols, too (default: 1) */
+extern int cexpSymTblLocalsEnable;
+
+/* Populate a lazy table (no-op for other ones); it is safe
+ * to call this concurrently and while others are reading
+ * the (still empty) table.
+ *
+ * RETURNS: 0 on success, nonzero on error (table remains empty).
+ */
+int
+cexpSymTblFill(CexpSymTbl stbl);
+
+/* Store the names of a complete (sorted and indexed) table
+ * front-coded: every 'k'-th name is kept in full, the others
+ * as the length of the prefix shared with their predecessor
+ * plus the rest. All searches keep working on the encoded
+ * names; a symbol's 'name' is decoded (once) when the symbol
+ * is handed out (cexpSymTblResolve()). Only tables owning
+ * copies of their names ('strtbl') are compacted; these are
+ * released.
+ * The table must not be sorted or indexed again afterwards.
+ *
+ * RETURNS: 0 on success (or if the table was left alone),
+ *          nonzero on error (no memory; the table is unchanged).
+ */
+int
+cexpSymTblFrontCode(CexpSymTbl stbl, unsigned k);
+
+/* restart interval used for the system symbol table;
+ * 0 disables front coding.
+ */
+extern unsigned cexpSymTblFcRestart;
+
+/* Make sure the name of 's' (a symbol of 'stbl') is decoded;
+ * this must be done before a symbol found by scanning the
+ * table directly (not by a lookup routine) is handed out.
+ *
+ * RETURNS: 's'
+ */
+CexpSym
+cexpSymTblResolve(CexpSymTbl stbl, CexpSym s);
+
+/* Demangler; same interface as the C++ ABI's __cxa_demangle():
+ * the result is stored in 'buf' (a malloc()ed area of *plen
+ * bytes which is realloc()ed if necessary; 'buf' may be NULL).
+ *
+ * RETURNS: demangled name or NULL ('*pstatus' nonzero, -1 if
+ *          out of memory).
+ */
+typedef char *(*CexpDemangleProc)(const char *mangled, char *buf, size_t *plen, int *pstatus);
+
+/* An entry of the demangled-name index. Return types (templates)
+ * are not part of 'name'; the first 'qlen' chars of it are the
+ * qualified name, the parameter list (if any) follows.
+ */
+typedef struct CexpDmglEntRec_ {
+	const char		*name;
+	unsigned long	qlen;
+	CexpSym			sym;
+} CexpDmglEntRec, *CexpDmglEnt;
+
+/* Build the index of the demangled (C++) names of a complete
+ * table (unless it exists already). The names are demangled
+ * by 'dm' (in parallel if the table is big); the index is
+ * kept until the table is released. Several threads may
+ * attempt to build the index concurrently.
+ *
+ * RETURNS: 0 on success, nonzero on error (no memory).
+ */
+int
+cexpSymTblDemangle(CexpSymTbl stbl, CexpDemangleProc dm);
+
+/* Check if a table may hold mangled (C++) names which contain
+ * 'key' (any mangled names if 'key' is NULL) w/o filling a lazy
+ * table; a table which isn't lazy (or filled) always may.
+ *
+ * RETURNS: zero if there are none.
+ */
+int
+cexpSymTblMayHaveMangled(CexpSymTbl stbl, const char *key);
+
+/* Look a demangled name up, e.g., "ns::Foo::bar(int, char*)" or
+ * (if it has no parameter list) "ns::Foo::bar"; the latter finds
+ * the first of overloaded functions. The index must have been
+ * built (NULL is returned otherwise).
+ *
+ * RETURNS: symbol or NULL.
+ */
+CexpSym
+cexpSymTblLookupDemangled(const char *name, CexpSymTbl stbl);
+
+/* Find the index entries whose qualified names start with 'pfx'
+ * (they are adjacent; entries with the same qualified name, i.e.,
+ * overloaded functions, are adjacent, too).
+ *
+ * RETURNS: number of such entries; the first one in *pfirst.
+ */
+unsigned long
+cexpSymTblDemangledRange(const char *pfx, CexpSymTbl stbl, CexpDmglEnt *pfirst);
+
 /* release all resources associated with the symbol table
  * (as well as the CexpSymTblRec itself).
  *  *tbl is set to 0.
@@ -145,6 +443,94 @@ cexpCreateSymTbl(
 void
 cexpFreeSymTbl(CexpSymTbl *tbl);
 
+/* must be called once before the help table is used */
+void
+cexpSymTblInitOnce(void);
+
+/* Install a symbol table from an image file (see cexpsymimg.h);
+ * the file is mapped (if mmap is available) and the table used
+ * in place - no sorting, no copying and nothing is visited but
+ * the header. If both the image and the caller provide a build-id
+ * ('id', 'idlen') they must match.
+ *
+ * RETURNS: table or NULL if 'f' doesn't contain a (compatible)
+ *          image. If 'f' is no image at all the file position
+ *          is rewound (otherwise, the image is rejected).
+ *          The FILE may be closed by the caller in any case.
+ */
+CexpSymTbl
+cexpMapSymTblImage(FILE *f, const unsigned char *id, unsigned idlen);
+
+/* RETURNS: name of the ELF file the image of 'stbl' was made
+ *          from; NULL if unknown or 'stbl' is no image.
+ */
+const char *
+cexpSymTblImagePath(CexpSymTbl stbl);
+
+/* Validate and publish the address index of an image; a corrupted
+ * one is rebuilt. Use CEXP_AINDEX() rather than calling this.
+ * RETURNS: the address index.
+ */
+unsigned *
+cexpSymTblAddrIndex(CexpSymTbl stbl);
+
+/* Add 'bias' to the addresses of all symbols, e.g., of a
+ * position-independent executable; must be done before the
+ * table is in use. This visits every record (of an image, too).
+ */
+void
+cexpSymTblRelocate(CexpSymTbl stbl, uintptr_t bias);
+
+/* Install the table generated by 'xsyms -C' (see CexpSymTblPrebuiltRec)
+ * in place; 'syms' are not sorted, copied or modified (they may be
+ * read-only) and no memory is allocated for the indices unless the
+ * addresses turn out to be in a different order than when the table
+ * was generated (the address index is then built on the heap).
+ *
+ * RETURNS: table or NULL if the index is incompatible or no memory.
+ */
+CexpSymTbl
+cexpInstallPrebuiltSymTbl(CexpSym syms, const CexpSymTblPrebuiltRec *idx);
+
+/* Regex searches: only symbols in [first, last) can match (if
+ * the regex has a literal prefix) and cexpSymTblScanMatch()
+ * checks the trigram signature and the literal that must be
+ * present before executing the regex on a name.
+ * A 'scoped' expression (cexp_regex.h) is matched against the
+ * demangled names instead (the whole table is scanned); it
+ * matches nothing unless the table's index has been built.
+ */
+typedef struct CexpSymTblScanRec_ {
+	CexpSym		first, last;
+	uint64_t	sig;
+	char		*buf;		/* names decoded from a front-coded table */
+	CexpSym		bsym;		/* symbol whose name is in 'buf'          */
+	const char	*benc;		/* and its encoded name                   */
+	const char	**dn;		/* demangled names (if the expression is  */
+							/* 'scoped' and the table has an index)    */
+} CexpSymTblScanRec, *CexpSymTblScan;
+
+void
+cexpSymTblScanInit(CexpSymTblScan sc, cexp_regex *rc, CexpSymTbl stbl);
+
+int
+cexpSymTblScanMatch(CexpSymTblScan sc, cexp_regex *rc, CexpSymTbl stbl, CexpSym s);
+
+/* release what cexpSymTblScanInit() allocated */
+void
+cexpSymTblScanFini(CexpSymTblScan sc);
+
+/* print info about a symbol using 'name' (e.g., the demangled one) */
+int
+cexpSymPrintInfoAs(CexpSym s, const char *name, FILE *f);
+
+/* Find the names starting with 'pfx' (they are adjacent
+ * in the sorted table).
+ * RETURNS: number of such names; the first one in *pfirst.
+ */
+unsigned long
+cexpSymTblPrefixRange(const char *pfx, CexpSymTbl stbl, CexpSym *pfirst);
+
 /* do a binary search for a symbol's aindex number */
 int
 cexpSymTblLkAddrIdx(void *addr, int margin, FILE *f, CexpSymTbl t);
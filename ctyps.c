@@ -681,29 +681,7 @@ cexpTA2TV(CexpTypedVal v, CexpTypedAddr a)
 CexpType
 cexpTypeGuessFromSize(int s)
 {
-CexpType t = TVoid;
-
-	/* If any floating-point size equals an integer size then the latter has preference */
-
-	if (CEXP_BASE_TYPE_SIZE(TUCharP) == s) {
-		t=TUChar;
-	} else if (CEXP_BASE_TYPE_SIZE(TUShortP) == s) {
-		t=TUShort;
-	/* Check for 'long' first so that it will have preference in
-	 * case 'int' and 'long' are of the same size.
-	 */
-	} else if (CEXP_BASE_TYPE_SIZE(TULongP)  == s) {
-		t=TULong;
-	} else if (CEXP_BASE_TYPE_SIZE(TUIntP)   == s) {
-		t=TUInt;
-	} else if (CEXP_BASE_TYPE_SIZE(TDoubleP) == s) {
-		t=TDouble;
-	} else if (CEXP_BASE_TYPE_SIZE(TFloatP)  == s) {
-		t=TFloat;
-	} else {
-		/* if it's bigger leave it (void*) */
-	}
-	return t;
+	return CEXP_TYPE_GUESS_FROM_SIZE(s);
 }
 
 #define UL unsigned long
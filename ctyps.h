@@ -118,6 +118,21 @@ typedef enum {
 			   		sizeof(void *) : \
 				   	CEXP_BASE_TYPE_SIZE(type_enum))
 
+/* Guess a type from a size (bytes); a constant expression so that
+ * it can be used in initializers (such as the tables generated by
+ * 'xsyms -C'). If a floating-point size equals an integer size then
+ * the latter has preference; 'long' is preferred over 'int'. Bigger
+ * objects are left (void*).
+ */
+#define CEXP_TYPE_GUESS_FROM_SIZE(s) ( \
+				CEXP_BASE_TYPE_SIZE(TUCharP)  == (s) ? TUChar  : \
+				CEXP_BASE_TYPE_SIZE(TUShortP) == (s) ? TUShort : \
+				CEXP_BASE_TYPE_SIZE(TULongP)  == (s) ? TULong  : \
+				CEXP_BASE_TYPE_SIZE(TUIntP)   == (s) ? TUInt   : \
+				CEXP_BASE_TYPE_SIZE(TDoubleP) == (s) ? TDouble : \
+				CEXP_BASE_TYPE_SIZE(TFloatP)  == (s) ? TFloat  : \
+				                                       TVoid )
+
 #define CEXP_TYPE_PTR2BASE(type_enum) \
 				((type_enum) & ~(CEXP_PTR_BIT|CEXP_FUN_BIT))
 #define CEXP_TYPE_BASE2PTR(type_enum) \
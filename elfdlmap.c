@@ -8,6 +8,8 @@
 #include <features.h>
 
 #include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
 
 #include <elfdlmap.h>
 
@@ -49,6 +51,8 @@ const char     *strtab   = 0; /* silence compiler warning */
 void           *hash     = 0; /* silence compiler warning */
 void           *gnu_hash = 0; /* silence compiler warning */
 Elf_GnuHashHdr hhdr;
+void           *gnu_hdr  = 0;
+uintptr_t      lo, hi;
 unsigned long  ndsyms;
 int            i;
 unsigned       msk;
@@ -188,6 +192,19 @@ unsigned       msk;
 	}
 	if ( (MSK_GNUHASH & msk) ) {
 		gnu_hash = ((void*)gnu_hash) + uoff;
+		gnu_hdr  = gnu_hash;
+	}
+
+	/* address range covered by the object */
+	lo = UINTPTR_MAX;
+	hi = 0;
+	for ( i = 0; i < info->dlpi_phnum; i++) {
+		if ( PT_LOAD != info->dlpi_phdr[i].p_type )
+			continue;
+		if ( info->dlpi_phdr[i].p_vaddr + off < lo )
+			lo = info->dlpi_phdr[i].p_vaddr + off;
+		if ( info->dlpi_phdr[i].p_vaddr + info->dlpi_phdr[i].p_memsz + off > hi )
+			hi = info->dlpi_phdr[i].p_vaddr + info->dlpi_phdr[i].p_memsz + off;
 	}
 
 	/* Now we have to go through some pains to find the number of symbols.
@@ -263,6 +280,10 @@ unsigned       msk;
 	map->name     = info->dlpi_name;
 	map->nsyms    = ndsyms;
 	map->offset   = off;
+	map->gnu_hash = gnu_hdr;
+	map->hash     = (MSK_HASH & msk) ? hash : 0;
+	map->lo       = lo < hi ? lo : 0;
+	map->hi       = lo < hi ? hi : 0;
 	/* if there is a gnu hashtable then         */
     /* all undefined or local symbols are first */
 	map->firstsym = (MSK_GNUHASH & msk) ? hhdr.symndx : 0;
@@ -276,6 +297,223 @@ unsigned       msk;
 	return 0;
 }
 
+/* hash functions of DT_GNU_HASH and DT_HASH, respectively */
+static Elf32_Word
+gnuHash(const char *name)
+{
+const unsigned char	*p = (const unsigned char*)name;
+Elf32_Word			h  = 5381;
+
+	while ( *p )
+		h = (h << 5) + h + *p++;
+	return h;
+}
+
+static Elf32_Word
+sysvHash(const char *name)
+{
+const unsigned char	*p = (const unsigned char*)name;
+Elf32_Word			h  = 0, g;
+
+	while ( *p ) {
+		h = (h << 4) + *p++;
+		if ( (g = h & 0xf0000000) )
+			h ^= g >> 24;
+		h &= ~g;
+	}
+	return h;
+}
+
+long
+cexpLinkMapLookup(CexpLinkMap map, const char *name, long prev)
+{
+const ElfW(Sym)			*syms = map->elfsyms;
+const Elf_GnuHashHdr	*hdr;
+const ElfW(Addr)		*bloom;
+const Elf32_Word		*buckets, *chain;
+const unsigned			bits = 8*sizeof(ElfW(Addr));
+ElfW(Addr)				w;
+Elf32_Word				h, h2;
+long					i;
+
+	if ( (hdr = map->gnu_hash) ) {
+		bloom   = (const ElfW(Addr)*)(hdr + 1);
+		buckets = (const Elf32_Word*)(bloom + hdr->maskwords);
+		chain   = buckets + hdr->nbuckets - hdr->symndx;
+
+		h = gnuHash(name);
+
+		if ( prev < 0 ) {
+			w = bloom[ (h / bits) & (hdr->maskwords - 1) ];
+			if ( ! ((w >> (h % bits)) & (w >> ((h >> hdr->shift2) % bits)) & 1) )
+				return -1;
+			if ( 0 == (i = buckets[ h % hdr->nbuckets ]) || i < hdr->symndx )
+				return -1;
+		} else {
+			/* the chain ends with the entry which has the LSB set */
+			if ( chain[prev] & 1 )
+				return -1;
+			i = prev + 1;
+		}
+
+		/* chain entries hold the hashes (LSB masked) */
+		do {
+			h2 = chain[i];
+			if ( (h | 1) == (h2 | 1) && ! strcmp(name, map->strtab + syms[i].st_name) )
+				return i;
+			i++;
+		} while ( ! (h2 & 1) );
+
+	} else if ( map->hash ) {
+		buckets = (const Elf32_Word*)map->hash + 2;
+		chain   = buckets + ((const Elf32_Word*)map->hash)[0];
+
+		i = prev < 0 ? buckets[ sysvHash(name) % ((const Elf32_Word*)map->hash)[0] ] : chain[prev];
+
+		for ( ; STN_UNDEF != i; i = chain[i] ) {
+			if ( ! strcmp(name, map->strtab + syms[i].st_name) )
+				return i;
+		}
+	}
+
+	return -1;
+}
+
+static int
+cntcb(struct dl_phdr_info *info, size_t info_len, void *closure)
+{
+unsigned long long *cnt = closure;
+
+	/* older versions of the dynamic linker don't have the counters */
+	if ( info_len < offsetof(struct dl_phdr_info, dlpi_subs) + sizeof(info->dlpi_subs) )
+		return -1;
+
+	cnt[0] = info->dlpi_adds;
+	cnt[1] = info->dlpi_subs;
+
+	/* the counters are the same for every object */
+	return 1;
+}
+
+int
+cexpLinkMapCounters(unsigned long long *adds, unsigned long long *subs)
+{
+unsigned long long cnt[2];
+
+	if ( 1 != dl_iterate_phdr( cntcb, cnt ) )
+		return -1;
+
+	*adds = cnt[0];
+	*subs = cnt[1];
+	return 0;
+}
+
+static int
+prescb(struct dl_phdr_info *info, size_t info_len, void *closure)
+{
+CexpLinkMap	map = closure;
+uintptr_t	lo  = UINTPTR_MAX, hi = 0;
+int			i;
+
+	if ( info->dlpi_addr != map->offset )
+		return 0;
+
+	for ( i = 0; i < info->dlpi_phnum; i++) {
+		if ( PT_LOAD != info->dlpi_phdr[i].p_type )
+			continue;
+		if ( info->dlpi_phdr[i].p_vaddr + info->dlpi_addr < lo )
+			lo = info->dlpi_phdr[i].p_vaddr + info->dlpi_addr;
+		if ( info->dlpi_phdr[i].p_vaddr + info->dlpi_phdr[i].p_memsz + info->dlpi_addr > hi )
+			hi = info->dlpi_phdr[i].p_vaddr + info->dlpi_phdr[i].p_memsz + info->dlpi_addr;
+	}
+	if ( lo >= hi )
+		lo = hi = 0;
+
+	return lo == map->lo && hi == map->hi;
+}
+
+int
+cexpLinkMapPresent(CexpLinkMap map)
+{
+	return dl_iterate_phdr( prescb, map );
+}
+
+typedef struct BuildIdRec_ {
+	unsigned char	*buf;
+	unsigned		size;
+	unsigned		len;
+} BuildIdRec, *BuildId;
+
+#define NOTE_ALIGN(x)	(((x) + 3) & ~3UL)
+
+static int
+bidcb(struct dl_phdr_info *info, size_t info_len, void *closure)
+{
+BuildId          bid = closure;
+const ElfW(Nhdr) *nh;
+const char       *p, *e;
+int              i;
+
+	/* the first object is the executable */
+	for ( i = 0; i < info->dlpi_phnum; i++ ) {
+		if ( PT_NOTE != info->dlpi_phdr[i].p_type )
+			continue;
+		p = (const char*)(info->dlpi_addr + info->dlpi_phdr[i].p_vaddr);
+		e = p + info->dlpi_phdr[i].p_memsz;
+		while ( p + sizeof(*nh) <= e ) {
+			nh = (const ElfW(Nhdr)*)p;
+			p += sizeof(*nh) + NOTE_ALIGN(nh->n_namesz);
+			if (   NT_GNU_BUILD_ID == nh->n_type
+			    && 4 == nh->n_namesz && ! memcmp(nh + 1, "GNU", 4)
+			    && p + nh->n_descsz <= e ) {
+				bid->len = nh->n_descsz < bid->size ? nh->n_descsz : bid->size;
+				memcpy(bid->buf, p, bid->len);
+				return 1;
+			}
+			p += NOTE_ALIGN(nh->n_descsz);
+		}
+	}
+	return 1;
+}
+
+unsigned
+cexpLinkMapBuildId(unsigned char *buf, unsigned size)
+{
+BuildIdRec bid;
+
+	bid.buf  = buf;
+	bid.size = size;
+	bid.len  = 0;
+	dl_iterate_phdr( bidcb, &bid );
+	return bid.len;
+}
+
+#else
+
+long
+cexpLinkMapLookup(CexpLinkMap map, const char *name, long prev)
+{
+	return -1;
+}
+
+unsigned
+cexpLinkMapBuildId(unsigned char *buf, unsigned size)
+{
+	return 0;
+}
+
+int
+cexpLinkMapCounters(unsigned long long *adds, unsigned long long *subs)
+{
+	return -1;
+}
+
+int
+cexpLinkMapPresent(CexpLinkMap map)
+{
+	return 1;
+}
+
 #endif
 
 CexpLinkMap
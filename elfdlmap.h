@@ -22,6 +22,9 @@ typedef struct CexpLinkMapRec_ {
                              /* all undefined or local symbols are first */
 	uintptr_t     offset;    /* offset by which symbol values may need   */
 	                         /* to be adjusted.                          */
+	const void    *gnu_hash; /* DT_GNU_HASH and DT_HASH tables (either   */
+	const void    *hash;     /* may be NULL); see cexpLinkMapLookup()    */
+	uintptr_t     lo, hi;    /* addresses covered by the object (PT_LOAD) */
 	int           flags;
 } CexpLinkMapRec;
 
@@ -35,4 +38,45 @@ cexpLinkMapBuild(const char *name, void *parm);
 void
 cexpLinkMapFree(CexpLinkMap m);
 
+/* Look 'name' up in the object's own hash table (DT_GNU_HASH
+ * is preferred over DT_HASH); no symbols are copied.
+ * Pass 'prev' = -1 to find the first symbol with this name;
+ * further ones (e.g., other versions) are found by passing
+ * the index obtained previously.
+ *
+ * RETURNS: index into 'elfsyms' or -1 if there is no (more)
+ *          such symbol.
+ */
+long
+cexpLinkMapLookup(CexpLinkMap map, const char *name, long prev);
+
+/* Obtain the dynamic linker's counters of objects ever
+ * loaded/unloaded ('dlpi_adds'/'dlpi_subs'); the link map
+ * may have changed if either is different from a previous
+ * reading. This is cheap (only one object is visited).
+ *
+ * RETURNS: 0 on success, -1 if the counters are not available.
+ */
+int
+cexpLinkMapCounters(unsigned long long *adds, unsigned long long *subs);
+
+/* Check if the object 'map' was built for is still mapped
+ * (e.g., not dlclose()d); the map's 'name' is not used as
+ * it may be gone along with the object.
+ *
+ * RETURNS: nonzero if the object is still there (or if this
+ *          cannot be determined).
+ */
+int
+cexpLinkMapPresent(CexpLinkMap map);
+
+/* Copy (at most 'size' bytes of) the build-id of the executable
+ * (its NT_GNU_BUILD_ID note) to 'buf'.
+ *
+ * RETURNS: number of bytes copied, 0 if there is no build-id
+ *          (or it cannot be determined).
+ */
+unsigned
+cexpLinkMapBuildId(unsigned char *buf, unsigned size);
+
 #endif
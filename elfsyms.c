@@ -75,6 +75,7 @@
 #include <pmelf.h>
 
 #include "cexpsymsP.h"
+#include "cexpsymimg.h"
 #include "cexpmodP.h"
 #define _INSIDE_CEXP_
 #include "cexpHelp.h"
@@ -92,7 +93,9 @@ typedef struct FilterArgsRec_ {
 	uintptr_t   offset;
 } FilterArgsRec, *FilterArgs;
 
-/* filter the symbol table entries we're interested in */
+/* filter the symbol table entries we're interested in;
+ * filter/assign are reentrant (CEXP_SYMTBL_FLAG_MT_SAFE)
+ */
 
 /* NOTE: this routine defines the CexpType which is assigned
  *       to an object read from the symbol table. Currently,
@@ -243,6 +246,53 @@ CexpType	t;
 	cesp->value.ptv  = (CexpVal)((uintptr_t)sp->st_value + args->offset);
 }
 
+/* local (static) functions and objects; these go to the separate
+ * index for address lookups (cexpSymTblSetLocals())
+ */
+static const char *
+filterLocal32(void *ext_sym, void *closure)
+{
+Elf32_Sym   *sp     = ext_sym;
+FilterArgs  args    = closure;
+
+	if (    STB_LOCAL != ELF32_ST_BIND(sp->st_info) || 0 == sp->st_name
+	     || SHN_UNDEF == sp->st_shndx || sp->st_shndx >= SHN_LORESERVE )
+		return 0;
+
+	switch (ELF32_ST_TYPE(sp->st_info)) {
+	case STT_OBJECT:
+	case STT_FUNC:
+	return args->strtab + sp->st_name;
+
+	default:
+	break;
+	}
+
+	return 0;
+}
+
+static const char *
+filterLocal64(void *ext_sym, void *closure)
+{
+Elf64_Sym   *sp     = ext_sym;
+FilterArgs  args    = closure;
+
+	if (    STB_LOCAL != ELF64_ST_BIND(sp->st_info) || 0 == sp->st_name
+	     || SHN_UNDEF == sp->st_shndx || sp->st_shndx >= SHN_LORESERVE )
+		return 0;
+
+	switch (ELF64_ST_TYPE(sp->st_info)) {
+	case STT_OBJECT:
+	case STT_FUNC:
+	return args->strtab + sp->st_name;
+
+	default:
+	break;
+	}
+
+	return 0;
+}
+
 static unsigned long symcnt(void *symtab, size_t symsz, long nsyms, CexpSymFilterProc filt, void *closure)
 {
 unsigned long rval    = 0;
@@ -255,10 +305,483 @@ unsigned long rval    = 0;
 	return rval;
 }
 
+/* A shared library mapped by the dynamic linker. Names are
+ * looked up through the library's own hash table; the symbols
+ * are converted and sorted only once the entire table is
+ * needed (see cexpNewLazySymTbl()).
+ */
+typedef struct DsoRec_ {
+	CexpLinkMap			map;
+	int					symsz;
+	CexpSymFilterProc	filter;
+	CexpSymAssignProc	*assign;
+	FilterArgsRec		args;
+	CexpSym				*cache;		/* symbols found so far, by ELF index */
+	volatile int		cxx;		/* has mangled names: 0 unknown, 1 no, 2 yes */
+} DsoRec, *Dso;
+
+static CexpSym
+dsoLookup(const char *name, void *arg)
+{
+Dso		d  = arg;
+void	*sp = 0;
+long	i;
+
+	/* there may be several versions of a name */
+	for ( i = -1; (i = cexpLinkMapLookup(d->map, name, i)) >= 0; ) {
+		sp = d->map->elfsyms + i * d->symsz;
+		if ( d->filter(sp, &d->args) )
+			break;
+	}
+
+	if ( i < 0 )
+		return 0;
+
+	if ( ! d->cache && ! (d->cache = calloc(d->map->nsyms, sizeof(*d->cache))) )
+		return 0;
+
+	if ( ! d->cache[i] && (d->cache[i] = calloc(1, sizeof(*d->cache[i]))) ) {
+		d->cache[i]->name = d->filter(sp, &d->args);
+		d->assign(sp, d->cache[i], &d->args);
+	}
+
+	return d->cache[i];
+}
+
+static CexpSymTbl
+dsoFill(void *arg)
+{
+Dso			d = arg;
+CexpSymTbl	t;
+
+	/* Lookups which find a module covering an address (or a
+	 * prefix) don't check for dlclose()d libraries first; the
+	 * module of one stays around until the next rescan. Don't
+	 * read what is gone and copy the names, so that a filled
+	 * table doesn't refer to the object's memory.
+	 */
+	if ( cexpLoadFileChanged() && ! cexpLinkMapPresent(d->map) )
+		return 0;
+
+	t = cexpAddSymTbl(
+			0,
+			d->map->elfsyms + d->symsz * d->map->firstsym,
+			d->symsz, d->map->nsyms - d->map->firstsym,
+			d->filter, d->assign,
+			&d->args,
+			CEXP_SYMTBL_FLAG_MT_SAFE);
+
+	if ( ! t )
+		return 0;
+
+	if ( ! t->syms && ! (t->syms = calloc(1, sizeof(*t->syms))) )
+		goto cleanup;
+
+	cexpSortSymTbl( t );
+
+	if ( t->nentries && cexpIndexSymTbl( t ) )
+		goto cleanup;
+
+	return t;
+
+cleanup:
+	cexpFreeSymTbl(&t);
+	return 0;
+}
+
+/* walk the names w/o building the table (cf. dsoFill()) */
+static int
+dsoMangled(const char *key, void *arg)
+{
+Dso				d = arg;
+unsigned long	i;
+const char		*n;
+int				cxx = 1;
+
+	if ( 1 == d->cxx || ( ! key && d->cxx ) )
+		return 2 == d->cxx;
+
+	if ( cexpLoadFileChanged() && ! cexpLinkMapPresent(d->map) )
+		return 0;
+
+	for ( i = d->map->firstsym; i < d->map->nsyms; i++ ) {
+		n = d->filter(d->map->elfsyms + i * d->symsz, &d->args);
+		if ( ! n || '_' != n[0] || 'Z' != n[1] )
+			continue;
+		cxx = 2;
+		if ( ! key || strstr(n + 2, key) )
+			break;
+	}
+	d->cxx = cxx;
+	return i < d->map->nsyms;
+}
+
+static void
+dsoCleanup(void *arg)
+{
+Dso				d = arg;
+unsigned long	i;
+
+	if ( d->cache ) {
+		for ( i = 0; i < d->map->nsyms; i++ )
+			free(d->cache[i]);
+		free(d->cache);
+	}
+	cexpLinkMapFree(d->map);
+	free(d);
+}
+
+/* state of the link map when the library modules were last
+ * brought up to date (see dsoState()); 'dsoElfClass' is 0 until
+ * the system symbol table is loaded.
+ */
+static int						dsoElfClass = 0;
+static volatile unsigned long	dsoSeen     = 0;
+
+/* The link map counters folded into one word which can be read
+ * atomically w/o a lock; both of them only grow, i.e., their sum
+ * changes whenever either does.
+ *
+ * RETURNS: state or 0 if the counters are not available.
+ */
+static unsigned long
+dsoState(void)
+{
+unsigned long long adds, subs;
+
+	if ( cexpLinkMapCounters(&adds, &subs) )
+		return 0;
+	return ((unsigned long)(adds + subs) << 1) | 1;
+}
+
+/* register a shared library as a module of its own (with a lazy table) */
+static int
+dsoAddModule(CexpLinkMap map, int elfclass)
+{
+CexpSymTblLazyRec	methods;
+CexpSymTbl			t;
+Dso					d;
+const char			*name;
+
+	if ( ! (d = calloc(1, sizeof(*d))) ) {
+		cexpLinkMapFree(map);
+		return -1;
+	}
+
+	d->map         = map;
+	d->args.strtab = map->strtab;
+	d->args.offset = map->offset;
+
+	if ( ELFCLASS64 == elfclass ) {
+		d->symsz  = sizeof(Elf64_Sym);
+		d->filter = filter64;
+		d->assign = assign64;
+	} else {
+		d->symsz  = sizeof(Elf32_Sym);
+		d->filter = filter32;
+		d->assign = assign32;
+	}
+
+	methods.lookup  = dsoLookup;
+	methods.fill    = dsoFill;
+	methods.cleanup = dsoCleanup;
+	methods.mangled = dsoMangled;
+	methods.arg     = d;
+	methods.lo      = map->lo;
+	methods.hi      = map->hi;
+
+	if ( ! (t = cexpNewLazySymTbl(&methods)) )
+		return -1;
+
+	name = (name = strrchr(map->name, '/')) ? name + 1 : map->name;
+
+	return cexpModuleAddCompanion(name, map->name, t);
+}
+
+/* only objects with a name are modules; the first entry of
+ * the link map is the program itself.
+ */
+static int
+dsoWanted(CexpLinkMap map)
+{
+	return map->name && *map->name && map->hi > map->lo;
+}
+
+/* is 'map' the object 'mod' was created for? Note that the
+ * name string of a dlclose()d library is gone; use our copy.
+ */
+static int
+dsoSame(CexpLinkMap map, CexpModule mod)
+{
+Dso d = mod->symtbl->lazy->arg;
+
+	return    map->offset  == d->map->offset
+	       && map->lo      == d->map->lo
+	       && map->hi      == d->map->hi
+	       && map->elfsyms == d->map->elfsyms
+	       && ! strcmp(map->name, mod->fileName);
+}
+
+/* find the link to the object 'mod' was created for; look
+ * from 'from' to the end of the list first, then at the start.
+ */
+static CexpLinkMap *
+dsoFind(CexpLinkMap *head, CexpLinkMap *from, CexpModule mod)
+{
+CexpLinkMap *pp;
+
+	for ( pp = from; *pp; pp = &(*pp)->next ) {
+		if ( dsoSame(*pp, mod) )
+			return pp;
+	}
+	for ( pp = head; pp != from; pp = &(*pp)->next ) {
+		if ( dsoSame(*pp, mod) )
+			return pp;
+	}
+	return 0;
+}
+
+int
+cexpLoadFileChanged(void)
+{
+unsigned long seen, now;
+
+	/* w/o the counters only an explicit cexpModuleRescan() helps */
+	if ( ! dsoElfClass || ! (seen = dsoSeen) )
+		return 0;
+
+	return (now = dsoState()) && now != seen;
+}
+
+int
+cexpLoadFileRescan(CexpModule mod)
+{
+CexpLinkMap			maps, map, *pp, *from;
+CexpModule			m, mn;
+unsigned long		now;
+int					rval = 0;
+
+	if ( ! dsoElfClass || mod != cexpSystemModule )
+		return 0;
+
+	/* read the counters first; a change while we build the
+	 * map is then picked up next time.
+	 */
+	if ( (now = dsoState()) && now == dsoSeen )
+		return 0;
+
+	/* the program itself is always there */
+	if ( ! (maps = cexpLinkMapBuild( 0, 0 )) ) {
+		rval = -1;
+		goto cleanup;
+	}
+
+	/* Both, the modules and the link map are in load order; hence
+	 * the next object is usually found right where the previous one
+	 * was. Objects still present are removed from 'maps', what is
+	 * left over are new ones.
+	 */
+	from = &maps;
+	for ( m = mod->next; m; m = mn ) {
+		mn = m->next;
+
+		if ( ! m->symtbl->lazy || dsoFill != m->symtbl->lazy->fill )
+			continue;
+
+		if ( (pp = dsoFind(&maps, from, m)) ) {
+			map       = *pp;
+			*pp       = map->next;
+			map->next = 0;
+			cexpLinkMapFree(map);
+			from      = pp;
+		} else if ( 0 == cexpModuleDropCompanion(m) ) {
+			rval++;
+		}
+	}
+
+	while ( (map = maps) ) {
+		maps      = map->next;
+		map->next = 0;
+		if ( ! dsoWanted(map) ) {
+			cexpLinkMapFree(map);
+		} else if ( dsoAddModule(map, dsoElfClass) ) {
+			rval = -1;
+			break;
+		} else {
+			rval++;
+		}
+	}
+
+	cexpLinkMapFree(maps);
+
+	/* if we couldn't add a module try again next time */
+	if ( rval < 0 )
+		return rval;
+
+cleanup:
+	dsoSeen = now;
+
+	return rval;
+}
+
+/* If the symbol file could be mapped then the names of the
+ * table point into its string table; the stream is kept until
+ * the table is released.
+ */
+typedef struct ElfStrsRec_ {
+	Elf_Stream		elf;
+	Pmelf_Symtab	symtab;
+} ElfStrsRec, *ElfStrs;
+
+static void
+elfStrsRelease(void *arg)
+{
+ElfStrs	e = arg;
+	pmelf_delsymtab(e->symtab);
+	pmelf_delstrm(e->elf,0);
+	free(e);
+}
+
+/* The local symbols of the system table are read when an
+ * address is looked up first; from the mapped file if it is
+ * kept (the names are referenced) or by reading 'path' again.
+ * 'offset' is the load bias of a position-independent executable.
+ */
+typedef struct ElfLocalsRec_ {
+	ElfStrs		strs;
+	int			clss;
+	char		*path;
+	uintptr_t	offset;
+} ElfLocalsRec, *ElfLocals;
+
+static void
+elfLocalsCleanup(void *arg)
+{
+ElfLocals	l = arg;
+	free(l->path);
+	free(l);
+}
+
+static CexpSymTbl
+elfLocalsBuild(void *arg)
+{
+ElfLocals		l      = arg;
+Elf_Stream		elf    = 0;
+Elf_Ehdr		ehdr;
+Pmelf_Shtab		shtab  = 0;
+Pmelf_Symtab	symtab = 0;
+FILE			*f     = 0;
+int				clss   = l->clss;
+unsigned		flags  = CEXP_SYMTBL_FLAG_MT_SAFE;
+unsigned long	nsyms;
+CexpSymTbl		t      = 0, rval = 0;
+FilterArgsRec	args;
+
+	if ( l->strs ) {
+		symtab = l->strs->symtab;
+		flags |= CEXP_SYMTBL_FLAG_NO_STRCPY;
+	} else {
+		if (    ! l->path
+		     || ! (f   = fopen(l->path, "r"))
+		     || ! (elf = pmelf_newstrm(l->path, f)) )
+			goto cleanup;
+		/* FILE is now 'owned' by pmelf */
+		f = 0;
+		if (    pmelf_getehdr(elf, &ehdr)
+		     || ! (shtab  = pmelf_getshtab(elf, &ehdr))
+		     || ! (symtab = pmelf_getsymtab(elf, shtab)) )
+			goto cleanup;
+		clss = ehdr.e_ident[EI_CLASS];
+	}
+
+	args.strtab = symtab->strtab;
+	args.offset = l->offset;
+
+	if ( ELFCLASS64 == clss ) {
+		nsyms = symcnt( (void*)symtab->syms.p_t64, sizeof(Elf64_Sym), symtab->nsyms, filterLocal64, &args );
+		if ( ! nsyms || ! (t = cexpNewSymTbl( nsyms )) )
+			goto cleanup;
+		if ( ! cexpAddSymTbl( t, (void*)symtab->syms.p_t64, sizeof(Elf64_Sym), symtab->nsyms, filterLocal64, assign64, &args, flags ) )
+			goto cleanup;
+	} else {
+		nsyms = symcnt( (void*)symtab->syms.p_t32, sizeof(Elf32_Sym), symtab->nsyms, filterLocal32, &args );
+		if ( ! nsyms || ! (t = cexpNewSymTbl( nsyms )) )
+			goto cleanup;
+		if ( ! cexpAddSymTbl( t, (void*)symtab->syms.p_t32, sizeof(Elf32_Sym), symtab->nsyms, filterLocal32, assign32, &args, flags ) )
+			goto cleanup;
+	}
+
+	/* only searched by address; no need to sort by name */
+	if ( cexpIndexSymTbl( t ) )
+		goto cleanup;
+
+	rval = t;
+	t    = 0;
+
+cleanup:
+	if ( t )
+		cexpFreeSymTbl(&t);
+	if ( ! l->strs ) {
+		pmelf_delsymtab(symtab);
+		pmelf_delshtab(shtab);
+		pmelf_delstrm(elf,0);
+	}
+	if ( f )
+		fclose(f);
+	elfLocalsCleanup(l);
+	return rval;
+}
+
+/* attach the (lazy) index of local symbols to 't'; 'path' is
+ * handed over. Nothing is attached if there is neither.
+ */
+static void
+elfLocalsAttach(CexpSymTbl t, ElfStrs strs, int clss, char *path, uintptr_t offset)
+{
+ElfLocals	l;
+
+	if ( ( ! strs && ! path ) || ! (l = malloc(sizeof(*l))) ) {
+		free(path);
+		return;
+	}
+	l->strs   = strs;
+	l->clss   = clss;
+	l->path   = path;
+	l->offset = offset;
+	/* not fatal if this fails */
+	cexpSymTblSetLocals(t, elfLocalsBuild, elfLocalsCleanup, l);
+}
+
+#ifndef ELFSYMS_TEST_MAIN
+/* not every target's linker script provides these */
+#ifdef __GNUC__
+extern char _etext[] __attribute__((weak));
+extern char _edata[] __attribute__((weak));
+#define ELFSYMS_ETEXT	((uintptr_t)_etext)
+#define ELFSYMS_EDATA	((uintptr_t)_edata)
+#else
+#define ELFSYMS_ETEXT	0
+#define ELFSYMS_EDATA	0
+#endif
+
+/* does symbol 'name' of 't' (relocated by 'bias') disagree
+ * with the run-time address 'addr'? Unknown is no objection.
+ */
+static int
+elfInsane(CexpSymTbl t, const char *name, uintptr_t addr, uintptr_t bias)
+{
+CexpSym	s;
+
+	if ( ! addr || ! (s = cexpSymTblLookup(name, t)) )
+		return 0;
+	return (uintptr_t)s->value.ptv + bias != addr;
+}
+#endif
+
 /* read an ELF file, extract the relevant information and
  * build our internal version of the symbol table.
  * All libelf resources are released upon return from this
- * routine.
+ * routine (unless the table's names refer to the mapped file).
  */
 static CexpSymTbl
 cexpSlurpElf(const char *filename)
@@ -279,6 +802,15 @@ long		  size=0,avail=0;
 unsigned long nsyms;
 CexpLinkMap   lmaps = 0, map;
 FilterArgsRec args;
+unsigned      flags = CEXP_SYMTBL_FLAG_MT_SAFE;
+ElfStrs       strs;
+int           clss;
+unsigned char id[CEXP_SYMIMG_IDMAX];
+unsigned      idlen;
+int           image = 0;
+uintptr_t     bias  = 0;
+ElfStrs       lstrs = 0;
+char          *lpath = 0;
 
 #ifdef HAVE_RCMD
 #ifdef		__rtems__
@@ -290,6 +822,7 @@ char		HOST[30];
 #endif
 
 FILE        *f = 0;
+char        *path = 0;
 
 	pmelf_set_errstrm(stderr);
 
@@ -316,12 +849,35 @@ FILE        *f = 0;
 	else
 #endif
 	{
-		f = cexpSearchFile(getenv("PATH"), filename, 0, 0);
+		f = cexpSearchFile(getenv("PATH"), filename, &path, 0);
 
 		if ( ! f ) {
 			goto cleanup;
 		}
 
+		/* a pre-sorted image ('xsyms -I') can be used right away;
+		 * it only covers the executable itself; shared libraries
+		 * are added from the link map as usual.
+		 */
+		idlen = cexpLinkMapBuildId(id, sizeof(id));
+		if ( (csymt = cexpMapSymTblImage(f, id, idlen)) ) {
+			/* the locals are read from the executable the image
+			 * was made from (if xsyms recorded it)
+			 */
+			if ( cexpSymTblImagePath(csymt) && ! (lpath = strdup(cexpSymTblImagePath(csymt))) )
+				goto cleanup;
+			/* the image matches the executable's layout */
+			clss = 8 == sizeof(void*) ? ELFCLASS64 : ELFCLASS32;
+			dsoSeen    = dsoState();
+			lmaps      = cexpLinkMapBuild( 0, 0 );
+			image      = 1;
+			goto installed;
+		}
+		if ( ftell(f) ) {
+			/* an image but not a usable one */
+			goto cleanup;
+		}
+
 #ifdef USE_ELF_MEMORY
 		if ( setvbuf(f, 0, _IONBF, 0) ) {
 			fprintf(stderr,"cexpSlurpElf: unable to disable buffering: %s\n", strerror(errno));
@@ -363,6 +919,9 @@ FILE        *f = 0;
 				fprintf(stderr,"Error: unable to open symbol file: %s\n", strerror(errno));
 				goto cleanup;
 			}
+		} else {
+			/* no need to copy the names */
+			flags |= CEXP_SYMTBL_FLAG_NO_STRCPY;
 		}
 		/* FILE is now 'owned' by pmelf */
 		f = 0;
@@ -373,9 +932,13 @@ FILE        *f = 0;
 	     || ! (shtab  = pmelf_getshtab(elf, &ehdr))
 	     || ! (symtab = pmelf_getsymtab(elf, shtab)) )
 		goto cleanup;
+	clss = ehdr.e_ident[EI_CLASS];
 	
-	/* convert the symbol table */
-	lmaps = cexpLinkMapBuild( 0, 0 );
+	/* convert the symbol table; the counters are read before
+	 * the link map so that no later change can go unnoticed.
+	 */
+	dsoSeen    = dsoState();
+	lmaps      = cexpLinkMapBuild( 0, 0 );
 
 	args.strtab = symtab->strtab;
 	args.offset = 0;
@@ -394,10 +957,6 @@ FILE        *f = 0;
 				&args);
 	}
 
-	for ( map = lmaps; map; map = map->next ) {
-		nsyms += map->nsyms - map->firstsym;
-	}
-
 	csymt = cexpNewSymTbl( nsyms );
 
 	if ( ! csymt )
@@ -408,49 +967,27 @@ FILE        *f = 0;
 		args.strtab = symtab->strtab;
 		args.offset = 0;
 
-		csymt = cexpAddSymTbl(
+		if ( ! cexpAddSymTbl(
 				csymt,
 				(void*)symtab->syms.p_t64,
 				sizeof(Elf64_Sym), symtab->nsyms,
 				filter64,assign64,
 				&args,
-				0);
-		for ( map = lmaps; map; map = map->next ) {
-			args.strtab = map->strtab;
-			args.offset = map->offset;
-			cexpAddSymTbl(
-				csymt,
-				(void*)map->elfsyms + sizeof(Elf64_Sym) * map->firstsym,
-				sizeof(Elf64_Sym), map->nsyms - map->firstsym,
-				filter64, assign64,
-				&args,
-				(map->flags & CEXP_LINK_MAP_STATIC_STRINGS) ? CEXP_SYMTBL_FLAG_NO_STRCPY : 0
-			);
-		}
+				flags) )
+			goto cleanup;
 	} else {
 
 		args.strtab = symtab->strtab;
 		args.offset = 0;
 
-		csymt = cexpAddSymTbl(
+		if ( ! cexpAddSymTbl(
 				csymt,
 				(void*)symtab->syms.p_t32,
 				sizeof(Elf32_Sym), symtab->nsyms,
 				filter32,assign32,
 				&args,
-				0);
-		for ( map = lmaps; map; map = map->next ) {
-			args.strtab = map->strtab;
-			args.offset = map->offset;
-			cexpAddSymTbl(
-				csymt,
-				(void*)map->elfsyms + sizeof(Elf32_Sym) * map->firstsym,
-				sizeof(Elf32_Sym), map->nsyms - map->firstsym,
-				filter32, assign32,
-				&args,
-				(map->flags & CEXP_LINK_MAP_STATIC_STRINGS) ? CEXP_SYMTBL_FLAG_NO_STRCPY : 0
-			);
-		}
+				flags) )
+			goto cleanup;
 	}
 
 	cexpSortSymTbl( csymt );
@@ -458,26 +995,72 @@ FILE        *f = 0;
 	if ( cexpIndexSymTbl( csymt ) )
 		goto cleanup;
 
+	if ( (flags & CEXP_SYMTBL_FLAG_NO_STRCPY) ) {
+		if ( ! (strs = malloc(sizeof(*strs))) )
+			goto cleanup;
+		strs->elf    = elf;
+		strs->symtab = symtab;
+		cexpSymTblAdoptStrings(csymt, elfStrsRelease, strs);
+		elf    = 0;
+		symtab = 0;
+		lstrs  = strs;
+	} else {
+		lpath  = path;
+		path   = 0;
+	}
+
+installed:
 #ifndef ELFSYMS_TEST_MAIN
-	/* do a couple of sanity checks */
-	if ((sane=cexpSymTblLookup("cexpSlurpElf",csymt))) {
-		extern void *_edata, *_etext;
+	/* do a couple of sanity checks (cexpSlurpElf() is static, i.e.,
+	 * not in the table; use the global routine of this file).
+	 * The values are link-time addresses; a position-independent
+	 * executable is loaded at a bias (which the first, unnamed
+	 * link map entry has).
+	 */
+	if ((sane=cexpSymTblLookup("cexpLoadFile",csymt))) {
+		if ( lmaps && ! (lmaps->name && *lmaps->name) )
+			bias = lmaps->offset;
+		else
+			bias = (uintptr_t)cexpLoadFile - (uintptr_t)sane->value.ptv;
 		/* it must be the main symbol table */
-		if (    sane->value.ptv!=(CexpVal)cexpSlurpElf
-		     || !(sane=cexpSymTblLookup("_etext",csymt)) || sane->value.ptv!=(CexpVal)&_etext
-		     || !(sane=cexpSymTblLookup("_edata",csymt)) || sane->value.ptv!=(CexpVal)&_edata ) {
+		if (    (uintptr_t)sane->value.ptv + bias != (uintptr_t)cexpLoadFile
+		     || elfInsane(csymt, "_etext", ELFSYMS_ETEXT, bias)
+		     || elfInsane(csymt, "_edata", ELFSYMS_EDATA, bias) ) {
 			fprintf(stderr,"ELFSYMS SANITY CHECK FAILED: you possibly loaded the wrong symbol table\n");
 			goto cleanup;
 		}
 		/* OK, sanity test passed */
+		if ( bias )
+			cexpSymTblRelocate(csymt, bias);
+	} else if ( image ) {
+		fprintf(stderr,"Warning: symbol table image could not be verified (no 'cexpLoadFile' symbol)\n");
 	}
 #endif
 
+	elfLocalsAttach(csymt, lstrs, clss, lpath, bias);
+	lpath = 0;
+
+	/* shared libraries become modules of their own (and are
+	 * updated if the link map changes; see cexpLoadFileRescan())
+	 */
+	dsoElfClass = lmaps ? clss : 0;
+	while ( (map = lmaps) ) {
+		lmaps     = map->next;
+		map->next = 0;
+		if ( dsoWanted(map) )
+			dsoAddModule(map, clss);
+		else
+			cexpLinkMapFree(map);
+	}
+
 	rval  = csymt;
 	csymt = 0;
 
 cleanup:
 	cexpLinkMapFree(lmaps);
+	/* before the names go away */
+	if (csymt)
+		cexpFreeSymTbl(&csymt);
 	pmelf_delsymtab(symtab);
 	pmelf_delshtab(shtab);
 	pmelf_delstrm(elf,0);
@@ -485,10 +1068,10 @@ cleanup:
 	if (buf)
 		free(buf);
 #endif
-	if (csymt)
-		cexpFreeSymTbl(&csymt);
 	if (f)
 		fclose(f);
+	free(path);
+	free(lpath);
 	return rval;
 }
 
@@ -520,6 +1103,14 @@ int			rval=-1;
 	return rval;
 }
 
+/* there is no object loader */
+int
+cexpLoadFileScan(const char *filename, CexpObjScan scan)
+{
+	memset(scan, 0, sizeof(*scan));
+	return -1;
+}
+
 #ifdef ELFSYMS_TEST_MAIN
 /* only build this 'main' if we are testing the ELF subsystem */
 
@@ -544,13 +1135,13 @@ CexpSym		symp;
 	fprintf(stderr,"%i symbols found\n",t->nentries);
 	symp=t->syms;
 	for (nsyms=0; nsyms<t->nentries;  nsyms++) {
-		symp=t->aindex[nsyms];
+		symp=CEXP_ASYM(t,nsyms);
 		fprintf(stderr,
 			"%02i 0x%08xx (%2i) %s\n",
 			symp->value.type,
 			symp->value.ptv,
 			symp->size,
-			symp->name);	
+			cexpSymTblResolve(t,symp)->name);	
 		symp++;
 	}
 	cexpFreeSymTbl(&t);
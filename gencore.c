@@ -237,7 +237,7 @@ static bfd_vma geti(uint32_t addr)
 
 #define OFFOF(RecPType, field) ((uint32_t)&((RecPType)0)->field - (uint32_t)(RecPType)0)
 #define NOCEXP 0xffffffff					/* a presumably invalid address */
-#define CEXPMOD_MAGIC_VAL "cexp0000"	    /* version of the cexpmod interface */
+#define CEXPMOD_MAGIC_VAL "cexp0001"	    /* version of the cexpmod interface */
 #define CEXPMOD_MAGIC_SYM "cexpMagicString"
 
 /* These must match the layout in 'cexpmod.h' -- hopefully the x-compiler doesn't
@@ -90,6 +90,14 @@ of interest to stdout. Howmany defaults to +-5 if passed 0",
 		CexpModule,
 		cexpModuleLoad,(char *file_name, char *module_name)
 	),
+	HELP(
+"Load the object modules listed in a file (one file name,\n\
+optionally followed by a module name, per line). They are\n\
+loaded in the order of their dependencies.\n\
+RETURNS: number of modules loaded, -1 on error",
+		int,
+		cexpModuleLoadManifest,(char *manifest)
+	),
 
 #ifdef USE_LOADER
 	HELP(
@@ -97,8 +105,26 @@ of interest to stdout. Howmany defaults to +-5 if passed 0",
 		int,
 		cexpModuleUnload,(CexpModule moduleHandle)
 	),
+	HELP(
+"Unload the module with a given ID (cexpModuleId());\n\
+unlike a handle, the ID of an unloaded module never\n\
+refers to another module (RETURNS: 0 on success)",
+		int,
+		cexpModuleUnloadId,(unsigned long id)
+	),
 #endif
 	HELP(
+"Return a module's ID (serial number which is never reused),\n\
+0 if the handle doesn't refer to a loaded module",
+		unsigned long,
+		cexpModuleId,(CexpModule mod)
+	),
+	HELP(
+"Return the module with a given ID, NULL if it isn't loaded",
+		CexpModule,
+		cexpModuleFindById,(unsigned long id)
+	),
+	HELP(
 "Return a module's name (string owned by module code)",
 		char*,
 		cexpModuleName,(CexpModule moduleID)
@@ -141,12 +167,14 @@ RETURNS: mod->next",
 "A few Cexp builtin routines are:\n\n\
     lkup                   - lookup a symbol\n\
     lkaddr                 - find the address closest to a symbol\n\
-    cexpModuleLoad         - load an object file\n"
+    cexpModuleLoad         - load an object file\n\
+    cexpModuleLoadManifest - load the object files listed in a file\n"
 #ifdef USE_LOADER
 "    cexpModuleUnload       - remove a module from the running system\n"
 #endif
 "\
     cexpModuleName         - return a module name given its handle\n\
+    cexpModuleId           - return a module's ID (never reused)\n\
     cexpModuleFindByName   - find a module given its name\n\
     cexpModuleInfo         - dump info about one or all modules\n"
 	DISAS_HELP
@@ -187,10 +215,10 @@ int		i;
 	for (; h->addr; h++) {
 		/* scan identical addresses skipping section symbols */
 		for ( i=cexpSymTblLkAddrIdx(h->addr,0,0,t);
-			  i>=0 && (found = t->aindex[i])->value.ptv == h->addr;
+			  i>=0 && (found = CEXP_ASYM(t,i))->value.ptv == h->addr;
 		      i-- ) {
 			if (CEXP_SYMFLG_GLBL == (found->flags & (CEXP_SYMFLG_GLBL|CEXP_SYMFLG_SECT))) {
-				found->help=h->info.text;
+				cexpSymSetHelp(found, h->info.text, 0);
 				break;
 			}
 		}
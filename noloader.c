@@ -1,3 +1,4 @@
+#include <string.h>
 #include <cexp.h>
 #include <cexpmodP.h>
 
@@ -7,3 +8,23 @@ cexpLoadFile(char *filename, CexpModule new_module)
 	fprintf(stderr, "Unable to load '%s' -- no object loader was configured\n", filename);
 	return -1;
 }
+
+int
+cexpLoadFileChanged(void)
+{
+	return 0;
+}
+
+int
+cexpLoadFileRescan(CexpModule mod)
+{
+	return 0;
+}
+
+/* there is no object loader */
+int
+cexpLoadFileScan(const char *filename, CexpObjScan scan)
+{
+	memset(scan, 0, sizeof(*scan));
+	return -1;
+}
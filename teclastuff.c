@@ -56,7 +56,7 @@
  */ 
 
 #include <libtecla.h>
-#include <cexp_regex.h>
+#include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
 
@@ -71,25 +71,61 @@
 /* ugly hack - this must match the definition in cexp.y */
 
 /* if the lexer detects an unterminated string constant
- * it returns LEXERR_INCOMPLETE_STRING - offset;
+ * (or quoted symbol name) it returns LEXERR_INCOMPLETE_STRING - offset;
  * the offset is the difference between the current position
  * ( == end of the string) and the opening quote.
  */
 #define LEXERR_INCOMPLETE_STRING	(-100)
 extern int		cexplex();
 
-extern CexpSym	_cexpSymLookupRegex();
+extern int		_cexpSymLookupPrefix(const char *pfx, int max, char *ext, int extsz, void (*cb)(CexpSym s, void *arg), void *arg);
+extern int		_cexpSymLookupDemangledPrefix(const char *pfx, int max, char *ext, int extsz, void (*cb)(CexpSym s, const char *name, int len, void *arg), void *arg);
+
+typedef struct CplArgRec_ {
+	WordCompletion	*cpl;
+	const char		*line;
+	int				word_start, word_end;
+} CplArgRec, *CplArg;
+
+static void
+addCompletion(CexpSym s, void *arg)
+{
+CplArg	a = arg;
+
+	cpl_add_completion(	a->cpl, a->line, a->word_start, a->word_end,
+						s->name + a->word_end - a->word_start,
+						CEXP_TYPE_FUNQ(s->value.type) ? "()" : "",
+						CEXP_TYPE_FUNQ(s->value.type) ? "("  : "");
+}
+
+/* complete a quoted (demangled) name and close the quote */
+static void
+addQuotedCompletion(CexpSym s, const char *name, int len, void *arg)
+{
+CplArg	a = arg;
+char	buf[200];
+
+	len -= a->word_end - a->word_start;
+	if ( len < 0 || len >= (int)sizeof(buf) )
+		return;
+	memcpy(buf, name + a->word_end - a->word_start, len);
+	buf[len] = 0;
+
+	cpl_add_completion(	a->cpl, a->line, a->word_start, a->word_end,
+						buf,
+						CEXP_TYPE_FUNQ(s->value.type) ? "()" : "",
+						CEXP_TYPE_FUNQ(s->value.type) ? "'(" : "'");
+}
 
 int
 cexpSymComplete(WordCompletion *cpl, void *closure, const char *line, int word_end)
 {
 int				rval=1;
 int 			word_start;
-cexp_regex		*rc=0;
-char			*pattern=0;
-int				count=MATCH_MAX,i;
-CexpSym			s;
-CexpModule		m;
+char			*word=0;
+char			ext[200];
+int				count;
+CplArgRec		arg;
 CexpParserCtx	ctx = closure;
 CexpTypedValRec	dummy;
 int				quote;
@@ -104,60 +140,66 @@ int				quote;
 		/* nothing else to do */;
 
 	if ( quote <= LEXERR_INCOMPLETE_STRING ) {
-		int			rval;
-		CplFileConf	*conf = new_CplFileConf();
-
 		/* start position = end + offset returned by cexplex() */
-		cfc_file_start(conf, word_end + quote - LEXERR_INCOMPLETE_STRING);
-		rval = cpl_file_completions(cpl, conf, line, word_end);
-		del_CplFileConf(conf);
-		return rval;
-	}
-
-	/* search start of the word */
-	for (word_start=word_end; word_start>0; word_start--) {
-		/* these characters should match the lexer, see cexp.y ISIDENTCHAR() */
-		register int ch=(unsigned char)line[word_start-1];
-		if (! ( (word_start ? isalnum(ch) : isalpha(ch)) || '_'==ch || '@'==ch) )
-			break;
-	}
-	if (word_start<word_end) {
-		pattern=calloc(word_end-word_start+5,1);
-		pattern[0]='^';
-		strncpy(pattern+1, line+word_start, word_end-word_start);
-		rc=cexp_regcomp(pattern);
-		/* the lookup routine returns the last symbol found
-		 * looping for 'too_many' instances. Hence, if it still
-		 * finds something after too_many matches, we reject...
-		 */
-		_cexpSymLookupRegex(rc,&count,0,0,0);
+		word_start = word_end + quote - LEXERR_INCOMPLETE_STRING;
+
+		if ( 0 == word_start || '\'' != line[word_start-1] ) {
+			int			rval;
+			CplFileConf	*conf = new_CplFileConf();
+
+			cfc_file_start(conf, word_start);
+			rval = cpl_file_completions(cpl, conf, line, word_end);
+			del_CplFileConf(conf);
+			return rval;
+		}
+		/* else it's a quoted symbol name */
 	} else {
-		count=0;
+		/* search start of the word */
+		for (word_start=word_end; word_start>0; word_start--) {
+			/* these characters should match the lexer, see cexp.y ISIDENTCHAR() */
+			register int ch=(unsigned char)line[word_start-1];
+			if (! ( (word_start ? isalnum(ch) : isalpha(ch)) || '_'==ch || '@'==ch) )
+				break;
+		}
+		if (word_start>=word_end) {
+			cpl_record_error(cpl,"Refuse to complete: too many matches");
+			goto cleanup;
+		}
 	}
-	if (count<=0) {
-		cpl_record_error(cpl,"Refuse to complete: too many matches");
+
+	if ( ! (word=calloc(word_end-word_start+1,1)) )
 		goto cleanup;
-	}
+	strncpy(word, line+word_start, word_end-word_start);
+
+	arg.cpl        = cpl;
+	arg.line       = line;
+	arg.word_start = word_start;
+	arg.word_end   = word_end;
 
-	/* now, the real fun starts.. 
-	 *
-	 * NOTE the race condition: if another user just loaded 
-	 * a huge module, we might still have too many matches here.
-	 * However, the damage is minimal: we just don't present
-	 * all the choices...
+	/* identifier characters have no special meaning in names;
+	 * all candidates are found by a prefix lookup in the sorted
+	 * symbol tables.
 	 */
-	for (s=0,m=0,count=0,i=1; count<MATCH_MAX && (s=_cexpSymLookupRegex(rc,&i,s,0,&m)); i=1,count++) {
-		cpl_add_completion(	cpl, line, word_start, word_end,
-							s->name + word_end-word_start,	
-							CEXP_TYPE_FUNQ(s->value.type) ? "()" : "",
-							CEXP_TYPE_FUNQ(s->value.type) ? "("  : "");
+	if ( quote <= LEXERR_INCOMPLETE_STRING ) {
+		/* quoted names are the demangled C++ ones */
+		count = _cexpSymLookupDemangledPrefix(word, MATCH_MAX, ext, sizeof(ext), addQuotedCompletion, &arg);
+	} else {
+		count = _cexpSymLookupPrefix(word, MATCH_MAX, ext, sizeof(ext), addCompletion, &arg);
+	}
+
+	if (count>MATCH_MAX) {
+		if (!*ext) {
+			cpl_record_error(cpl,"Refuse to complete: too many matches");
+			goto cleanup;
+		}
+		/* at least extend the word as far as it is unambiguous */
+		cpl_add_completion(cpl, line, word_start, word_end, ext, "", "");
 	}
 
 	rval=0;
 
 cleanup:
-	cexp_regfree(rc);
-	free(pattern);
+	free(word);
 	return rval;
 }
 
@@ -186,6 +186,7 @@ cexpVarsFlush(void)
 {
 	lhrFlushN_LOCK(gblList.head.p);
 	memset(&gblList.head,0,sizeof(gblList.head));
+	cexpSymGenerationBump();
 	__UNLOCK;
 }
 
@@ -270,6 +271,7 @@ CexpContext c;
 		n->sym.size=sizeof(n->val);
 		n->sym.flags=0;
 		v=n; n=0;
+		cexpSymGenerationBump();
 	}
 	__UNLOCK;
 	if (n) free(n);
@@ -319,10 +321,12 @@ lh		p;
 #else
 		p->p=v->head.p;
 #endif
+		cexpSymGenerationBump();
 	}
 	__UNLOCK;
 	/* paranoia to make dangling pointers more likely to crash */
 	if (v) {
+		cexpSymDropHelp(&v->sym);
 		memset(v,0,sizeof(*v));
 		free(v);
 		return (void*)0xdeadbeef;
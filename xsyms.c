@@ -77,6 +77,9 @@
 #include "elf-bfd.h"
 #endif
 
+#include "cexpsyms.h"
+#include "cexpsymimg.h"
+
 #define LINKER_VERSION_SEPARATOR '@'
 #define DUMMY_ALIAS_PREFIX       "__cexp__dummy_alias_"
 
@@ -306,7 +309,10 @@ fprintf(stderr,"       -s [together with -C]: add section symbols to the symtab
 fprintf(stderr,"          print linker commands on stdout. You want to save these in\n");
 fprintf(stderr,"          a file and add them as a linker script to the final link of\n");
 fprintf(stderr,"          your application.\n");
-fprintf(stderr,"       WARNING: use other than with -C[s] is deprecated; use\n");
+fprintf(stderr,"       -I generate a pre-sorted symbol table image which can be mapped\n");
+fprintf(stderr,"          and used by the target without any sorting or copying;\n");
+fprintf(stderr,"          the symbols are selected as with -C (-s may be added).\n");
+fprintf(stderr,"       WARNING: use other than with -C[s] or -I is deprecated; use\n");
 fprintf(stderr,"                objcopy --extract symbol instead! (Requires\n");
 fprintf(stderr,"                binutils >= 2.18).\n");
 }
@@ -385,6 +391,521 @@ const char *sname = ( BSF_SECTION_SYM & ps->flags ) ?
 	return sname;
 }
 
+static int
+symsize(bfd *abfd, asymbol *s)
+{
+int sz = 0;
+#ifdef HAVE_ELF_BFD_H
+	{
+	elf_symbol_type *elfsp = elf_symbol_from(abfd, s);
+	if ( elfsp )
+		sz = (elfsp)->internal_elf_sym.st_size;
+	}
+#endif
+#ifdef _PMBFD_
+	sz = elf_get_size(abfd, s);
+#endif
+	if ( !(BSF_SECTION_SYM & s->flags) && bfd_is_com_section(bfd_get_section(s)) )
+		sz = bfd_asymbol_value(s); /* value holds size */
+	return sz;
+}
+
+/* Symbol table image generation; this must replicate what
+ * cexpSortSymTbl(), cexpIndexSymTbl() and cexpHashSymTbl() do
+ * at run-time (see cexpsymimg.h).
+ */
+typedef struct ImgSymRec_ {
+	const char    *name;
+	unsigned long value;
+	int           size;
+	unsigned      flags;
+	uint32_t      stroff;
+	int           isym;		/* index into the bfd symbol table */
+} ImgSymRec, *ImgSym;
+
+/* same as _cexp_namecomp() */
+static int
+img_namecomp(const void *key, const void *cmp)
+{
+const char *k = ((ImgSym)key)->name, *c = ((ImgSym)cmp)->name;
+	while (*k) {
+		int	rval;
+		if ((rval=*k++-*c++))
+			return rval;
+	}
+	return !*c || LINKER_VERSION_SEPARATOR==*c ? 0 : -1;
+}
+
+static ImgSym img_syms; /* for img_addrcomp() */
+
+static int
+img_addrcomp(const void *a, const void *b)
+{
+uint32_t      ia = *(const uint32_t*)a;
+uint32_t      ib = *(const uint32_t*)b;
+unsigned long va = img_syms[ia].value;
+unsigned long vb = img_syms[ib].value;
+	if ( va != vb )
+		return va > vb ? 1 : -1;
+	/* same address: table order, like cexpIndexSymTbl() */
+	return ia > ib ? 1 : (ia < ib ? -1 : 0);
+}
+
+/* same as _cexp_namehash() (only the low 32 bits are ever used) */
+static uint32_t
+img_namehash(const char *name)
+{
+const unsigned char *p = (const unsigned char*)name;
+uint32_t            h  = 2166136261U;
+	while ( *p && LINKER_VERSION_SEPARATOR != *p ) {
+		h ^= *p++;
+		h *= 16777619U;
+	}
+	return h;
+}
+
+static void
+img_put(unsigned char *b, unsigned long v, int nbytes, int big)
+{
+int i;
+	for ( i=0; i<nbytes; i++, v >>= 8 )
+		b[ big ? nbytes - 1 - i : i ] = (unsigned char)v;
+}
+
+static unsigned long
+img_get(const unsigned char *b, int nbytes, int big)
+{
+unsigned long v = 0;
+int           i;
+	for ( i=0; i<nbytes; i++ )
+		v = (v << 8) | b[ big ? i : nbytes - 1 - i ];
+	return v;
+}
+
+typedef struct ImgIdRec_ {
+	unsigned char	id[CEXP_SYMIMG_IDMAX];
+	unsigned long	len;
+} ImgIdRec, *ImgId;
+
+/* extract the build-id of the executable (truncated to
+ * CEXP_SYMIMG_IDMAX bytes like the run-time does)
+ */
+static void
+img_buildid(bfd *abfd, asection *sect, void *closure)
+{
+ImgId         id  = closure;
+int           big = bfd_big_endian(abfd);
+unsigned char *n  = 0;
+bfd_size_type l;
+unsigned long namesz, descsz;
+
+	if ( strcmp(bfd_get_section_name(abfd, sect), ".note.gnu.build-id") )
+		return;
+
+	if (   (l = bfd_get_section_size(sect)) < 16
+	    || ! (n = malloc(l))
+	    || ! bfd_get_section_contents(abfd, sect, n, 0, l) )
+		goto cleanup;
+
+	namesz = img_get(n,     4, big);
+	descsz = img_get(n + 4, 4, big);
+	/* type NT_GNU_BUILD_ID (3), name "GNU" */
+	if (   3 != img_get(n + 8, 4, big)
+	    || 4 != namesz || memcmp(n + 12, "GNU", 4)
+	    || 16 + descsz > l )
+		goto cleanup;
+
+	id->len = descsz < CEXP_SYMIMG_IDMAX ? descsz : CEXP_SYMIMG_IDMAX;
+	memcpy(id->id, n + 16, id->len);
+
+cleanup:
+	free(n);
+}
+
+/* Collect the symbols selected by 'fltflags'; they are sorted by name
+ * and duplicates eliminated like cexpSortSymTbl() does.
+ *
+ * RETURNS: array of *pn symbols (plus an extra element) or NULL
+ *          if no memory.
+ */
+static ImgSym
+img_collect(bfd *abfd, asymbol **isyms, int nsyms, int fltflags, unsigned long *pn)
+{
+ImgSym          syms;
+unsigned long   n, i, fr, to;
+
+	if ( ! (syms = calloc(nsyms + 1, sizeof(*syms))) )
+		return 0;
+
+	for ( i=0, n=0; i<nsyms; i++ ) {
+		char          *stripped;
+		unsigned long f = isyms[i]->flags;
+
+		if ( !symfilter(abfd, isyms[i], fltflags) )
+			continue;
+
+		syms[n].name  = getsname(abfd, isyms[i], &stripped);
+		free(stripped);
+		syms[n].value = bfd_asymbol_value(isyms[i]);
+		syms[n].size  = symsize(abfd, isyms[i]);
+		syms[n].isym  = i;
+		if ( BSF_FUNCTION & f )
+			syms[n].flags |= CEXP_SYMIMG_FLG_FUNC;
+		else if ( BSF_OBJECT & f )
+			syms[n].flags |= CEXP_SYMIMG_FLG_OBJ;
+		if ( BSF_GLOBAL & f )
+			syms[n].flags |= CEXP_SYMFLG_GLBL;
+		if ( BSF_WEAK & f )
+			syms[n].flags |= CEXP_SYMFLG_WEAK;
+		if ( BSF_SECTION_SYM & f )
+			syms[n].flags |= CEXP_SYMFLG_SECT;
+		n++;
+	}
+
+	qsort(syms, n, sizeof(*syms), img_namecomp);
+	if ( n ) {
+		syms[n].name = "+%2W";
+		for ( fr=1, to=0; fr<n; fr++ ) {
+			while ( 0 == img_namecomp( &syms[to], &syms[fr] ) )
+				fr++;
+			if ( fr >= n )
+				break;
+			syms[++to] = syms[fr];
+		}
+		n = to + 1;
+	}
+
+	*pn = n;
+	return syms;
+}
+
+/* address index like cexpIndexSymTbl() */
+static void
+img_aindex(ImgSym syms, unsigned long n, uint32_t *aidx)
+{
+unsigned long i;
+	for ( i=0; i<n; i++ )
+		aidx[i] = i;
+	img_syms = syms;
+	qsort(aidx, n, sizeof(*aidx), img_addrcomp);
+}
+
+/* hash index like cexpHashSymTbl(); slots hold index + 1 */
+static void
+img_hindex(ImgSym syms, unsigned long n, uint32_t *hidx, unsigned long hsize)
+{
+unsigned long i, h;
+	memset(hidx, 0, hsize * sizeof(*hidx));
+	for ( i=0; i<n; i++ ) {
+		for ( h = img_namehash(syms[i].name) & (hsize - 1);
+		      hidx[h];
+		      h = (h+1) & (hsize - 1) )
+			/* nothing else to do */;
+		hidx[h] = i + 1;
+	}
+}
+
+/* eytzinger array like cexpEytzSymTbl(); 'ea' and 'er' are 1-based */
+static unsigned long
+img_eytz(ImgSym syms, unsigned long n, const uint32_t *aidx, unsigned long *ea, uint32_t *er, unsigned long i, unsigned long k)
+{
+	if ( k <= n ) {
+		i = img_eytz(syms, n, aidx, ea, er, i, 2*k);
+		ea[k] = syms[aidx[i]].value;
+		er[k] = i++;
+		i = img_eytz(syms, n, aidx, ea, er, i, 2*k+1);
+	}
+	return i;
+}
+
+/* same as trigramSig() in cexpsyms.c */
+#define IMG_TRIGRAM_BIT(p) \
+	(1ULL << (((  ((uint32_t)(unsigned char)(p)[0] << 16) \
+	            | ((uint32_t)(unsigned char)(p)[1] <<  8) \
+	            |  (uint32_t)(unsigned char)(p)[2]) * 2654435761U) >> 26))
+
+static uint64_t
+img_trigramsig(const char *s)
+{
+uint64_t rval = 0;
+	if ( s[0] && s[1] ) {
+		for ( ; s[2]; s++ )
+			rval |= IMG_TRIGRAM_BIT(s);
+	}
+	return rval;
+}
+
+/* the type the target assigns (see ctyps.h); 'long' and pointers
+ * have 'psz' bytes, the other sizes are those of CEXP_SYMIMG_TSIZES()
+ * in write_symimg().
+ */
+#define IMG_TYPE(t,sz)	(CEXP_TYPE_MASK_SIZE(t) | ((sz) << 8))
+
+static unsigned long
+img_type(ImgSym s, int psz)
+{
+	if ( CEXP_SYMIMG_FLG_FUNC & s->flags )
+		return IMG_TYPE(TULong, psz) | CEXP_FUN_BIT | CEXP_PTR_BIT;
+	if ( ! (CEXP_SYMIMG_FLG_OBJ & s->flags) )
+		return TVoid;
+	/* CEXP_TYPE_GUESS_FROM_SIZE() */
+	if ( 1   == s->size ) return IMG_TYPE(TUChar,  1);
+	if ( 2   == s->size ) return IMG_TYPE(TUShort, 2);
+	if ( psz == s->size ) return IMG_TYPE(TULong,  psz);
+	if ( 4   == s->size ) return IMG_TYPE(TUInt,   4);
+	if ( 8   == s->size ) return IMG_TYPE(TDouble, 8);
+	return TVoid;
+}
+
+static unsigned long
+img_hsize(unsigned long n)
+{
+unsigned long hsize;
+	for ( hsize = 2; hsize < 2*n; hsize <<= 1 )
+		/* nothing else to do */;
+	return hsize;
+}
+
+#define ALIGN8(x) (((x) + 7) & ~7UL)
+
+static int
+write_symimg(bfd *abfd, asymbol **isyms, int nsyms, int fltflags, FILE *f)
+{
+int             big   = bfd_big_endian(abfd);
+int             psz   = bfd_get_arch_size(abfd) > 32 ? 8 : 4;
+/* CexpSymRec layout on the target: name, value{ptv,type}, size, flags */
+unsigned long   o_siz = psz + ((psz + 4 + psz - 1) & ~(psz - 1));
+unsigned long   recsz = (o_siz + 8 + psz - 1) & ~(psz - 1);
+ImgSym          syms  = 0;
+uint32_t        *aidx = 0, *hidx = 0, *er = 0;
+unsigned long   *ea   = 0;
+unsigned char   *img  = 0, *rec;
+unsigned long   n, i, nchars, hsize;
+unsigned long   o_syms, o_aidx, o_hidx, o_eytz, o_tsig, o_strs, o_path, size;
+int             rval  = -1;
+ImgIdRec        id;
+char            *path = 0;
+uint64_t        sig;
+
+	if ( ! (syms = img_collect(abfd, isyms, nsyms, fltflags, &n)) )
+		goto cleanup;
+
+	memset(&id, 0, sizeof(id));
+	bfd_map_over_sections(abfd, img_buildid, &id);
+	if ( ! id.len )
+		fprintf(stderr,"Warning: executable has no build-id; only a few addresses are checked when the image is installed\n");
+
+	/* the target reads the local symbols from there */
+	if ( ! (path = realpath(bfd_get_filename(abfd), 0)) )
+		fprintf(stderr,"Warning: unable to determine the path of '%s'; the image has no local symbols\n", bfd_get_filename(abfd));
+
+	for ( i=0, nchars=0; i<n; i++ ) {
+		syms[i].stroff = nchars;
+		nchars += strlen(syms[i].name) + 1;
+	}
+
+	hsize = img_hsize(n);
+
+	o_syms = ALIGN8(sizeof(CexpSymImgHdrRec));
+	o_aidx = ALIGN8(o_syms + (n + 1) * recsz);
+	o_hidx = ALIGN8(o_aidx + n * sizeof(uint32_t));
+	o_eytz = ALIGN8(o_hidx + hsize * sizeof(uint32_t));
+	o_tsig = ALIGN8(o_eytz + (n + 1) * (psz + sizeof(uint32_t)));
+	o_strs = ALIGN8(o_tsig + n * sizeof(uint64_t));
+	o_path = path ? o_strs + nchars : 0;
+	size   = o_strs + nchars + (path ? strlen(path) + 1 : 0);
+
+	if (   ! (img  = calloc(size, 1))
+	    || ! (aidx = malloc((n + 1) * sizeof(*aidx)))
+	    || ! (hidx = malloc(hsize * sizeof(*hidx)))
+	    || ! (ea   = malloc((n + 1) * sizeof(*ea)))
+	    || ! (er   = malloc((n + 1) * sizeof(*er))) )
+		goto cleanup;
+
+	memcpy(img, CEXP_SYMIMG_MAGIC, 8);
+	img_put(img +  8, CEXP_SYMIMG_VERSION, 4, big);
+	img_put(img + 12, CEXP_SYMIMG_ENDIAN,  4, big);
+	img_put(img + 16, recsz,               4, big);
+	img_put(img + 20, CEXP_SYMIMG_TSIZES(2, 4, psz, 4, 8), 4, big);
+	img_put(img + 24, n,                   4, big);
+	img_put(img + 28, hsize - 1,           4, big);
+	img_put(img + 32, o_syms,              4, big);
+	img_put(img + 36, o_aidx,              4, big);
+	img_put(img + 40, o_hidx,              4, big);
+	img_put(img + 44, o_eytz,              4, big);
+	img_put(img + 48, o_tsig,              4, big);
+	img_put(img + 52, o_strs,              4, big);
+	img_put(img + 56, o_path,              4, big);
+	img_put(img + 60, size,                4, big);
+	img_put(img + 64, id.len,              4, big);
+	memcpy(img + 68, id.id, id.len);
+
+	for ( i=0, rec=img + o_syms; i<n; i++, rec += recsz ) {
+		img_put(rec,             o_strs + syms[i].stroff, psz, big);
+		img_put(rec + psz,       syms[i].value,           psz, big);
+		img_put(rec + 2*psz,     img_type(&syms[i], psz), 4,   big);
+		img_put(rec + o_siz,     syms[i].size,            4,   big);
+		img_put(rec + o_siz + 4, syms[i].flags & ~(CEXP_SYMIMG_FLG_FUNC | CEXP_SYMIMG_FLG_OBJ), 4, big);
+		strcpy((char*)img + o_strs + syms[i].stroff, syms[i].name);
+		/* 64-bit; img_put() handles 'long' only */
+		sig = img_trigramsig(syms[i].name);
+		img_put(img + o_tsig + 8*i,     (unsigned long)(sig >> (big ? 32 : 0)), 4, big);
+		img_put(img + o_tsig + 8*i + 4, (unsigned long)(sig >> (big ? 0 : 32)), 4, big);
+	}
+	if ( path )
+		strcpy((char*)img + o_path, path);
+
+	img_aindex(syms, n, aidx);
+	for ( i=0; i<n; i++ )
+		img_put(img + o_aidx + 4*i, aidx[i], 4, big);
+
+	img_hindex(syms, n, hidx, hsize);
+	for ( i=0; i<hsize; i++ )
+		img_put(img + o_hidx + 4*i, hidx[i], 4, big);
+
+	ea[0] = 0;
+	er[0] = 0;
+	img_eytz(syms, n, aidx, ea, er, 0, 1);
+	for ( i=0; i<=n; i++ ) {
+		img_put(img + o_eytz + psz*i,           ea[i], psz, big);
+		img_put(img + o_eytz + psz*(n+1) + 4*i, er[i], 4,   big);
+	}
+
+	if ( 1 != fwrite(img, size, 1, f) ) {
+		perror("Writing symbol table image");
+		goto cleanup;
+	}
+
+	fprintf(stderr,"%lu symbols written to image (%lu bytes)\n", n, size);
+
+	rval = 0;
+
+cleanup:
+	free(syms);
+	free(aidx);
+	free(hidx);
+	free(ea);
+	free(er);
+	free(path);
+	free(img);
+	return rval;
+}
+
+/* Generate C source for the builtin symbol table: the records are
+ * emitted in name order with their types assigned, followed by the
+ * address and hash indices (CexpSymTblPrebuiltRec) so that the
+ * table can be installed without any sorting or copying.
+ */
+static int
+write_symsrc(bfd *abfd, asymbol **isyms, int nsyms, int fltflags, FILE *f)
+{
+ImgSym          syms  = 0;
+uint32_t        *aidx = 0, *hidx = 0;
+unsigned long   n, i, hsize;
+char            *stripped;
+int             rval  = -1;
+
+	if ( ! (syms = img_collect(abfd, isyms, nsyms, fltflags, &n)) )
+		goto cleanup;
+
+	hsize = img_hsize(n);
+
+	if (   ! (aidx = malloc((n + 1) * sizeof(*aidx)))
+	    || ! (hidx = malloc(hsize * sizeof(*hidx))) )
+		goto cleanup;
+
+	fprintf(f,"/* THIS FILE WAS AUTOMATICALLY GENERATED BY xsyms -- DO NOT EDIT */\n");
+	fprintf(f,"#include <cexpsyms.h>\n");
+	if ( (FLTFLAG_SECTSYMS & fltflags) )
+		printf("/* THIS FILE WAS AUTOMATICALLY GENERATED BY xsyms -- DO NOT EDIT */\n");
+	for ( i=0; i<n; i++ ) {
+		asymbol *ps = isyms[syms[i].isym];
+
+		getsname(abfd, ps, &stripped);
+
+		fprintf(f,"extern int "DUMMY_ALIAS_PREFIX"%i;\n",syms[i].isym);
+		if ( ps->flags & BSF_SECTION_SYM )
+			printf("%s%i = ADDR( %s ) ;\n", DUMMY_ALIAS_PREFIX, syms[i].isym, stripped);
+		else
+			fprintf(f,"asm(\".set "DUMMY_ALIAS_PREFIX"%i,%s\\n\");\n",syms[i].isym,stripped);
+		free(stripped);
+	}
+
+	/* const; may live in ROM */
+	fprintf(f,"\n\nstatic const CexpSymRec systemSymbols[] = {\n");
+	for ( i=0; i<n; i++ ) {
+		char sbuf[100];
+		char tbuf[100];
+
+		sprintf(sbuf,"%i",syms[i].size);
+
+		if ( CEXP_SYMIMG_FLG_FUNC & syms[i].flags ) {
+			sprintf(tbuf,"TFuncP");
+			if ( 0 == syms[i].size )
+				sprintf(sbuf,"sizeof(void(*)())");
+		} else {
+			/* evaluated by the target compiler */
+			sprintf(tbuf,"CEXP_TYPE_GUESS_FROM_SIZE(%i)", syms[i].size);
+		}
+
+		fprintf(f,"\t{\n");
+		fprintf(f,"\t\t.name       =\"%s\",\n",syms[i].name);
+		fprintf(f,"\t\t.value.ptv  =(void*)&"DUMMY_ALIAS_PREFIX"%i,\n",syms[i].isym);
+		fprintf(f,"\t\t.value.type =%s,\n",    tbuf);
+		fprintf(f,"\t\t.size       =%s,\n",    sbuf);
+		fprintf(f,"\t\t.flags      =0");
+			if ( CEXP_SYMFLG_GLBL & syms[i].flags )
+				fprintf(f,"|CEXP_SYMFLG_GLBL");
+			if ( (CEXP_SYMFLG_WEAK & syms[i].flags) &&
+			     /* weak in CEXP gets overridden by this table */
+			     strcmp("cexpSystemSymbols",syms[i].name) &&
+			     strcmp("cexpSystemSymbolsIndex",syms[i].name) )
+				fprintf(f,"|CEXP_SYMFLG_WEAK");
+			if ( CEXP_SYMFLG_SECT & syms[i].flags ) fprintf(f,"|CEXP_SYMFLG_SECT");
+		fprintf(f,",\n");
+		fprintf(f,"\t},\n");
+	}
+	fprintf(f,"\t{\n");
+	fprintf(f,"\t0, /* terminating record */\n");
+	fprintf(f,"\t},\n");
+	fprintf(f,"};\n");
+
+	/* the addresses are those before the final link; the target
+	 * verifies the order and builds its own index if it changed.
+	 * (The trailing 0 keeps the array from being empty.)
+	 */
+	img_aindex(syms, n, aidx);
+	fprintf(f,"\nstatic const unsigned systemSymbolsAindex[] = {");
+	for ( i=0; i<n; i++ )
+		fprintf(f,"%s%lu,", i % 8 ? " " : "\n\t", (unsigned long)aidx[i]);
+	fprintf(f,"\n\t0\n};\n");
+
+	img_hindex(syms, n, hidx, hsize);
+	fprintf(f,"\nstatic const unsigned systemSymbolsHindex[] = {");
+	for ( i=0; i<hsize; i++ )
+		fprintf(f,"%s%lu,", i % 8 ? " " : "\n\t", (unsigned long)hidx[i]);
+	fprintf(f,"\n};\n");
+
+	fprintf(f,"\nstatic const CexpSymTblPrebuiltRec systemSymbolsIndex = {\n");
+	fprintf(f,"\t.version  = %i,\n",   CEXP_SYMTBL_PREBUILT_VERSION);
+	fprintf(f,"\t.nentries = %lu,\n",  n);
+	fprintf(f,"\t.aindex   = systemSymbolsAindex,\n");
+	fprintf(f,"\t.hindex   = systemSymbolsHindex,\n");
+	fprintf(f,"\t.hmask    = %lu,\n",  hsize - 1);
+	fprintf(f,"};\n\n");
+
+	fprintf(f,"CexpSym cexpSystemSymbols = (CexpSym)systemSymbols;\n");
+	fprintf(f,"const CexpSymTblPrebuiltRec *cexpSystemSymbolsIndex = &systemSymbolsIndex;\n");
+
+	rval = 0;
+
+cleanup:
+	free(syms);
+	free(aidx);
+	free(hidx);
+	return rval;
+}
+
 static void
 dump_gnu_attributes(bfd *abfd, asection *sect, void *closure)
 {
@@ -429,11 +950,12 @@ asymbol						**isyms=0, **osyms=0;
 int							rval=1;
 char						*ifilen,*ofilen = 0;
 int							gensrc=0;
+int							genimg=0;
 int							dumparch=0;
 int                         fltflags=0;
 
 	/* scan options */
-	while ( (i=getopt(argc, argv, "ahpszCU")) > 0 ) {
+	while ( (i=getopt(argc, argv, "ahpszCIU")) > 0 ) {
 		switch (i) {
 			case 'h': usage(argv[0]); exit(0);
 
@@ -443,6 +965,7 @@ int                         fltflags=0;
 			case 'z':               break;
 
 			case 'C': gensrc   = 1; break;
+			case 'I': genimg   = 1; break;
 			case 'a': dumparch = 1; break;
 			case 's': fltflags |= FLTFLAG_SECTSYMS; break;
 			case 'U': fltflags |= FLTFLAG_UNDFSYMS; break;
@@ -480,7 +1003,7 @@ int                         fltflags=0;
 
 	i++;
 	if (i>=argc) {
-		ofilen = my_strdup_suff(ifilen,gensrc ? "c" : "sym");
+		ofilen = my_strdup_suff(ifilen,gensrc ? "c" : (genimg ? "img" : "sym"));
 		if (!strcmp(ofilen,ifilen)) {
 			fprintf(stderr,"default suffix substitution yields identical in/out filenames\n");
 			goto cleanup;
@@ -488,7 +1011,7 @@ int                         fltflags=0;
 	} else {
 		ofilen = my_strdup_suff(argv[i],0);
 	}
-	if ( gensrc ) {
+	if ( gensrc || genimg ) {
 		if ( !ofilen || !*ofilen )
 			ofeil = stdout;
 		else
@@ -523,7 +1046,7 @@ int                         fltflags=0;
 	}
 
 #ifdef _PMBFD_
-	if ( gensrc ) {
+	if ( gensrc || genimg ) {
 #endif
 	/* Allocate space for the symbol table  */
 	if (i) {
@@ -541,82 +1064,12 @@ int                         fltflags=0;
 #endif
 
 	/* Now copy/generate the symbol table */
-	if (gensrc) {
-		char *stripped;
-
-		fprintf(ofeil,"/* THIS FILE WAS AUTOMATICALLY GENERATED BY xsyms -- DO NOT EDIT */\n");
-		fprintf(ofeil,"#include <cexpsyms.h>\n");
-		if ( (FLTFLAG_SECTSYMS & fltflags) )
-			printf("/* THIS FILE WAS AUTOMATICALLY GENERATED BY xsyms -- DO NOT EDIT */\n");
-		for ( i=0; i<nsyms; i++ ) {
-			if ( !symfilter(ibfd, isyms[i], fltflags) )
-				continue;
-			getsname(ibfd, isyms[i], &stripped);
-
-
-			fprintf(ofeil,"extern int "DUMMY_ALIAS_PREFIX"%i;\n",i);
-			if ( isyms[i]->flags & BSF_SECTION_SYM )
-				printf("%s%i = ADDR( %s ) ;\n", DUMMY_ALIAS_PREFIX, i, stripped);
-			else
-				fprintf(ofeil,"asm(\".set "DUMMY_ALIAS_PREFIX"%i,%s\\n\");\n",i,stripped);
-			free(stripped);
-		}
-		fprintf(ofeil,"\n\nstatic CexpSymRec systemSymbols[] = {\n");
-		for ( i=0; i<nsyms; i++ ) {
-			const char *sname, *t = "TVoid";
-			char sbuf[100];
-			int sz = 0;
-			unsigned long f = isyms[i]->flags;
-
-			if ( !symfilter(ibfd, isyms[i], fltflags) )
-				continue;
-
-			sname = getsname(ibfd, isyms[i], &stripped);
-
-			sz = 0;
-#ifdef HAVE_ELF_BFD_H
-			{
-			elf_symbol_type *elfsp = elf_symbol_from(ibfd, isyms[i]);
-			if ( elfsp )
-				sz = (elfsp)->internal_elf_sym.st_size;
-			}
-#endif
-#ifdef _PMBFD_
-			sz = elf_get_size(ibfd, isyms[i]);
-#endif
-			if ( !(BSF_SECTION_SYM & f) && bfd_is_com_section(bfd_get_section(isyms[i])) )
-				sz = bfd_asymbol_value(isyms[i]); /* value holds size */
-
-			sprintf(sbuf,"%i",sz);
-
-			if ( BSF_FUNCTION & f ) {
-				t = "TFuncP";
-				if ( 0 == sz )
-					sprintf(sbuf,"sizeof(void(*)())");
-			}
-
-			fprintf(ofeil,"\t{\n");
-			fprintf(ofeil,"\t\t.name       =\"%s\",\n",sname);
-			fprintf(ofeil,"\t\t.value.ptv  =(void*)&"DUMMY_ALIAS_PREFIX"%i,\n",i);
-			fprintf(ofeil,"\t\t.value.type =%s,\n",    t);
-			fprintf(ofeil,"\t\t.size       =%s,\n",    sbuf);
-			fprintf(ofeil,"\t\t.flags      =0");
-				if ( BSF_GLOBAL & f )
-					fprintf(ofeil,"|CEXP_SYMFLG_GLBL");
-				if ( (BSF_WEAK  & f) &&
-				     /* weak in CEXP gets overridden by this table */
-				     strcmp("cexpSystemSymbols",sname) )
-					fprintf(ofeil,"|CEXP_SYMFLG_WEAK");
-				if ( BSF_SECTION_SYM & f ) fprintf(ofeil,"|CEXP_SYMFLG_SECT");
-			fprintf(ofeil,",\n");
-			fprintf(ofeil,"\t},\n");
-			free(stripped);
-		}
-		fprintf(ofeil,"\t{\n");
-		fprintf(ofeil,"\t0, /* terminating record */\n");
-		fprintf(ofeil,"\t},\n");
-		fprintf(ofeil,"};\n");
-		fprintf(ofeil,"CexpSym cexpSystemSymbols = systemSymbols;\n");
+	if (genimg) {
+		if ( write_symimg(ibfd, isyms, nsyms, fltflags, ofeil) )
+			goto cleanup;
+	} else if (gensrc) {
+		if ( write_symsrc(ibfd, isyms, nsyms, fltflags, ofeil) )
+			goto cleanup;
 
 		bfd_map_over_sections(ibfd, dump_gnu_attributes, ofeil);
 	} else